@@ -5,6 +5,7 @@
 #include "game_message_window.h"
 #include "inventory_window.h"
 #include "logger.h"
+#include "point.h"
 #include "ui/map_window.h"
 #include "ui/player_window.h"
 #include "ui_point.h"
@@ -109,11 +110,7 @@ int main(int argc, char *argv[]) {
       default:
         engine_handle_keypress(engine, key);
         engine_move_all_entities(engine);
-
-        // Each tick makes the player hungry!
-        entity_increment_hunger(engine_get_active_entity(engine));
-        entity_increment_thirst(engine_get_active_entity(engine));
-        entity_increment_tiredness(engine_get_active_entity(engine));
+        engine_propagate_noise(engine);
         break;
     }
 
@@ -131,6 +128,8 @@ int main(int argc, char *argv[]) {
 
   engine_free(engine);
   configuration_free(configuration);
+  entity_shutdown();
+  point_shutdown();
   logger_free(logger_instance());
 
   player_window_free(player_window);
@@ -84,12 +84,15 @@ Engine *init_game(Configuration *configuration) {
   props.base_light = 0;
 
   // Set some tiles as unlit just for debug purposes
-  for (uint32_t x = 6; x < 8; x++) {
-    for (uint32_t y = 1; y < 5; y++) {
+  MapPrefab *unlit = map_prefab_new(2, 4);
+  for (uint32_t x = 0; x < 2; x++) {
+    for (uint32_t y = 0; y < 4; y++) {
       props.base_light = props.base_light + 1 % 10;
-      map_set_tile_properties(engine_get_map(engine), x, y, &props);
+      map_prefab_set_tile(unlit, x, y, &props);
     }
   }
+  map_stamp_prefab(engine_get_map(engine), unlit, 6, 1);
+  map_prefab_free(unlit);
 
   return engine;
 }
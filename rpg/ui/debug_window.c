@@ -72,8 +72,8 @@ void debug_window_draw(DebugWindow *dbg) {
 
     Entity *active_entity = engine_get_active_entity(dbg->_engine);
 
-    Point const *current_coords = entity_get_coords(active_entity);
-    Tile const  *current_tile = map_get_tile(engine_get_map(dbg->_engine), point_get_x(current_coords), point_get_y(current_coords));
+    Point    current_coords = entity_get_position(active_entity);
+    TileView current_tile = map_get_tile(engine_get_map(dbg->_engine), current_coords.x, current_coords.y);
 
     wclear(target);
     wmove(target, 0, 0);
@@ -83,16 +83,16 @@ void debug_window_draw(DebugWindow *dbg) {
     wprintw(target, "Entities: %d\n", map_count_entities(engine_get_map(dbg->_engine)));
     wprintw(target, "Can move: %zd\n", s_movable_entities);
     wprintw(target, "Items: %d\n", map_count_items(engine_get_map(dbg->_engine)));
-    wprintw(target, "Coords: %d, %d\n", point_get_x(current_coords), point_get_y(current_coords));
+    wprintw(target, "Coords: %d, %d\n", current_coords.x, current_coords.y);
     wprintw(target, "H/T/Ti: %d/%d/%d\n",
             entity_get_hunger(active_entity),
             entity_get_thirst(active_entity),
             entity_get_tiredness(active_entity));
-    wprintw(target, "Tile - Kind  : %c\n", tile_get_tile_kind(current_tile));
-    wprintw(target, "Tile - Light : %d\n", tile_get_base_light(current_tile));
-    wprintw(target, "Tile - Noise : %d\n", tile_get_base_noise(current_tile));
-    wprintw(target, "Tile - Inside: %s\n", tile_is_inside(current_tile) ? "yes" : "no");
-    wprintw(target, "Tile - Traver: %s\n", tile_is_traversable(current_tile) ? "yes" : "no");
+    wprintw(target, "Tile - Kind  : %c\n", current_tile.kind);
+    wprintw(target, "Tile - Light : %d\n", current_tile.base_light);
+    wprintw(target, "Tile - Noise : %d\n", current_tile.base_noise);
+    wprintw(target, "Tile - Inside: %s\n", current_tile.inside ? "yes" : "no");
+    wprintw(target, "Tile - Traver: %s\n", current_tile.traversable ? "yes" : "no");
     // clang-format on
 
     wnoutrefresh(target);
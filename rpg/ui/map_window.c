@@ -52,8 +52,7 @@ inline WINDOW *map_window_get_ncurses_window(MapWindow *map_window) {
 char **map_window_generate_matrix(MapWindow *mpw) {
   char        **matrix;
   MapBoundaries boundaries = map_get_boundaries(mpw->_map);
-  uint32_t      entities_size = map_count_entities(mpw->_map);
-  Entity      **all_entities = map_get_all_entities(mpw->_map);
+  EntitySpan    entities = map_get_entity_span(mpw->_map);
 
   matrix = calloc(boundaries.x, sizeof(char *));
   for (uint32_t i = 0; i < boundaries.x; i++) {
@@ -63,16 +62,15 @@ char **map_window_generate_matrix(MapWindow *mpw) {
   // Fill the matrix with characters depending on the tile type
   for (int x = 0; x < boundaries.x; x++) {
     for (int y = 0; y < boundaries.y; y++) {
-      matrix[x][y] = tile_get_tile_kind(map_get_tile(mpw->_map, x, y));
+      matrix[x][y] = map_get_tile(mpw->_map, x, y).kind;
     }
   }
 
   // Now take all the entities from the map and draw them in the matrix
-  for (uint32_t i = 0; i < entities_size; i++) {
-    Entity *current_entity = all_entities[i];
-
-    Point const *point = entity_get_coords(current_entity);
-    matrix[point_get_x(point)][point_get_y(point)] = entity_get_entity_type(current_entity);
+  for (Entity **current = entities.begin; current != entities.end; current++) {
+    Entity      *current_entity = *current;
+    Point       point = entity_get_position(current_entity);
+    matrix[point.x][point.y] = entity_get_entity_type(current_entity);
   }
 
   return matrix;
@@ -0,0 +1,190 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "chunk_store.h"
+#include "logger.h"
+#include "utils.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHUNK_FILE_PREFIX "chunk-"
+#define CHUNK_FILE_SUFFIX ".bin"
+
+struct ChunkStore {
+  char     *_directory;
+  uint32_t  _count;
+  uint64_t *_written; // Bitset of the chunks written by the store
+  uint64_t  _words;   // Size of _written
+};
+
+// Internal method
+bool chunk_store_has_written(ChunkStore const *store, uint64_t index) {
+  return index / 64 < store->_words && (store->_written[index / 64] & (UINT64_C(1) << (index % 64))) != 0;
+}
+
+// Internal method
+void chunk_store_set_written(ChunkStore *store, uint64_t index, bool written) {
+  if (index / 64 >= store->_words) {
+    if (!written) {
+      return;
+    }
+
+    uint64_t words = index / 64 + 1 > store->_words * 2 ? index / 64 + 1 : store->_words * 2;
+    store->_written = realloc(store->_written, words * sizeof(uint64_t));
+    memset(store->_written + store->_words, 0, (words - store->_words) * sizeof(uint64_t));
+    store->_words = words;
+  }
+
+  if (written) {
+    store->_written[index / 64] |= UINT64_C(1) << (index % 64);
+  } else {
+    store->_written[index / 64] &= ~(UINT64_C(1) << (index % 64));
+  }
+}
+
+// Internal method, returns the path of the file holding the chunk, the
+// returned string must be freed.
+char *chunk_store_path(ChunkStore const *store, uint64_t index) {
+  int   length = snprintf(nullptr, 0, "%s/" CHUNK_FILE_PREFIX "%" PRIu64 CHUNK_FILE_SUFFIX, store->_directory, index);
+  char *ret = malloc(length + 1);
+  snprintf(ret, length + 1, "%s/" CHUNK_FILE_PREFIX "%" PRIu64 CHUNK_FILE_SUFFIX, store->_directory, index);
+  return ret;
+}
+
+ChunkStore *chunk_store_new(char const *directory) {
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+    LOG_ERROR("Unable to create chunk store in '%s'", directory);
+    return nullptr;
+  }
+
+  ChunkStore *ret = calloc(1, sizeof(ChunkStore));
+  ret->_directory = strdup(directory);
+  ret->_count = 0;
+  ret->_written = nullptr;
+  ret->_words = 0;
+
+  return ret;
+}
+
+void chunk_store_free(ChunkStore *store) {
+  for (uint64_t word = 0; word < store->_words; word++) {
+    for (uint64_t bits = store->_written[word]; bits != 0; bits &= bits - 1) {
+      char *path = chunk_store_path(store, word * 64 + __builtin_ctzll(bits));
+      unlink(path);
+      free(path);
+    }
+  }
+
+  // Fails if the directory still contains something which is not ours
+  rmdir(store->_directory);
+
+  free(store->_written);
+  free(store->_directory);
+  free(store);
+}
+
+inline char const *chunk_store_get_directory(ChunkStore const *store) {
+  return store->_directory;
+}
+
+bool chunk_store_write(ChunkStore *store, uint64_t index, char const *data, size_t size) {
+  char *path = chunk_store_path(store, index);
+  bool  existed = chunk_store_has_written(store, index);
+  FILE *file = fopen(path, "wb");
+  bool  ret = false;
+
+  if (file == nullptr) {
+    LOG_ERROR("Unable to open chunk file '%s' for writing", path);
+  } else {
+    ret = fwrite(data, 1, size, file) == size;
+    ret = (fclose(file) == 0) && ret;
+
+    if (!ret) {
+      LOG_ERROR("Unable to write chunk file '%s'", path);
+      unlink(path);
+    }
+  }
+
+  if (ret && !existed) {
+    store->_count++;
+  } else if (!ret && existed) {
+    store->_count--;
+  }
+  chunk_store_set_written(store, index, ret);
+
+  free(path);
+  return ret;
+}
+
+char *chunk_store_read(ChunkStore const *store, uint64_t index, size_t *size) {
+  *size = 0;
+  if (!chunk_store_has_written(store, index)) {
+    return nullptr;
+  }
+
+  char *path = chunk_store_path(store, index);
+  FILE *file = fopen(path, "rb");
+  char *ret = nullptr;
+
+  if (file != nullptr) {
+    int64_t length = file_size(file);
+    if (length > 0) {
+      ret = malloc(length);
+      if (fread(ret, 1, length, file) != (size_t)length) {
+        LOG_ERROR("Unable to read chunk file '%s'", path);
+        free(ret);
+        ret = nullptr;
+      } else {
+        *size = length;
+      }
+    }
+    fclose(file);
+  }
+
+  free(path);
+  return ret;
+}
+
+inline bool chunk_store_contains(ChunkStore const *store, uint64_t index) {
+  return chunk_store_has_written(store, index);
+}
+
+void chunk_store_remove(ChunkStore *store, uint64_t index) {
+  if (!chunk_store_has_written(store, index)) {
+    return;
+  }
+
+  char *path = chunk_store_path(store, index);
+  unlink(path);
+  chunk_store_set_written(store, index, false);
+  store->_count--;
+  free(path);
+}
+
+inline uint32_t chunk_store_count(ChunkStore const *store) {
+  return store->_count;
+}
@@ -0,0 +1,69 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __CHUNK_STORE__H__
+#define __CHUNK_STORE__H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A chunk store is a directory on disk holding one file per chunk of a map,
+ * it is used by the map to swap out the chunks it does not need to keep in
+ * memory. The store does not know anything about the content of the chunks,
+ * it only reads and writes blobs of bytes identified by the index of the chunk.
+ */
+typedef struct ChunkStore ChunkStore;
+
+/*
+ * Creates a new chunk store inside the given directory, the directory is
+ * created if it does not exist yet. Returns nullptr if the directory cannot
+ * be used. The store only ever sees the chunks it wrote itself, the files
+ * already in the directory are ignored (but overwritten if their name is the
+ * one of a chunk written by the store).
+ */
+ChunkStore *chunk_store_new(char const *);
+
+/*
+ * Frees the store, the files written by the store are removed from the disk
+ * as well as the directory (if nothing else is left in it).
+ */
+void chunk_store_free(ChunkStore *);
+
+char const *chunk_store_get_directory(ChunkStore const *);
+
+/*
+ * Writes a chunk to the store, replacing the previous version of the chunk
+ * if any. Returns false if the chunk could not be written.
+ */
+bool chunk_store_write(ChunkStore *, uint64_t, char const *, size_t);
+
+/*
+ * Reads a chunk from the store, the returned buffer must be freed by the
+ * caller. Returns nullptr if the chunk is not in the store.
+ */
+char *chunk_store_read(ChunkStore const *, uint64_t, size_t *);
+
+bool     chunk_store_contains(ChunkStore const *, uint64_t);
+void     chunk_store_remove(ChunkStore *, uint64_t);
+uint32_t chunk_store_count(ChunkStore const *);
+
+#endif /* ifndef __CHUNK_STORE__H__ */
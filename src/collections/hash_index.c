@@ -0,0 +1,199 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "collections/hash_index.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Grow the table when more than 7 slots out of 10 are used (tombstones included)
+#define HASH_INDEX_MAX_LOAD_NUM 7
+#define HASH_INDEX_MAX_LOAD_DEN 10
+#define HASH_INDEX_MIN_CAPACITY 16
+
+typedef struct Slot {
+  char const *_key;
+  uint32_t    _hash;
+  uint32_t    _value;
+} Slot;
+
+struct HashIndex {
+  uint32_t _capacity; // Always a power of two
+  uint32_t _count;
+  uint32_t _tombstones;
+  Slot    *_slots;
+};
+
+// Removed slots point to this key, so that probing does not stop on them
+static char const TOMBSTONE[] = "";
+
+// FNV-1a
+static inline uint32_t hash_index_hash(char const *key) {
+  uint32_t hash = 2166136261U;
+  for (unsigned char const *current = (unsigned char const *)key; *current != '\0'; current++) {
+    hash ^= *current;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+static inline uint32_t hash_index_round_capacity(uint32_t wanted) {
+  uint32_t capacity = HASH_INDEX_MIN_CAPACITY;
+  while (capacity < wanted) {
+    capacity <<= 1;
+  }
+
+  return capacity;
+}
+
+HashIndex *hash_index_new(uint32_t expected_keys) {
+  HashIndex *self = calloc(1, sizeof(HashIndex));
+
+  // Make sure that the expected number of keys fits without having to grow
+  self->_capacity = hash_index_round_capacity(expected_keys + (expected_keys * 3 / HASH_INDEX_MAX_LOAD_NUM) + 1);
+  self->_count = 0;
+  self->_tombstones = 0;
+  self->_slots = calloc(self->_capacity, sizeof(Slot));
+
+  return self;
+}
+
+void hash_index_free(HashIndex *self) {
+  free(self->_slots);
+  free(self);
+}
+
+inline uint32_t hash_index_count(HashIndex const *self) {
+  return self->_count;
+}
+
+inline uint32_t hash_index_get_capacity(HashIndex const *self) {
+  return self->_capacity;
+}
+
+// Internal method, returns the slot holding the key or nullptr
+Slot *hash_index_find(HashIndex const *self, char const *key, uint32_t hash) {
+  uint32_t mask = self->_capacity - 1;
+  for (uint32_t probe = hash & mask;; probe = (probe + 1) & mask) {
+    Slot *slot = &self->_slots[probe];
+    if (slot->_key == nullptr) {
+      return nullptr;
+    }
+
+    if (slot->_key != TOMBSTONE && slot->_hash == hash && strcmp(slot->_key, key) == 0) {
+      return slot;
+    }
+  }
+}
+
+// Internal method, inserts a key which is known not to be in the table yet
+void hash_index_insert(HashIndex *self, char const *key, uint32_t hash, uint32_t value) {
+  uint32_t mask = self->_capacity - 1;
+  uint32_t probe = hash & mask;
+  while (self->_slots[probe]._key != nullptr && self->_slots[probe]._key != TOMBSTONE) {
+    probe = (probe + 1) & mask;
+  }
+
+  if (self->_slots[probe]._key == TOMBSTONE) {
+    self->_tombstones--;
+  }
+
+  self->_slots[probe]._key = key;
+  self->_slots[probe]._hash = hash;
+  self->_slots[probe]._value = value;
+  self->_count++;
+}
+
+// Internal method, rehashes everything in a table of the given capacity,
+// dropping all the tombstones in the process
+void hash_index_rehash(HashIndex *self, uint32_t capacity) {
+  Slot    *old_slots = self->_slots;
+  uint32_t old_capacity = self->_capacity;
+
+  self->_capacity = capacity;
+  self->_slots = calloc(capacity, sizeof(Slot));
+  self->_count = 0;
+  self->_tombstones = 0;
+
+  for (uint32_t i = 0; i < old_capacity; i++) {
+    if (old_slots[i]._key != nullptr && old_slots[i]._key != TOMBSTONE) {
+      hash_index_insert(self, old_slots[i]._key, old_slots[i]._hash, old_slots[i]._value);
+    }
+  }
+
+  free(old_slots);
+}
+
+void hash_index_put(HashIndex *self, char const *key, uint32_t value) {
+  uint32_t hash = hash_index_hash(key);
+  Slot    *existing = hash_index_find(self, key, hash);
+  if (existing != nullptr) {
+    existing->_value = value;
+    return;
+  }
+
+  uint64_t used = (uint64_t)self->_count + self->_tombstones + 1;
+  if (used * HASH_INDEX_MAX_LOAD_DEN > (uint64_t)self->_capacity * HASH_INDEX_MAX_LOAD_NUM) {
+    // Only grow if the table is really full, otherwise just get rid of the tombstones
+    bool     must_grow = ((uint64_t)self->_count + 1) * 2 * HASH_INDEX_MAX_LOAD_DEN > (uint64_t)self->_capacity * HASH_INDEX_MAX_LOAD_NUM;
+    uint32_t capacity = must_grow ? self->_capacity << 1 : self->_capacity;
+    hash_index_rehash(self, capacity);
+  }
+
+  hash_index_insert(self, key, hash, value);
+}
+
+bool hash_index_get(HashIndex const *self, char const *key, uint32_t *value) {
+  Slot const *slot = hash_index_find(self, key, hash_index_hash(key));
+  if (slot == nullptr) {
+    return false;
+  }
+
+  if (value != nullptr) {
+    *value = slot->_value;
+  }
+
+  return true;
+}
+
+bool hash_index_contains(HashIndex const *self, char const *key) {
+  return hash_index_get(self, key, nullptr);
+}
+
+bool hash_index_remove(HashIndex *self, char const *key) {
+  Slot *slot = hash_index_find(self, key, hash_index_hash(key));
+  if (slot == nullptr) {
+    return false;
+  }
+
+  slot->_key = TOMBSTONE;
+  self->_count--;
+  self->_tombstones++;
+
+  return true;
+}
+
+void hash_index_clear(HashIndex *self) {
+  memset(self->_slots, 0, self->_capacity * sizeof(Slot));
+  self->_count = 0;
+  self->_tombstones = 0;
+}
@@ -0,0 +1,47 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __COLLECTIONS_HASH_INDEX__H__
+#define __COLLECTIONS_HASH_INDEX__H__
+
+#include <stdint.h>
+
+// Open-addressing hash table mapping strings to unsigned integers (usually
+// an index inside another array).
+//
+// Keys are *not* copied: the caller must guarantee that a key outlives its
+// entry in the index (e.g. the name of an entity stored in a map).
+typedef struct HashIndex HashIndex;
+
+HashIndex *hash_index_new(uint32_t);
+void       hash_index_free(HashIndex *);
+
+uint32_t hash_index_count(HashIndex const *);
+uint32_t hash_index_get_capacity(HashIndex const *);
+
+// Inserts a new key or updates the value of an existing one
+void hash_index_put(HashIndex *, char const *, uint32_t);
+bool hash_index_get(HashIndex const *, char const *, uint32_t *);
+bool hash_index_contains(HashIndex const *, char const *);
+bool hash_index_remove(HashIndex *, char const *);
+void hash_index_clear(HashIndex *);
+
+#endif /* ifndef __COLLECTIONS_HASH_INDEX__H__ */
@@ -337,7 +337,7 @@ void *linked_list_get(LinkedList const *self, uint32_t index) {
 void *linked_list_find(LinkedList const *self, Comparator comparator) {
   Node const *current_node = self->_first;
 
-  while (!node_is_empty(current_node) && current_node != nullptr) {
+  while (current_node != nullptr && !node_is_empty(current_node)) {
     if (comparator(node_get_content(current_node))) {
       return node_get_content(current_node);
     }
@@ -355,7 +355,7 @@ void **linked_list_find_all(LinkedList const *self, Comparator comparator, size_
   result = malloc(self->_filled_nodes * sizeof(void *));
 
   Node const *current_node = self->_first;
-  while (!node_is_empty(current_node) && current_node != nullptr) {
+  while (current_node != nullptr && !node_is_empty(current_node)) {
     if (comparator(node_get_content(current_node))) {
       result[(*final_size)++] = node_get_content(current_node);
     }
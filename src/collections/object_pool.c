@@ -0,0 +1,140 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "collections/object_pool.h"
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_SLAB_CAPACITY 64
+
+typedef struct Slab {
+  struct Slab *_previous;
+  uint32_t     _capacity;
+  uint32_t     _used;
+  alignas(max_align_t) unsigned char _objects[];
+} Slab;
+
+struct ObjectPool {
+  Slab    *_last;
+  void    *_released; // Intrusive list, each released object points to the next one
+  size_t   _object_size;
+  uint32_t _count;
+  uint32_t _capacity;
+};
+
+ObjectPool *object_pool_new(size_t object_size) {
+  ObjectPool *ret = calloc(1, sizeof(ObjectPool));
+
+  // Released objects must be able to hold the link to the next one
+  if (object_size < sizeof(void *)) {
+    object_size = sizeof(void *);
+  }
+
+  ret->_object_size = (object_size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+  return ret;
+}
+
+void object_pool_free(ObjectPool *self) {
+  Slab *current = self->_last;
+  while (current != nullptr) {
+    Slab *previous = current->_previous;
+    free(current);
+    current = previous;
+  }
+
+  free(self);
+}
+
+// Internal method
+void object_pool_grow(ObjectPool *self) {
+  uint32_t const capacity = self->_last == nullptr ? MIN_SLAB_CAPACITY : self->_last->_capacity * 2;
+
+  Slab *slab = malloc(sizeof(Slab) + capacity * self->_object_size);
+  slab->_previous = self->_last;
+  slab->_capacity = capacity;
+  slab->_used = 0;
+
+  self->_last = slab;
+  self->_capacity += capacity;
+}
+
+void *object_pool_alloc(ObjectPool *self) {
+  void *ret;
+
+  if (self->_released != nullptr) {
+    ret = self->_released;
+    memcpy(&self->_released, ret, sizeof(void *));
+  } else {
+    if (self->_last == nullptr || self->_last->_used == self->_last->_capacity) {
+      object_pool_grow(self);
+    }
+
+    ret = self->_last->_objects + self->_last->_used * self->_object_size;
+    self->_last->_used++;
+  }
+
+  self->_count++;
+  return memset(ret, 0, self->_object_size);
+}
+
+void object_pool_release(ObjectPool *self, void *object) {
+  if (object == nullptr) {
+    return;
+  }
+
+  memcpy(object, &self->_released, sizeof(void *));
+  self->_released = object;
+  self->_count--;
+}
+
+inline uint32_t object_pool_count(ObjectPool const *self) {
+  return self->_count;
+}
+
+inline uint32_t object_pool_capacity(ObjectPool const *self) {
+  return self->_capacity;
+}
+
+void *object_pool_alloc_shared(ObjectPool **pool, size_t object_size) {
+  if (*pool == nullptr) {
+    *pool = object_pool_new(object_size);
+  }
+
+  return object_pool_alloc(*pool);
+}
+
+void object_pool_release_shared(ObjectPool **pool, void *object) {
+  if (object == nullptr) {
+    return;
+  }
+
+  object_pool_release(*pool, object);
+}
+
+void object_pool_free_shared(ObjectPool **pool) {
+  if (*pool != nullptr) {
+    object_pool_free(*pool);
+    *pool = nullptr;
+  }
+}
@@ -0,0 +1,54 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __COLLECTIONS_OBJECT_POOL__H__
+#define __COLLECTIONS_OBJECT_POOL__H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pool of objects of the same size, carved out of slabs which double in size
+// every time the pool runs out of room. Allocating is a pop from the list of
+// released objects or a bump in the last slab, releasing is a push on that
+// list. Slabs are never given back until the pool itself is freed, which
+// releases every object still alive at once.
+//
+// Objects are zeroed on allocation, like calloc would. Pools are not thread
+// safe, a pool and its objects must only be used by one thread at a time.
+typedef struct ObjectPool ObjectPool;
+
+ObjectPool *object_pool_new(size_t);
+void        object_pool_free(ObjectPool *);
+
+void    *object_pool_alloc(ObjectPool *);
+void     object_pool_release(ObjectPool *, void *);
+uint32_t object_pool_count(ObjectPool const *);    // Objects currently alive
+uint32_t object_pool_capacity(ObjectPool const *); // Objects the slabs can hold
+
+// Same as above for pools living in a static variable: the pool is created by
+// the first allocation and kept, slabs included, even once all of its objects
+// have been released so that the next wave of objects reuses them. Freeing
+// it is left to an explicit shutdown.
+void *object_pool_alloc_shared(ObjectPool **, size_t);
+void  object_pool_release_shared(ObjectPool **, void *);
+void  object_pool_free_shared(ObjectPool **); // No-op if the pool was never created
+
+#endif /* ifndef __COLLECTIONS_OBJECT_POOL__H__ */
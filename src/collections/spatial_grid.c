@@ -0,0 +1,220 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "collections/spatial_grid.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPATIAL_GRID_MIN_BUCKET_CAPACITY 4
+
+typedef struct GridEntry {
+  void    *_value;
+  uint32_t _x;
+  uint32_t _y;
+} GridEntry;
+
+// Entries are kept in insertion order inside of a bucket
+typedef struct GridBucket {
+  GridEntry *_entries;
+  uint32_t   _count;
+  uint32_t   _capacity;
+} GridBucket;
+
+struct SpatialGrid {
+  uint32_t    _width;
+  uint32_t    _height;
+  uint32_t    _cell_size;
+  uint32_t    _cells_x;
+  uint32_t    _cells_y;
+  uint32_t    _count;
+  GridBucket *_buckets;
+};
+
+static inline bool spatial_grid_contains_point(SpatialGrid const *grid, uint32_t x, uint32_t y) {
+  return x < grid->_width && y < grid->_height;
+}
+
+static inline GridBucket *spatial_grid_bucket(SpatialGrid const *grid, uint32_t x, uint32_t y) {
+  return &grid->_buckets[(y / grid->_cell_size) + ((size_t)(x / grid->_cell_size) * grid->_cells_y)];
+}
+
+static inline bool spatial_grid_entry_is(GridEntry const *entry, void const *value, uint32_t x, uint32_t y) {
+  return entry->_value == value && entry->_x == x && entry->_y == y;
+}
+
+SpatialGrid *spatial_grid_new(uint32_t width, uint32_t height, uint32_t cell_size) {
+  SpatialGrid *ret = calloc(1, sizeof(SpatialGrid));
+  ret->_width = width;
+  ret->_height = height;
+  ret->_cell_size = cell_size > 0 ? cell_size : 1;
+  ret->_cells_x = (width + ret->_cell_size - 1) / ret->_cell_size;
+  ret->_cells_y = (height + ret->_cell_size - 1) / ret->_cell_size;
+  ret->_count = 0;
+  ret->_buckets = calloc((size_t)ret->_cells_x * ret->_cells_y, sizeof(GridBucket));
+
+  return ret;
+}
+
+void spatial_grid_free(SpatialGrid *grid) {
+  for (size_t i = 0; i < (size_t)grid->_cells_x * grid->_cells_y; i++) {
+    free(grid->_buckets[i]._entries);
+  }
+
+  free(grid->_buckets);
+  free(grid);
+}
+
+inline uint32_t spatial_grid_count(SpatialGrid const *grid) {
+  return grid->_count;
+}
+
+void spatial_grid_insert(SpatialGrid *grid, void *value, uint32_t x, uint32_t y) {
+  if (!spatial_grid_contains_point(grid, x, y)) {
+    return;
+  }
+
+  GridBucket *bucket = spatial_grid_bucket(grid, x, y);
+  if (bucket->_count == bucket->_capacity) {
+    bucket->_capacity = bucket->_capacity > 0 ? bucket->_capacity * 2 : SPATIAL_GRID_MIN_BUCKET_CAPACITY;
+    bucket->_entries = realloc(bucket->_entries, bucket->_capacity * sizeof(GridEntry));
+  }
+
+  bucket->_entries[bucket->_count++] = (GridEntry){._value = value, ._x = x, ._y = y};
+  grid->_count++;
+}
+
+bool spatial_grid_remove(SpatialGrid *grid, void const *value, uint32_t x, uint32_t y) {
+  if (!spatial_grid_contains_point(grid, x, y)) {
+    return false;
+  }
+
+  GridBucket *bucket = spatial_grid_bucket(grid, x, y);
+  for (uint32_t i = 0; i < bucket->_count; i++) {
+    if (spatial_grid_entry_is(&bucket->_entries[i], value, x, y)) {
+      memmove(&bucket->_entries[i], &bucket->_entries[i + 1], (bucket->_count - i - 1) * sizeof(GridEntry));
+      bucket->_count--;
+      grid->_count--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool spatial_grid_move(SpatialGrid *grid, void *value, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  if (!spatial_grid_contains_point(grid, from_x, from_y)) {
+    return false;
+  }
+
+  // Staying in the same cell, only the coordinates need to be updated
+  GridBucket *bucket = spatial_grid_bucket(grid, from_x, from_y);
+  if (spatial_grid_contains_point(grid, to_x, to_y) && bucket == spatial_grid_bucket(grid, to_x, to_y)) {
+    for (uint32_t i = 0; i < bucket->_count; i++) {
+      if (spatial_grid_entry_is(&bucket->_entries[i], value, from_x, from_y)) {
+        bucket->_entries[i]._x = to_x;
+        bucket->_entries[i]._y = to_y;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  if (!spatial_grid_remove(grid, value, from_x, from_y)) {
+    return false;
+  }
+
+  spatial_grid_insert(grid, value, to_x, to_y);
+  return true;
+}
+
+void spatial_grid_clear(SpatialGrid *grid) {
+  for (size_t i = 0; i < (size_t)grid->_cells_x * grid->_cells_y; i++) {
+    grid->_buckets[i]._count = 0;
+  }
+
+  grid->_count = 0;
+}
+
+// Internal method, visits all the entries inside the rectangle (which must be
+// inside the grid), keeping those within radius_squared of the center if
+// check_radius is set.
+size_t spatial_grid_collect(SpatialGrid const *grid, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, bool check_radius,
+                            uint32_t center_x, uint32_t center_y, uint64_t radius_squared, void **buffer, size_t buffer_size) {
+  size_t found = 0;
+
+  for (uint32_t cell_x = from_x / grid->_cell_size; cell_x <= to_x / grid->_cell_size; cell_x++) {
+    for (uint32_t cell_y = from_y / grid->_cell_size; cell_y <= to_y / grid->_cell_size; cell_y++) {
+      GridBucket const *bucket = &grid->_buckets[cell_y + ((size_t)cell_x * grid->_cells_y)];
+
+      for (uint32_t i = 0; i < bucket->_count; i++) {
+        GridEntry const *entry = &bucket->_entries[i];
+        if (entry->_x < from_x || entry->_x > to_x || entry->_y < from_y || entry->_y > to_y) {
+          continue;
+        }
+
+        if (check_radius) {
+          uint64_t delta_x = entry->_x > center_x ? entry->_x - center_x : center_x - entry->_x;
+          uint64_t delta_y = entry->_y > center_y ? entry->_y - center_y : center_y - entry->_y;
+          if ((delta_x * delta_x) + (delta_y * delta_y) > radius_squared) {
+            continue;
+          }
+        }
+
+        if (found < buffer_size) {
+          buffer[found] = entry->_value;
+        }
+        found++;
+      }
+    }
+  }
+
+  return found;
+}
+
+size_t spatial_grid_query_rect(SpatialGrid const *grid, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, void **buffer,
+                               size_t buffer_size) {
+  if (from_x > to_x || from_y > to_y || !spatial_grid_contains_point(grid, from_x, from_y)) {
+    return 0;
+  }
+
+  to_x = to_x < grid->_width ? to_x : grid->_width - 1;
+  to_y = to_y < grid->_height ? to_y : grid->_height - 1;
+
+  return spatial_grid_collect(grid, from_x, from_y, to_x, to_y, false, 0, 0, 0, buffer, buffer_size);
+}
+
+size_t spatial_grid_query_radius(SpatialGrid const *grid, uint32_t x, uint32_t y, uint32_t radius, void **buffer, size_t buffer_size) {
+  if (grid->_width == 0 || grid->_height == 0) {
+    return 0;
+  }
+
+  uint32_t from_x = x > radius ? x - radius : 0;
+  uint32_t from_y = y > radius ? y - radius : 0;
+  uint32_t to_x = (uint64_t)x + radius < grid->_width ? x + radius : grid->_width - 1;
+  uint32_t to_y = (uint64_t)y + radius < grid->_height ? y + radius : grid->_height - 1;
+  if (from_x > to_x || from_y > to_y) {
+    return 0;
+  }
+
+  return spatial_grid_collect(grid, from_x, from_y, to_x, to_y, true, x, y, (uint64_t)radius * radius, buffer, buffer_size);
+}
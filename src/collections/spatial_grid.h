@@ -0,0 +1,57 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __COLLECTIONS_SPATIAL_GRID__H__
+#define __COLLECTIONS_SPATIAL_GRID__H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Uniform grid bucketing values by their position: the plane is split in
+// square cells and each cell holds the values lying inside of it, so that
+// area queries only have to look at the cells overlapping the area.
+//
+// Values are *not* owned by the grid, and the grid does not know where they
+// are: callers must give back the last position they used for a value when
+// moving or removing it.
+typedef struct SpatialGrid SpatialGrid;
+
+// Width, height and size of the cells
+SpatialGrid *spatial_grid_new(uint32_t, uint32_t, uint32_t);
+void         spatial_grid_free(SpatialGrid *);
+
+uint32_t spatial_grid_count(SpatialGrid const *);
+
+// Values outside of the grid are ignored
+void spatial_grid_insert(SpatialGrid *, void *, uint32_t x, uint32_t y);
+bool spatial_grid_remove(SpatialGrid *, void const *, uint32_t x, uint32_t y);
+bool spatial_grid_move(SpatialGrid *, void *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+void spatial_grid_clear(SpatialGrid *);
+
+// Queries store the values they find in the given buffer, without ever going
+// past its size, and return how many values have been found in total (which
+// can be more than the size of the buffer).
+//
+// Rectangles are inclusive, radiuses are euclidean distances.
+size_t spatial_grid_query_rect(SpatialGrid const *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, void **, size_t);
+size_t spatial_grid_query_radius(SpatialGrid const *, uint32_t x, uint32_t y, uint32_t radius, void **, size_t);
+
+#endif /* ifndef __COLLECTIONS_SPATIAL_GRID__H__ */
@@ -0,0 +1,121 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "collections/union_find.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+struct UnionFind {
+  uint32_t *_parents;
+  uint8_t  *_ranks; // Upper bound of the height of each tree
+  uint32_t  _size;
+  uint32_t  _sets;
+};
+
+UnionFind *union_find_new(uint32_t size) {
+  UnionFind *ret = calloc(1, sizeof(UnionFind));
+  ret->_parents = malloc(size * sizeof(uint32_t));
+  ret->_ranks = malloc(size * sizeof(uint8_t));
+  ret->_size = size;
+  union_find_reset(ret);
+  return ret;
+}
+
+void union_find_free(UnionFind *uf) {
+  free(uf->_parents);
+  free(uf->_ranks);
+  free(uf);
+}
+
+inline uint32_t union_find_size(UnionFind const *uf) {
+  return uf->_size;
+}
+
+inline uint32_t union_find_count_sets(UnionFind const *uf) {
+  return uf->_sets;
+}
+
+uint32_t union_find_find(UnionFind *uf, uint32_t element) {
+  uint32_t root = element;
+  while (uf->_parents[root] != root) {
+    root = uf->_parents[root];
+  }
+
+  while (uf->_parents[element] != root) {
+    uint32_t next = uf->_parents[element];
+    uf->_parents[element] = root;
+    element = next;
+  }
+
+  return root;
+}
+
+bool union_find_unite(UnionFind *uf, uint32_t lhs, uint32_t rhs) {
+  lhs = union_find_find(uf, lhs);
+  rhs = union_find_find(uf, rhs);
+  if (lhs == rhs) {
+    return false;
+  }
+
+  // The shallowest tree goes below the other one
+  if (uf->_ranks[lhs] < uf->_ranks[rhs]) {
+    uint32_t swap = lhs;
+    lhs = rhs;
+    rhs = swap;
+  }
+
+  uf->_parents[rhs] = lhs;
+  if (uf->_ranks[lhs] == uf->_ranks[rhs]) {
+    uf->_ranks[lhs]++;
+  }
+
+  uf->_sets--;
+  return true;
+}
+
+inline bool union_find_same(UnionFind *uf, uint32_t lhs, uint32_t rhs) {
+  return union_find_find(uf, lhs) == union_find_find(uf, rhs);
+}
+
+void union_find_reset(UnionFind *uf) {
+  for (uint32_t i = 0; i < uf->_size; i++) {
+    uf->_parents[i] = i;
+    uf->_ranks[i] = 0;
+  }
+
+  uf->_sets = uf->_size;
+}
+
+void union_find_grow(UnionFind *uf, uint32_t size) {
+  if (size <= uf->_size) {
+    return;
+  }
+
+  uf->_parents = realloc(uf->_parents, size * sizeof(uint32_t));
+  uf->_ranks = realloc(uf->_ranks, size * sizeof(uint8_t));
+  for (uint32_t i = uf->_size; i < size; i++) {
+    uf->_parents[i] = i;
+    uf->_ranks[i] = 0;
+  }
+
+  uf->_sets += size - uf->_size;
+  uf->_size = size;
+}
@@ -0,0 +1,47 @@
+// AndiRPG -- Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __COLLECTIONS_UNION_FIND__H__
+#define __COLLECTIONS_UNION_FIND__H__
+
+#include <stdint.h>
+
+// Disjoint sets of the integers [0, size), starting as singletons. Sets can
+// be merged but never split, the only way to split them is to start over.
+// Growing adds new singletons.
+//
+// Finding the set of an element compresses the path to its representative,
+// which is why the queries are not const.
+typedef struct UnionFind UnionFind;
+
+UnionFind *union_find_new(uint32_t);
+void       union_find_free(UnionFind *);
+
+uint32_t union_find_size(UnionFind const *);
+uint32_t union_find_count_sets(UnionFind const *);
+
+uint32_t union_find_find(UnionFind *, uint32_t);
+bool     union_find_unite(UnionFind *, uint32_t, uint32_t); // false if already in the same set
+bool     union_find_same(UnionFind *, uint32_t, uint32_t);
+void     union_find_reset(UnionFind *);
+void     union_find_grow(UnionFind *, uint32_t);
+
+#endif /* ifndef __COLLECTIONS_UNION_FIND__H__ */
@@ -21,9 +21,14 @@
 
 #include "engine.h"
 #include "entity.h"
+#include "flow_field.h"
+#include "fov.h"
+#include "light.h"
 #include "logger.h"
 #include "map.h"
+#include "noise.h"
 #include "serde.h"
+#include "utils.h"
 #include <assert.h>
 #include <msgpack.h>
 #include <msgpack/object.h>
@@ -35,18 +40,53 @@
 #include <string.h>
 #include <sys/types.h>
 
+// How far beyond what the active entity perceives the map is kept in memory
+#define ENGINE_STREAMING_MARGIN 16
+
+// How far the inhuman entities can track the active entity from
+#define ENGINE_CHASE_DISTANCE 32
+
+// Entity types are characters, they are used as indexes of the rates
+#define ENGINE_ENTITY_TYPES (UINT8_MAX + 1)
+
 struct Engine {
-  Map     *_map;
-  uint32_t _current_cycle;
-  Entity  *_active_entity;
+  Map         *_map;
+  uint32_t     _current_cycle;
+  EntityHandle _active_entity; // Invalid once the entity leaves the map
+  NoiseField  *_noise;
+  FlowField   *_chase; // Towards the active entity
+  LightMap    *_light;
+  Fov         *_view; // Of the active entity, lit by _light
+
+  // Needs of the entities of the map grow with the cycles of the engine
+  NeedsRates _needs_rates[ENGINE_ENTITY_TYPES];
 };
 
+// Internal method
+void engine_init_view(Engine *engine) {
+  engine->_light = light_map_new(engine->_map);
+  engine->_view = fov_new();
+  fov_set_light_map(engine->_view, engine->_light);
+}
+
+// Internal method
+void engine_init_needs(Engine *engine) {
+  NeedsRates rates = {.hunger = ENTITY_DEFAULT_NEEDS_RATE, .thirst = ENTITY_DEFAULT_NEEDS_RATE, .tiredness = ENTITY_DEFAULT_NEEDS_RATE};
+  engine->_needs_rates[HUMAN] = rates;
+  engine->_needs_rates[ANIMAL] = rates;
+  map_set_needs_clock(engine->_map, (NeedsClock){.cycle = &engine->_current_cycle, .rates = engine->_needs_rates});
+}
+
 Engine *engine_new(Map *map) {
   LOG_DEBUG("Creating new engine", 0);
   Engine *ret = calloc(1, sizeof(Engine));
   ret->_map = map;
   ret->_current_cycle = 0;
-  ret->_active_entity = nullptr;
+  ret->_active_entity = ENTITY_HANDLE_INVALID;
+  ret->_noise = noise_field_new(map);
+  ret->_chase = flow_field_new(map, ENGINE_CHASE_DISTANCE);
+  engine_init_view(ret);
+  engine_init_needs(ret);
   return ret;
 }
 
@@ -63,7 +103,7 @@ void engine_serialize(Engine *eng, msgpack_sbuffer *buffer) {
 
   if (engine_has_active_entity(eng)) {
     LOG_DEBUG("Engine has active entity", 0);
-    serde_pack_str(&packer, entity_get_name(eng->_active_entity));
+    serde_pack_str(&packer, entity_get_name(engine_get_active_entity(eng)));
   } else {
     LOG_WARNING("No active entity found!", 0);
     msgpack_pack_nil(&packer);
@@ -87,19 +127,28 @@ Engine *engine_deserialize(msgpack_object_map const *map) {
   Engine *engine = calloc(1, sizeof(Engine));
   engine->_current_cycle = *(uint32_t *)serde_map_get(map, MSGPACK_OBJECT_POSITIVE_INTEGER, "current_cycle");
   engine->_map = map_deserialize((msgpack_object_map *)serde_map_get(map, MSGPACK_OBJECT_MAP, "map_object"));
+  engine->_noise = noise_field_new(engine->_map);
+  engine->_chase = flow_field_new(engine->_map, ENGINE_CHASE_DISTANCE);
+  engine_init_view(engine);
+  engine_init_needs(engine);
 
   msgpack_object_str const *active_entity = serde_map_get(map, MSGPACK_OBJECT_STR, "active_entity");
 
   if (active_entity != nullptr) {
-    char entity_name[active_entity->size];
+    char entity_name[active_entity->size + 1];
     memcpy(entity_name, active_entity->ptr, active_entity->size);
-    engine->_active_entity = map_get_entity(engine->_map, entity_name);
+    entity_name[active_entity->size] = '\0';
+    engine->_active_entity = map_get_entity_handle(engine->_map, entity_name);
   }
 
   return engine;
 }
 
 void engine_free(Engine *engine) {
+  noise_field_free(engine->_noise);
+  flow_field_free(engine->_chase);
+  fov_free(engine->_view);
+  light_map_free(engine->_light);
   map_free(engine->_map);
   free(engine);
 }
@@ -108,13 +157,20 @@ inline Map *engine_get_map(Engine const *engine) {
   return engine->_map;
 }
 
-Entity *engine_get_active_entity(Engine const *engine) {
-  Entity *ret = nullptr;
-  if (engine_has_active_entity(engine)) {
-    ret = engine->_active_entity;
-  }
+inline Entity *engine_get_active_entity(Engine const *engine) {
+  return map_get_entity_by_handle(engine->_map, engine->_active_entity);
+}
 
-  return ret;
+inline EntityHandle engine_get_active_handle(Engine const *engine) {
+  return engine->_active_entity;
+}
+
+inline Entity *engine_get_entity(Engine const *engine, EntityHandle handle) {
+  return map_get_entity_by_handle(engine->_map, handle);
+}
+
+inline NoiseField *engine_get_noise_field(Engine const *engine) {
+  return engine->_noise;
 }
 
 inline uint32_t engine_get_current_cycle(Engine const *eng) {
@@ -122,44 +178,66 @@ inline uint32_t engine_get_current_cycle(Engine const *eng) {
 }
 
 inline bool engine_has_active_entity(Engine const *engine) {
-  return engine->_active_entity != nullptr;
+  return map_is_entity_handle_valid(engine->_map, engine->_active_entity);
+}
+
+// Internal method, keeps in memory the chunks of the map that the active
+// entity can perceive, plus some margin so that they are loaded before the
+// entity actually gets there.
+void engine_stream_around_active_entity(Engine *engine) {
+  Entity const *active = engine_get_active_entity(engine);
+  Point         coords = entity_get_position(active);
+  uint32_t      radius = max(entity_get_seeing_distance(active), entity_get_hearing_distance(active)) + ENGINE_STREAMING_MARGIN;
+
+  map_stream_around(engine->_map, coords.x, coords.y, radius);
+}
+
+// Internal method, nothing is computed if neither the light nor the tiles
+// around the active entity changed since the last time.
+void engine_update_view(Engine *engine) {
+  if (engine_has_active_entity(engine)) {
+    light_map_update(engine->_light);
+    fov_compute_for_entity(engine->_view, engine->_map, engine_get_active_entity(engine));
+  }
 }
 
 void engine_set_active_entity(Engine *engine, const char *name) {
   LOG_DEBUG("Setting active entity: '%s'", name);
-  if (map_contains_entity(engine->_map, name)) {
-    engine->_active_entity = map_get_entity(engine->_map, name);
-  } else {
+  engine_set_active_handle(engine, map_get_entity_handle(engine->_map, name));
+  if (!engine_has_active_entity(engine)) {
     LOG_WARNING("Engine does not have entity '%s'", name);
-    engine->_active_entity = nullptr;
+  }
+}
+
+void engine_set_active_handle(Engine *engine, EntityHandle handle) {
+  engine->_active_entity = handle;
+  if (engine_has_active_entity(engine)) {
+    engine_stream_around_active_entity(engine);
+    engine_update_view(engine);
   }
 }
 
 inline void engine_clear_active_entity(Engine *engine) {
-  engine->_active_entity = nullptr;
+  engine->_active_entity = ENTITY_HANDLE_INVALID;
 }
 
 void engine_move_entity(Engine const *engine, Entity *entity, uint32_t delta_x, uint32_t delta_y) {
-
-  MapBoundaries boundaries = map_get_boundaries(engine->_map);
-  Point const  *current = entity_get_coords(entity);
   LOG_DEBUG("Moving entity '%s' (%d, %d)", entity_get_name(entity), delta_x, delta_y);
 
-  if (!map_is_tile_free(engine->_map, point_get_x(current) + delta_x, point_get_y(current) + delta_y)) {
-    LOG_WARNING("Entity '%s' wants to move to an occupied tile!", entity_get_name(entity));
+  if (!map_move_entity(engine->_map, entity, delta_x, delta_y)) {
+    LOG_WARNING("Entity '%s' cannot move to the requested tile!", entity_get_name(entity));
     return;
   }
 
-  if (point_get_x(current) + delta_x >= 0 && point_get_x(current) + delta_x < boundaries.x) {
-    if (point_get_y(current) + delta_y >= 0 && point_get_y(current) + delta_y < boundaries.y) {
-      entity_move(entity, delta_x, delta_y);
-    }
-  }
+  Point coords = entity_get_position(entity);
+  noise_field_emit_movement(engine->_noise, coords.x, coords.y);
 }
 
 void engine_move_active_entity(Engine *engine, uint32_t delta_x, uint32_t delta_y) {
   if (engine_has_active_entity(engine)) {
-    engine_move_entity(engine, engine->_active_entity, delta_x, delta_y);
+    engine_move_entity(engine, engine_get_active_entity(engine), delta_x, delta_y);
+    engine_stream_around_active_entity(engine);
+    engine_update_view(engine);
   }
 }
 
@@ -216,34 +294,79 @@ void engine_handle_keypress(Engine *engine, char key) {
       break;
   }
 
+  // Needs of the entities follow the cycles
   engine->_current_cycle++;
+  engine_update_view(engine);
+}
+
+void engine_set_needs_rates(Engine *engine, EntityType type, NeedsRates rates) {
+  map_settle_needs(engine->_map, type);
+  engine->_needs_rates[(uint8_t)type] = rates;
+}
+
+inline NeedsRates engine_get_needs_rates(Engine const *engine, EntityType type) {
+  return engine->_needs_rates[(uint8_t)type];
 }
 
 bool entities_are_close(Entity const *lhs, Entity const *rhs) {
-  Point const *lhs_coords = entity_get_coords(lhs);
-  Point const *rhs_coords = entity_get_coords(rhs);
+  Point lhs_coords = entity_get_position(lhs);
+  Point rhs_coords = entity_get_position(rhs);
 
-  uint32_t delta_x = point_get_x(lhs_coords) > point_get_x(rhs_coords) ? point_get_x(lhs_coords) - point_get_x(rhs_coords)
-                                                                       : point_get_x(rhs_coords) - point_get_x(lhs_coords);
-  uint32_t delta_y = point_get_y(lhs_coords) > point_get_y(rhs_coords) ? point_get_y(lhs_coords) - point_get_y(rhs_coords)
-                                                                       : point_get_y(rhs_coords) - point_get_y(lhs_coords);
+  uint32_t delta_x = lhs_coords.x > rhs_coords.x ? lhs_coords.x - rhs_coords.x : rhs_coords.x - lhs_coords.x;
+  uint32_t delta_y = lhs_coords.y > rhs_coords.y ? lhs_coords.y - rhs_coords.y : rhs_coords.y - lhs_coords.y;
 
   return delta_y < 2 && delta_x < 2;
 }
 
-// Move all entities apart from the active one
+// Internal method, moves an inhuman entity one step closer to the active
+// entity. Returns false if the entity is too far away to chase it.
+bool engine_chase_active_entity(Engine const *engine, Entity *entity) {
+  Point    coords = entity_get_position(entity);
+  uint32_t cur_x = coords.x;
+  uint32_t cur_y = coords.y;
+  if (flow_field_get_distance(engine->_chase, cur_x, cur_y) == FLOW_FIELD_UNREACHABLE) {
+    return false;
+  }
+
+  // Entities blocked by the others just wait for their turn
+  uint32_t next_x;
+  uint32_t next_y;
+  if (flow_field_next_step(engine->_chase, cur_x, cur_y, &next_x, &next_y)) {
+    engine_move_entity(engine, entity, next_x - cur_x, next_y - cur_y);
+  }
+
+  return true;
+}
+
+// Move all entities apart from the active one, the inhuman ones chase the
+// active entity when they are close enough.
 void engine_move_all_entities(Engine const *engine) {
   LOG_DEBUG("Moving all entities", 0);
-  Entity **all_entities = map_get_all_entities(engine->_map);
+  EntitySpan entities = map_get_entity_span(engine->_map);
+  Entity    *active = engine_get_active_entity(engine);
+
+  // The same flow field is shared by all the chasers, it is only computed
+  // again when the active entity moves.
+  flow_field_clear_goals(engine->_chase);
+  if (active != nullptr) {
+    Point active_coords = entity_get_position(active);
+    flow_field_add_goal(engine->_chase, active_coords.x, active_coords.y);
+  }
+  flow_field_compute(engine->_chase);
+
+  // Moving entities does not change the table, the span stays valid
+  for (Entity **current = entities.begin; current != entities.end; current++) {
+    Entity *current_entity = *current;
 
-  for (uint32_t i = 0; i < map_count_entities(engine->_map); i++) {
-    Entity *current_entity = all_entities[i];
+    if ((current_entity != active) && entity_can_move(current_entity)) {
+      if (entity_get_entity_type(current_entity) == INHUMAN && engine_chase_active_entity(engine, current_entity)) {
+        continue;
+      }
 
-    if ((current_entity != engine->_active_entity) && entity_can_move(current_entity)) {
-      Point const *current_coords = entity_get_coords(current_entity);
+      Point current_coords = entity_get_position(current_entity);
 
-      uint32_t cur_x = point_get_x(current_coords);
-      uint32_t cur_y = point_get_y(current_coords);
+      uint32_t cur_x = current_coords.x;
+      uint32_t cur_y = current_coords.y;
       uint32_t random_x = (random() % 3) - 1;
       uint32_t random_y = (random() % 3) - 1;
       LOG_INFO("Randomly moving entity '%s' (%d:%d)", entity_get_name(current_entity), random_x, random_y);
@@ -263,26 +386,30 @@ Entity **engine_get_close_entities(Engine const *engine, ssize_t *size) {
   Entity **ret = nullptr;
 
   Entity const *active = engine_get_active_entity(engine);
-  Entity      **all_entities = map_get_all_entities(engine_get_map(engine));
+  Point         coords = entity_get_position(active);
+  uint32_t      x = coords.x;
+  uint32_t      y = coords.y;
   *size = 0;
 
-  for (uint32_t i = 0; i < map_count_entities(engine_get_map(engine)); i++) {
-    if (all_entities[i] == active) {
+  // There can only be one entity per tile, so at most 9 of them around
+  Entity *around[9];
+  size_t  found = map_get_entities_in_rect(engine_get_map(engine), x > 0 ? x - 1 : 0, y > 0 ? y - 1 : 0, x + 1, y + 1, around, 9);
+
+  for (size_t i = 0; i < found && i < 9; i++) {
+    if (around[i] == active) {
       continue;
     }
 
-    if (entities_are_close(active, all_entities[i])) {
-      (*size)++;
-      ret = realloc(ret, *size * sizeof(Entity *));
-      ret[*size - 1] = all_entities[i];
-    }
+    (*size)++;
+    ret = realloc(ret, *size * sizeof(Entity *));
+    ret[*size - 1] = around[i];
   }
 
   return ret;
 }
 
-inline void engine_add_entity(Engine *engine, Entity *ent) {
-  map_add_entity(engine->_map, ent);
+inline bool engine_add_entity(Engine *engine, Entity *ent) {
+  return map_add_entity(engine->_map, ent);
 }
 
 void engine_entity_attack(Engine *engine, Entity *lhs, Entity *rhs) {
@@ -290,6 +417,25 @@ void engine_entity_attack(Engine *engine, Entity *lhs, Entity *rhs) {
   if (entities_are_close(lhs, rhs)) {
     LOG_DEBUG("Entities are close, attack is successful", 0);
     entity_hurt(rhs, 1);
+
+    Point coords = entity_get_position(lhs);
+    noise_field_emit(engine->_noise, coords.x, coords.y, NOISE_COMBAT_LOUDNESS);
   }
 }
 
+inline LightMap *engine_get_light_map(Engine const *engine) {
+  return engine->_light;
+}
+
+inline bool engine_active_entity_can_see(Engine const *engine, uint32_t x, uint32_t y) {
+  return engine_has_active_entity(engine) && fov_is_visible(engine->_view, x, y);
+}
+
+inline void engine_propagate_noise(Engine const *engine) {
+  noise_field_propagate(engine->_noise);
+}
+
+inline bool engine_entity_can_hear(Engine const *engine, Entity const *entity) {
+  return noise_field_can_hear(engine->_noise, entity);
+}
+
@@ -23,7 +23,9 @@
 #define __ENGINE__H__
 
 #include "entity.h"
+#include "light.h"
 #include "map.h"
+#include "noise.h"
 #include <msgpack/object.h>
 #include <msgpack/sbuffer.h>
 #include <stdint.h>
@@ -38,22 +40,44 @@ Engine *engine_deserialize(msgpack_object_map const *);
 void    engine_free(Engine *);
 
 // Getters
-Map     *engine_get_map(Engine const *);
-Entity  *engine_get_active_entity(Engine const *);
-uint32_t engine_get_current_cycle(Engine const *);
-bool     engine_has_active_entity(Engine const *);
+Map        *engine_get_map(Engine const *);
+NoiseField *engine_get_noise_field(Engine const *);
+Entity     *engine_get_active_entity(Engine const *);
+uint32_t    engine_get_current_cycle(Engine const *);
+bool        engine_has_active_entity(Engine const *);
 
 // Setters
 void engine_set_active_entity(Engine *, const char *);
 void engine_clear_active_entity(Engine *);
 
+// Handle based versions
+EntityHandle engine_get_active_handle(Engine const *);
+Entity      *engine_get_entity(Engine const *, EntityHandle);
+void         engine_set_active_handle(Engine *, EntityHandle);
+
 // Methods
 void     engine_handle_keypress(Engine *, char);
 void     engine_move_all_entities(Engine const *);
 Entity **engine_get_close_entities(Engine const *, ssize_t *);
 
 // Entities
-void engine_add_entity(Engine *, Entity *);
+bool engine_add_entity(Engine *, Entity *);
 void engine_entity_attack(Engine *, Entity *, Entity *);
 
+// Needs of the entities of the map grow by the rates of their type at every
+// cycle of the engine, see NeedsRates.
+void       engine_set_needs_rates(Engine *, EntityType, NeedsRates);
+NeedsRates engine_get_needs_rates(Engine const *, EntityType);
+
+// Noises made by the entities (moving, fighting) during a cycle are heard
+// only once they have been propagated, at the end of the cycle.
+void engine_propagate_noise(Engine const *);
+bool engine_entity_can_hear(Engine const *, Entity const *);
+
+// What the active entity sees, lit by the light map of the engine. Light
+// sources added to it are taken into account once the active entity moves or
+// at the end of the cycle.
+LightMap *engine_get_light_map(Engine const *);
+bool      engine_active_entity_can_see(Engine const *, uint32_t x, uint32_t y);
+
 #endif
@@ -21,6 +21,7 @@
 
 #include "entity.h"
 #include "collections/linked_list.h"
+#include "collections/object_pool.h"
 #include "item.h"
 #include "logger.h"
 #include "perk.h"
@@ -47,6 +48,43 @@
     return self->_##prop_name;                              \
   }
 
+#define GENERATE_NEED_ACCESSORS(need)                                                                     \
+  inline uint32_t entity_get_##need(Entity const *self) {                                                 \
+    EntityStats const *store = self->_store;                                                              \
+    if (store == nullptr) {                                                                               \
+      return self->_own._##need;                                                                          \
+    }                                                                                                     \
+                                                                                                          \
+    size_t slot = self->_stats;                                                                           \
+    if (store->_clock.cycle == nullptr || store->_lp[slot] == 0) {                                        \
+      return store->_##need[slot];                                                                        \
+    }                                                                                                     \
+                                                                                                          \
+    return entity_compute_need(store->_##need[slot], *store->_clock.cycle - store->_##need##_since[slot], \
+                               store->_clock.rates[(uint8_t)store->_types[slot]].need);                   \
+  }                                                                                                       \
+                                                                                                          \
+  inline void entity_set_##need(Entity *self, uint32_t val) {                                             \
+    if (self->_store == nullptr) {                                                                        \
+      self->_own._##need = val;                                                                           \
+      return;                                                                                             \
+    }                                                                                                     \
+                                                                                                          \
+    self->_store->_##need[self->_stats] = val;                                                            \
+    self->_store->_##need##_since[self->_stats] = entity_stats_get_cycle(self->_store);                   \
+  }                                                                                                       \
+                                                                                                          \
+  void entity_increment_##need(Entity *self) {                                                            \
+    uint32_t current = entity_get_##need(self);                                                           \
+    entity_set_##need(self, current < UINT32_MAX ? current + 1 : current);                                \
+  }
+
+// Hot stat of an entity, wherever it is stored. Needs have their own accessors.
+#define entity_stat(entity, stat) \
+  (*((entity)->_store != nullptr ? &(entity)->_store->_##stat[(entity)->_stats] : &(entity)->_own._##stat))
+
+#define MIN_STATS_CAPACITY 16
+
 typedef struct Equipment {
   Item *_head;
   Item *_neck;
@@ -58,28 +96,60 @@ typedef struct Equipment {
   Item *_right_foot;
 } Equipment;
 
+// Store behind EntityStatsView, one per map. Slot i belongs to _owners[i],
+// whose _stats is i.
+struct EntityStats {
+  uint32_t   *_lp;
+  uint32_t   *_starting_lp;
+  uint32_t   *_hunger;
+  uint32_t   *_hunger_since;
+  uint32_t   *_thirst;
+  uint32_t   *_thirst_since;
+  uint32_t   *_tiredness;
+  uint32_t   *_tiredness_since;
+  EntityType *_types;
+  Entity    **_owners;
+  size_t      _size;
+  size_t      _capacity;
+  NeedsClock  _clock; // Needs do not grow without cycle
+};
+
+// Stats of an entity which is not part of a map, its needs do not grow
+typedef struct EntityInlineStats {
+  uint32_t _lp;
+  uint32_t _starting_lp;
+  uint32_t _hunger;
+  uint32_t _thirst;
+  uint32_t _tiredness;
+} EntityInlineStats;
+
+// Entities and their equipment are carved out of slabs instead of being
+// allocated one by one, spawning and despawning waves of them is frequent.
+// The slabs are kept until entity_shutdown(), the pools are not locked so
+// entities must only be created and freed by the main thread.
+static ObjectPool *entity_pool = nullptr;
+static ObjectPool *equipment_pool = nullptr;
+
 struct Entity {
-  uint32_t    _lp;
-  uint32_t    _starting_lp;
-  uint32_t    _mental_health;
-  uint32_t    _starting_mental_health;
-  uint32_t    _hunger;
-  uint32_t    _thirst;
-  uint32_t    _tiredness;
-  uint32_t    _xp;
-  uint32_t    _current_level;
-  uint32_t    _hearing_distance;
-  uint32_t    _seeing_distance;
-  EntityType  _type;
-  char       *_name;
-  Point      *_coords;
-  Item      **_inventory;
-  LinkedList *_perks;
-  Equipment  *_equipment;
+  EntityStats      *_store; // Of the map of the entity, nullptr outside of maps
+  uint32_t          _stats; // Slot of the hot stats in _store
+  EntityInlineStats _own;   // Hot stats while _store is nullptr
+  uint32_t          _mental_health;
+  uint32_t          _starting_mental_health;
+  uint32_t          _xp;
+  uint32_t          _current_level;
+  uint32_t          _hearing_distance;
+  uint32_t          _seeing_distance;
+  EntityType        _type;
+  char             *_name;
+  Point             _coords;
+  Item            **_inventory;
+  LinkedList       *_perks;
+  Equipment        *_equipment;
 };
 
 Equipment *equipment_new() {
-  Equipment *self = calloc(1, sizeof(Equipment));
+  Equipment *self = object_pool_alloc_shared(&equipment_pool, sizeof(Equipment));
   self->_head = nullptr;
   self->_neck = nullptr;
   self->_torso = nullptr;
@@ -105,6 +175,8 @@ void equipment_free(Equipment *self) {
   free_nonnull(self->_legs);
   free_nonnull(self->_left_foot);
   free_nonnull(self->_right_foot);
+
+  object_pool_release_shared(&equipment_pool, self);
 }
 
 void equipment_serialize(Equipment const *self, msgpack_sbuffer *buffer) {
@@ -196,6 +268,167 @@ EQUIPMENT_GETTER(right_foot);
 EQUIPMENT_SETTER(right_foot);
 EQUIPMENT_CLEARER(right_foot);
 
+EntityStats *entity_stats_new(uint32_t reserved_entities) {
+  EntityStats *stats = calloc(1, sizeof(EntityStats));
+  entity_stats_reserve(stats, reserved_entities);
+
+  return stats;
+}
+
+void entity_stats_free(EntityStats *stats) {
+  // Starting from the end, nothing has to be moved
+  while (stats->_size > 0) {
+    entity_stats_detach(stats->_owners[stats->_size - 1]);
+  }
+
+  free(stats->_lp);
+  free(stats->_starting_lp);
+  free(stats->_hunger);
+  free(stats->_hunger_since);
+  free(stats->_thirst);
+  free(stats->_thirst_since);
+  free(stats->_tiredness);
+  free(stats->_tiredness_since);
+  free(stats->_types);
+  free(stats->_owners);
+  free(stats);
+}
+
+void entity_stats_reserve(EntityStats *stats, uint32_t capacity) {
+  if (capacity <= stats->_capacity) {
+    return;
+  }
+
+  stats->_capacity = capacity;
+  stats->_lp = realloc(stats->_lp, stats->_capacity * sizeof(uint32_t));
+  stats->_starting_lp = realloc(stats->_starting_lp, stats->_capacity * sizeof(uint32_t));
+  stats->_hunger = realloc(stats->_hunger, stats->_capacity * sizeof(uint32_t));
+  stats->_hunger_since = realloc(stats->_hunger_since, stats->_capacity * sizeof(uint32_t));
+  stats->_thirst = realloc(stats->_thirst, stats->_capacity * sizeof(uint32_t));
+  stats->_thirst_since = realloc(stats->_thirst_since, stats->_capacity * sizeof(uint32_t));
+  stats->_tiredness = realloc(stats->_tiredness, stats->_capacity * sizeof(uint32_t));
+  stats->_tiredness_since = realloc(stats->_tiredness_since, stats->_capacity * sizeof(uint32_t));
+  stats->_types = realloc(stats->_types, stats->_capacity * sizeof(EntityType));
+  stats->_owners = realloc(stats->_owners, stats->_capacity * sizeof(Entity *));
+}
+
+// Internal method, cycle the needs of the store are at
+static inline uint32_t entity_stats_get_cycle(EntityStats const *stats) {
+  return stats->_clock.cycle != nullptr ? *stats->_clock.cycle : 0;
+}
+
+uint32_t entity_stats_attach(EntityStats *stats, Entity *entity) {
+  assert(entity->_store == nullptr);
+  if (stats->_size == stats->_capacity) {
+    entity_stats_reserve(stats, max(stats->_capacity * 2, MIN_STATS_CAPACITY));
+  }
+
+  size_t   slot = stats->_size++;
+  uint32_t cycle = entity_stats_get_cycle(stats);
+  stats->_lp[slot] = entity->_own._lp;
+  stats->_starting_lp[slot] = entity->_own._starting_lp;
+  stats->_hunger[slot] = entity->_own._hunger;
+  stats->_hunger_since[slot] = cycle;
+  stats->_thirst[slot] = entity->_own._thirst;
+  stats->_thirst_since[slot] = cycle;
+  stats->_tiredness[slot] = entity->_own._tiredness;
+  stats->_tiredness_since[slot] = cycle;
+  stats->_types[slot] = entity->_type;
+  stats->_owners[slot] = entity;
+  entity->_store = stats;
+  entity->_stats = slot;
+
+  return slot;
+}
+
+// The last slot takes the place of the one of the entity
+void entity_stats_detach(Entity *entity) {
+  EntityStats *stats = entity->_store;
+  size_t       slot = entity->_stats;
+  entity->_own = (EntityInlineStats){
+    ._lp = stats->_lp[slot],
+    ._starting_lp = stats->_starting_lp[slot],
+    ._hunger = entity_get_hunger(entity),
+    ._thirst = entity_get_thirst(entity),
+    ._tiredness = entity_get_tiredness(entity),
+  };
+  entity->_store = nullptr;
+
+  size_t last = --stats->_size;
+  if (slot != last) {
+    stats->_lp[slot] = stats->_lp[last];
+    stats->_starting_lp[slot] = stats->_starting_lp[last];
+    stats->_hunger[slot] = stats->_hunger[last];
+    stats->_hunger_since[slot] = stats->_hunger_since[last];
+    stats->_thirst[slot] = stats->_thirst[last];
+    stats->_thirst_since[slot] = stats->_thirst_since[last];
+    stats->_tiredness[slot] = stats->_tiredness[last];
+    stats->_tiredness_since[slot] = stats->_tiredness_since[last];
+    stats->_types[slot] = stats->_types[last];
+    stats->_owners[slot] = stats->_owners[last];
+    stats->_owners[slot]->_stats = slot;
+  }
+}
+
+EntityStatsView entity_stats_get_view(EntityStats const *stats) {
+  return (EntityStatsView){
+    .size = stats->_size,
+    .life_points = stats->_lp,
+    .starting_life_points = stats->_starting_lp,
+    .hunger = stats->_hunger,
+    .hunger_since = stats->_hunger_since,
+    .thirst = stats->_thirst,
+    .thirst_since = stats->_thirst_since,
+    .tiredness = stats->_tiredness,
+    .tiredness_since = stats->_tiredness_since,
+    .types = stats->_types,
+    .entities = stats->_owners,
+  };
+}
+
+// Internal method, current value of a need which was worth value some cycles
+// ago, the entity being alive.
+static inline uint32_t entity_compute_need(uint32_t value, uint32_t cycles, uint32_t rate) {
+  uint64_t need = value + (uint64_t)rate * cycles;
+  return need > UINT32_MAX ? UINT32_MAX : need;
+}
+
+GENERATE_NEED_ACCESSORS(hunger);
+GENERATE_NEED_ACCESSORS(thirst);
+GENERATE_NEED_ACCESSORS(tiredness);
+
+// Internal method, writes the current values of the needs, which must be
+// done before they start growing differently (the entity dies or comes back
+// to life, the rates change).
+void entity_settle_needs(Entity *entity) {
+  entity_set_hunger(entity, entity_get_hunger(entity));
+  entity_set_thirst(entity, entity_get_thirst(entity));
+  entity_set_tiredness(entity, entity_get_tiredness(entity));
+}
+
+void entity_stats_set_needs_clock(EntityStats *stats, NeedsClock clock) {
+  for (size_t i = 0; i < stats->_size; i++) {
+    entity_settle_needs(stats->_owners[i]);
+  }
+
+  // The settled values are the ones of the new cycle
+  stats->_clock = clock;
+  uint32_t cycle = entity_stats_get_cycle(stats);
+  for (size_t i = 0; i < stats->_size; i++) {
+    stats->_hunger_since[i] = cycle;
+    stats->_thirst_since[i] = cycle;
+    stats->_tiredness_since[i] = cycle;
+  }
+}
+
+void entity_stats_settle_needs(EntityStats *stats, EntityType type) {
+  for (size_t i = 0; i < stats->_size; i++) {
+    if (stats->_types[i] == type) {
+      entity_settle_needs(stats->_owners[i]);
+    }
+  }
+}
+
 EntityBuilder *eb_with_type(EntityBuilder *self, EntityType type) {
   self->type = type;
   return self;
@@ -266,24 +499,27 @@ Entity *eb_build(EntityBuilder *self, bool oneshot) {
     panic("Cannot build an entity without a name!", EC_ENTITY_EMPTY_NAME);
   }
 
-  Entity *ent = calloc(1, sizeof(Entity));
-  ent->_lp = self->life_points;
-  ent->_starting_lp = self->life_points;
+  Entity *ent = object_pool_alloc_shared(&entity_pool, sizeof(Entity));
+  ent->_store = nullptr;
+  ent->_own = (EntityInlineStats){
+    ._lp = self->life_points,
+    ._starting_lp = self->life_points,
+    ._hunger = self->hunger,
+    ._thirst = self->thirst,
+    ._tiredness = self->tiredness,
+  };
   ent->_mental_health = self->mental_health;
   ent->_starting_mental_health = self->mental_health;
-  ent->_hunger = self->hunger;
-  ent->_thirst = self->thirst;
-  ent->_tiredness = self->tiredness;
   ent->_xp = self->xp;
   ent->_current_level = self->level;
   ent->_hearing_distance = self->hearing_distance;
   ent->_seeing_distance = self->seeing_distance;
   ent->_type = self->type;
   ent->_name = strdup(self->name);
-  ent->_coords = point_new(self->x, self->y);
+  ent->_coords = point_at(self->x, self->y);
   ent->_inventory = calloc(1, sizeof(Item *));
   ent->_inventory[0] = nullptr;
-  ent->_perks = linked_list_new(32, (FreeFunction)&perk_free);
+  ent->_perks = linked_list_new(0, (FreeFunction)&perk_free); // Most entities never get a perk
   ent->_equipment = equipment_new();
 
   if (oneshot) {
@@ -396,19 +632,21 @@ Entity *entity_deserialize(msgpack_object_map const *map) {
   msgpack_object_array const *coords_array = serde_map_get(map, MSGPACK_OBJECT_ARRAY, "coords");
   assert(coords_array->size == 2);
 
-  Point *coords = point_new(coords_array->ptr[0].via.u64, coords_array->ptr[1].via.u64);
+  Point coords = point_at(coords_array->ptr[0].via.u64, coords_array->ptr[1].via.u64);
 
-  Entity *entity = calloc(1, sizeof(Entity));
+  Entity *entity = object_pool_alloc_shared(&entity_pool, sizeof(Entity));
+  entity->_store = nullptr;
 
-#define assign(t) entity->_##t = t
+#define assign(t)      entity->_##t = t
+#define assign_stat(t) entity->_own._##t = t
 
-  assign(lp);
-  assign(starting_lp);
+  assign_stat(lp);
+  assign_stat(starting_lp);
   assign(mental_health);
   assign(starting_mental_health);
-  assign(hunger);
-  assign(thirst);
-  assign(tiredness);
+  assign_stat(hunger);
+  assign_stat(thirst);
+  assign_stat(tiredness);
   assign(xp);
   assign(current_level);
   assign(hearing_distance);
@@ -433,7 +671,7 @@ Entity *entity_deserialize(msgpack_object_map const *map) {
   }
 
   msgpack_object_array const *perks = serde_map_get(map, MSGPACK_OBJECT_ARRAY, "perks");
-  entity->_perks = linked_list_new(32, (FreeFunction)&perk_free);
+  entity->_perks = linked_list_new(perks->size, (FreeFunction)&perk_free);
   for (uint i = 0; i < perks->size; i++) {
     linked_list_add(entity->_perks, perk_deserialize(&(perks->ptr[i].via.map)));
   }
@@ -451,13 +689,21 @@ void entity_serialize(Entity const *ent, msgpack_sbuffer *buffer) {
   serde_pack_str(&packer, #t); \
   msgpack_pack_uint##s(&packer, ent->_##t);
 
-  PACK_UINT(lp, 32);
-  PACK_UINT(starting_lp, 32);
+#define PACK_STAT(t)           \
+  serde_pack_str(&packer, #t); \
+  msgpack_pack_uint32(&packer, entity_stat(ent, t));
+
+#define PACK_NEED(t)           \
+  serde_pack_str(&packer, #t); \
+  msgpack_pack_uint32(&packer, entity_get_##t(ent));
+
+  PACK_STAT(lp);
+  PACK_STAT(starting_lp);
   PACK_UINT(mental_health, 32);
   PACK_UINT(starting_mental_health, 32);
-  PACK_UINT(hunger, 32);
-  PACK_UINT(thirst, 32);
-  PACK_UINT(tiredness, 32);
+  PACK_NEED(hunger);
+  PACK_NEED(thirst);
+  PACK_NEED(tiredness);
   PACK_UINT(xp, 32);
   PACK_UINT(current_level, 32);
   PACK_UINT(hearing_distance, 32);
@@ -469,8 +715,8 @@ void entity_serialize(Entity const *ent, msgpack_sbuffer *buffer) {
 
   serde_pack_str(&packer, "coords");
   msgpack_pack_array(&packer, 2);
-  msgpack_pack_uint32(&packer, point_get_x(ent->_coords));
-  msgpack_pack_uint32(&packer, point_get_y(ent->_coords));
+  msgpack_pack_uint32(&packer, ent->_coords.x);
+  msgpack_pack_uint32(&packer, ent->_coords.y);
 
   serde_pack_str(&packer, "equipment");
   equipment_serialize(ent->_equipment, buffer);
@@ -491,32 +737,40 @@ void entity_serialize(Entity const *ent, msgpack_sbuffer *buffer) {
 }
 
 void entity_free(Entity *entity) {
-  free(entity->_name);
-
-  point_free(entity->_coords);
+  if (entity->_store != nullptr) {
+    entity_stats_detach(entity);
+  }
 
+  // The name is still logged while clearing the inventory
   entity_inventory_clear(entity);
   free(entity->_inventory);
+  free(entity->_name);
 
   linked_list_free(entity->_perks);
   equipment_free(entity->_equipment);
 
-  free(entity);
+  object_pool_release_shared(&entity_pool, entity);
+}
+
+void entity_shutdown() {
+  object_pool_free_shared(&entity_pool);
+  object_pool_free_shared(&equipment_pool);
+}
+
+uint32_t entity_get_pool_capacity() {
+  return entity_pool != nullptr ? object_pool_capacity(entity_pool) : 0;
 }
 
 inline uint32_t entity_get_life_points(Entity const *entity) {
-  return entity->_lp;
+  return entity_stat(entity, lp);
 }
 
 inline uint32_t entity_get_starting_life_points(Entity const *entity) {
-  return entity->_starting_lp;
+  return entity_stat(entity, starting_lp);
 }
 
 GENERATE_GETTER(uint32_t, mental_health);
 GENERATE_GETTER(uint32_t, starting_mental_health);
-GENERATE_GETTER(uint32_t, hunger);
-GENERATE_GETTER(uint32_t, thirst);
-GENERATE_GETTER(uint32_t, tiredness);
 GENERATE_GETTER(uint32_t, xp);
 GENERATE_GETTER(uint32_t, current_level);
 GENERATE_GETTER(uint32_t, hearing_distance);
@@ -527,7 +781,14 @@ inline EntityType entity_get_entity_type(Entity const *entity) {
 }
 
 GENERATE_GETTER(char const *, name);
-GENERATE_GETTER(Point const *, coords);
+
+inline Point const *entity_get_coords(Entity const *entity) {
+  return &entity->_coords;
+}
+
+inline Point entity_get_position(Entity const *entity) {
+  return entity->_coords;
+}
 
 bool entity_can_move(Entity const *ent) {
   bool ret = true;
@@ -548,7 +809,7 @@ bool entity_can_move(Entity const *ent) {
 }
 
 inline bool entity_is_alive(Entity const *entity) {
-  return entity->_lp > 0;
+  return entity_stat(entity, lp) > 0;
 }
 
 inline bool entity_is_dead(Entity const *entity) {
@@ -565,16 +826,18 @@ inline bool entity_is_crazy(Entity const *entity) {
 
 void entity_move(Entity *entity, uint32_t delta_x, uint32_t delta_y) {
   if (entity_can_move(entity)) {
-    point_set_x(entity->_coords, point_get_x(entity->_coords) + delta_x);
-    point_set_y(entity->_coords, point_get_y(entity->_coords) + delta_y);
+    entity->_coords.x += delta_x;
+    entity->_coords.y += delta_y;
   }
 }
 
 void entity_hurt(Entity *entity, uint32_t life_points) {
-  if (life_points > entity->_lp) {
-    entity->_lp = 0;
+  uint32_t *lp = &entity_stat(entity, lp);
+  if (life_points >= *lp) {
+    entity_settle_needs(entity);
+    *lp = 0;
   } else {
-    entity->_lp -= life_points;
+    *lp -= life_points;
   }
 }
 
@@ -587,8 +850,9 @@ void entity_mental_hurt(Entity *entity, uint32_t mental_damage) {
 }
 
 void entity_heal(Entity *entity, uint32_t life_points) {
-  if (entity->_lp > 0) {
-    entity->_lp = min(entity->_starting_lp, entity->_lp + life_points);
+  uint32_t *lp = &entity_stat(entity, lp);
+  if (*lp > 0) {
+    *lp = min(entity_stat(entity, starting_lp), *lp + life_points);
   }
 }
 
@@ -602,25 +866,11 @@ void entity_mental_heal(Entity *entity, uint32_t mental_heal) {
 void entity_resurrect(Entity *entity) {
   if (entity_get_entity_type(entity) == INHUMAN && entity_is_dead(entity)) {
     LOG_INFO("Resurrecting '%s'", entity_get_name(entity));
-    entity->_lp = entity->_starting_lp;
+    entity_settle_needs(entity);
+    entity_stat(entity, lp) = entity_stat(entity, starting_lp);
   }
 }
 
-void entity_increment_hunger(Entity *entity) {
-  entity->_hunger++;
-}
-
-void entity_increment_thirst(Entity *entity) {
-  entity->_thirst++;
-}
-
-void entity_increment_tiredness(Entity *entity) {
-  entity->_tiredness++;
-}
-
-GENERATE_SETTER(hunger);
-GENERATE_SETTER(thirst);
-GENERATE_SETTER(tiredness);
 GENERATE_SETTER(xp);
 GENERATE_SETTER(current_level);
 
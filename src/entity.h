@@ -72,6 +72,72 @@ typedef struct EntityBuilder {
   Entity *(*build)(struct EntityBuilder *, bool oneshot);
 } EntityBuilder;
 
+typedef struct EntityStats EntityStats;
+
+/*
+ * Hot stats of the entities of a map, as parallel arrays indexed by the same
+ * slot, so that the systems running every cycle can stream through them
+ * instead of going from an entity to the other. Each map has its own store,
+ * entities keep their stats inline until they are added to a map and give
+ * them back when they leave it. Slots are kept packed: removing an entity
+ * moves the last one in its place, a view is only valid until the next
+ * entity is added or removed.
+ *
+ * Needs are stored as their value at the cycle they were last written at
+ * (the *_since arrays), see NeedsClock.
+ */
+typedef struct EntityStatsView {
+  size_t            size;
+  uint32_t         *life_points;
+  uint32_t const   *starting_life_points;
+  uint32_t         *hunger;
+  uint32_t         *hunger_since;
+  uint32_t         *thirst;
+  uint32_t         *thirst_since;
+  uint32_t         *tiredness;
+  uint32_t         *tiredness_since;
+  EntityType const *types;
+  Entity *const    *entities;
+} EntityStatsView;
+
+// Stores are used by the maps, the entities left inside are given back their
+// stats when the store is freed.
+EntityStats    *entity_stats_new(uint32_t reserved_entities);
+void            entity_stats_free(EntityStats *);
+void            entity_stats_reserve(EntityStats *, uint32_t);
+uint32_t        entity_stats_attach(EntityStats *, Entity *); // Returns the slot, always the last one
+void            entity_stats_detach(Entity *);
+EntityStatsView entity_stats_get_view(EntityStats const *);
+
+/*
+ * Needs gained at every cycle by the living entities of a type. Needs are not
+ * updated at every cycle: they are computed when read, from the number of
+ * cycles since they were last written, so entities nobody looks at cost
+ * nothing. Needs stop growing at UINT32_MAX, while the entity is dead and
+ * while it is not part of a map with a needs clock.
+ */
+typedef struct NeedsRates {
+  uint32_t hunger;
+  uint32_t thirst;
+  uint32_t tiredness;
+} NeedsRates;
+
+// Humans and animals get one of each need per cycle, the others none
+#define ENTITY_DEFAULT_NEEDS_RATE 1
+
+// Current cycle and rates (indexed by the entity types) the needs of the
+// entities of a store follow, usually the ones of the engine of the map.
+// Both must outlive the store, or the next clock it is given.
+typedef struct NeedsClock {
+  uint32_t const   *cycle;
+  NeedsRates const *rates;
+} NeedsClock;
+
+// Needs keep their current values when the clock is changed, the needs of
+// the entities of a type must be settled before the rates of the type change.
+void entity_stats_set_needs_clock(EntityStats *, NeedsClock);
+void entity_stats_settle_needs(EntityStats *, EntityType);
+
 EntityBuilder *entity_builder_new();
 void           entity_builder_free(EntityBuilder *);
 
@@ -83,6 +149,11 @@ Entity *entity_build(uint32_t starting_lp, EntityType type, const char *name, ui
 Entity *entity_deserialize(msgpack_object_map const *);
 void    entity_serialize(Entity const *, msgpack_sbuffer *);
 void    entity_free(Entity *);
+void    entity_shutdown(); // Frees the memory kept for the entities, all of them must have been freed
+
+// Number of entities the memory kept by entity_build() can hold before having
+// to allocate more, whether they are alive or not.
+uint32_t entity_get_pool_capacity(); // PERF: Only useful for tests
 
 // Getters
 uint32_t     entity_get_life_points(Entity const *);
@@ -99,6 +170,7 @@ uint32_t     entity_get_seeing_distance(Entity const *);
 EntityType   entity_get_entity_type(Entity const *);
 const char  *entity_get_name(Entity const *);
 Point const *entity_get_coords(Entity const *);
+Point        entity_get_position(Entity const *);
 
 // Methods
 bool entity_can_move(Entity const *);
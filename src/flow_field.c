@@ -0,0 +1,271 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "flow_field.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_FLOW_FIELD_CAPACITY 16
+
+// Straight moves first, so that they are preferred over the diagonal ones
+// when both get as close to the goals.
+static int const STEPS[8][2] = {
+  {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1},
+};
+
+struct FlowField {
+  Map const *_map;
+  uint32_t   _x_size;
+  uint32_t   _y_size;
+  uint32_t   _max_distance;
+
+  // Window of the last computation, outside of it every tile is unreachable
+  uint32_t  _from_x;
+  uint32_t  _from_y;
+  uint32_t  _window_x;
+  uint32_t  _window_y;
+  uint32_t *_distances; // (x - _from_x) + (y - _from_y) * _window_x
+  size_t    _distances_capacity;
+
+  // Goals for the next computation, and the ones of the last computation
+  uint32_t *_goals;
+  uint32_t  _goals_size;
+  uint32_t  _goals_capacity;
+  uint32_t *_computed_goals;
+  uint32_t  _computed_goals_size;
+  uint64_t  _computed_revision;
+  bool      _computed;
+
+  // Tiles reached by the last computation, in the order they have been
+  // reached. Reused as the queue of the next computation.
+  uint32_t *_queue;
+  uint32_t  _queue_size;
+  uint32_t  _queue_capacity;
+};
+
+FlowField *flow_field_new(Map const *map, uint32_t max_distance) {
+  MapBoundaries boundaries = map_get_boundaries(map);
+
+  FlowField *ret = calloc(1, sizeof(FlowField));
+  ret->_map = map;
+  ret->_x_size = boundaries.x;
+  ret->_y_size = boundaries.y;
+  ret->_max_distance = max_distance;
+  ret->_window_x = 0;
+  ret->_window_y = 0;
+  ret->_distances = nullptr;
+  ret->_distances_capacity = 0;
+  ret->_computed = false;
+  return ret;
+}
+
+void flow_field_free(FlowField *field) {
+  free(field->_distances);
+  free(field->_goals);
+  free(field->_computed_goals);
+  free(field->_queue);
+  free(field);
+}
+
+inline void flow_field_clear_goals(FlowField *field) {
+  field->_goals_size = 0;
+}
+
+void flow_field_add_goal(FlowField *field, uint32_t x, uint32_t y) {
+  if (x >= field->_x_size || y >= field->_y_size) {
+    return;
+  }
+
+  if (field->_goals_size == field->_goals_capacity) {
+    field->_goals_capacity = max(field->_goals_capacity * 2, MIN_FLOW_FIELD_CAPACITY);
+    field->_goals = realloc(field->_goals, field->_goals_capacity * sizeof(uint32_t));
+    field->_computed_goals = realloc(field->_computed_goals, field->_goals_capacity * sizeof(uint32_t));
+  }
+
+  field->_goals[field->_goals_size++] = x + y * field->_x_size;
+}
+
+// Internal method, true if the tile is inside of the window of the field
+static inline bool flow_field_in_window(FlowField const *field, uint32_t x, uint32_t y) {
+  return x - field->_from_x < field->_window_x && y - field->_from_y < field->_window_y;
+}
+
+// Internal method, the tile must be inside of the window of the field
+static inline uint32_t *flow_field_distance(FlowField *field, uint32_t index) {
+  uint32_t x = index % field->_x_size;
+  uint32_t y = index / field->_x_size;
+  return &field->_distances[(x - field->_from_x) + (size_t)(y - field->_from_y) * field->_window_x];
+}
+
+// Internal method, sets the distance of a tile reached for the first time
+void flow_field_reach(FlowField *field, uint32_t index, uint32_t distance) {
+  if (field->_queue_size == field->_queue_capacity) {
+    field->_queue_capacity = max(field->_queue_capacity * 2, MIN_FLOW_FIELD_CAPACITY);
+    field->_queue = realloc(field->_queue, field->_queue_capacity * sizeof(uint32_t));
+  }
+
+  *flow_field_distance(field, index) = distance;
+  field->_queue[field->_queue_size++] = index;
+}
+
+// Internal method, moves the window around the current goals. Returns true if
+// it changed, in which case every tile of the window is unreachable.
+bool flow_field_move_window(FlowField *field) {
+  uint32_t from_x = UINT32_MAX;
+  uint32_t from_y = UINT32_MAX;
+  uint32_t to_x = 0;
+  uint32_t to_y = 0;
+  for (uint32_t i = 0; i < field->_goals_size; i++) {
+    from_x = min(from_x, field->_goals[i] % field->_x_size);
+    from_y = min(from_y, field->_goals[i] / field->_x_size);
+    to_x = max(to_x, field->_goals[i] % field->_x_size);
+    to_y = max(to_y, field->_goals[i] / field->_x_size);
+  }
+
+  uint32_t window_x = 0;
+  uint32_t window_y = 0;
+  if (field->_goals_size == 0) {
+    from_x = 0;
+    from_y = 0;
+  } else {
+    uint32_t max_distance = field->_max_distance;
+    from_x = from_x > max_distance ? from_x - max_distance : 0;
+    from_y = from_y > max_distance ? from_y - max_distance : 0;
+    to_x = field->_x_size - 1 - to_x > max_distance ? to_x + max_distance : field->_x_size - 1;
+    to_y = field->_y_size - 1 - to_y > max_distance ? to_y + max_distance : field->_y_size - 1;
+    window_x = to_x - from_x + 1;
+    window_y = to_y - from_y + 1;
+  }
+
+  if (from_x == field->_from_x && from_y == field->_from_y && window_x == field->_window_x && window_y == field->_window_y) {
+    return false;
+  }
+
+  size_t tiles = (size_t)window_x * window_y;
+  if (tiles > field->_distances_capacity) {
+    field->_distances = realloc(field->_distances, tiles * sizeof(uint32_t));
+    field->_distances_capacity = tiles;
+  }
+  for (size_t i = 0; i < tiles; i++) {
+    field->_distances[i] = FLOW_FIELD_UNREACHABLE;
+  }
+
+  field->_from_x = from_x;
+  field->_from_y = from_y;
+  field->_window_x = window_x;
+  field->_window_y = window_y;
+  return true;
+}
+
+bool flow_field_compute(FlowField *field) {
+  bool moved = flow_field_move_window(field);
+
+  // Tiles outside of the window cannot change the distances
+  uint64_t revision = 0;
+  if (field->_window_x > 0) {
+    revision = map_get_tiles_revision(field->_map, field->_from_x, field->_from_y, field->_from_x + field->_window_x - 1,
+                                      field->_from_y + field->_window_y - 1);
+  }
+
+  if (!moved && field->_computed && field->_computed_revision == revision && field->_computed_goals_size == field->_goals_size &&
+      memcmp(field->_computed_goals, field->_goals, field->_goals_size * sizeof(uint32_t)) == 0) {
+    return false;
+  }
+
+  field->_computed = true;
+  field->_computed_revision = revision;
+  field->_computed_goals_size = field->_goals_size;
+  if (field->_goals_size > 0) {
+    memcpy(field->_computed_goals, field->_goals, field->_goals_size * sizeof(uint32_t));
+  }
+
+  // Only the tiles reached last time have to be cleared, unless the window
+  // moved and everything has been cleared already
+  for (uint32_t i = 0; i < field->_queue_size && !moved; i++) {
+    *flow_field_distance(field, field->_queue[i]) = FLOW_FIELD_UNREACHABLE;
+  }
+  field->_queue_size = 0;
+
+  for (uint32_t i = 0; i < field->_goals_size; i++) {
+    if (*flow_field_distance(field, field->_goals[i]) == FLOW_FIELD_UNREACHABLE) {
+      flow_field_reach(field, field->_goals[i], 0);
+    }
+  }
+
+  // Breadth first search from all the goals at once, moving in any direction
+  // costs the same.
+  for (uint32_t head = 0; head < field->_queue_size; head++) {
+    uint32_t current = field->_queue[head];
+    uint32_t distance = *flow_field_distance(field, current) + 1;
+    if (distance > field->_max_distance) {
+      break;
+    }
+
+    uint32_t x = current % field->_x_size;
+    uint32_t y = current / field->_x_size;
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        uint32_t neighbour_x = x + dx;
+        uint32_t neighbour_y = y + dy;
+        if (!flow_field_in_window(field, neighbour_x, neighbour_y)) {
+          continue;
+        }
+
+        uint32_t neighbour = neighbour_x + neighbour_y * field->_x_size;
+        if (*flow_field_distance(field, neighbour) == FLOW_FIELD_UNREACHABLE &&
+            map_test_plane(field->_map, MAP_PLANE_TRAVERSABLE, neighbour_x, neighbour_y)) {
+          flow_field_reach(field, neighbour, distance);
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+inline uint32_t flow_field_get_distance(FlowField const *field, uint32_t x, uint32_t y) {
+  if (!flow_field_in_window(field, x, y)) {
+    return FLOW_FIELD_UNREACHABLE;
+  }
+
+  return field->_distances[(x - field->_from_x) + (size_t)(y - field->_from_y) * field->_window_x];
+}
+
+bool flow_field_next_step(FlowField const *field, uint32_t x, uint32_t y, uint32_t *next_x, uint32_t *next_y) {
+  uint32_t best = flow_field_get_distance(field, x, y);
+  bool     found = false;
+
+  for (size_t i = 0; i < 8; i++) {
+    uint32_t neighbour_x = x + STEPS[i][0];
+    uint32_t neighbour_y = y + STEPS[i][1];
+    uint32_t distance = flow_field_get_distance(field, neighbour_x, neighbour_y);
+    if (distance < best && map_is_tile_free(field->_map, neighbour_x, neighbour_y)) {
+      best = distance;
+      *next_x = neighbour_x;
+      *next_y = neighbour_y;
+      found = true;
+    }
+  }
+
+  return found;
+}
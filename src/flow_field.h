@@ -0,0 +1,64 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __FLOW_FIELD__H__
+#define __FLOW_FIELD__H__
+
+#include "map.h"
+#include <stdint.h>
+
+/*
+ * Distance from every tile of a map to the closest of a set of goals, going
+ * through the traversable tiles (entities are ignored, they move anyway).
+ * Any number of entities can then walk towards the goals by stepping to the
+ * neighbour closest to them, without searching a path of their own.
+ *
+ * The distances are only computed up to a maximum distance, the tiles
+ * farther than that are considered unreachable. Only the tiles which can be
+ * reached are kept in memory: the bounding box of the goals, grown by the
+ * maximum distance on each side.
+ */
+typedef struct FlowField FlowField;
+
+#define FLOW_FIELD_UNREACHABLE UINT32_MAX
+
+FlowField *flow_field_new(Map const *, uint32_t max_distance);
+void       flow_field_free(FlowField *);
+
+void flow_field_clear_goals(FlowField *);
+void flow_field_add_goal(FlowField *, uint32_t x, uint32_t y);
+
+/*
+ * Computes the distances to the current goals, returns false if neither the
+ * goals nor the tiles changed since the last computation, in which case the
+ * previous distances are kept.
+ */
+bool flow_field_compute(FlowField *);
+
+uint32_t flow_field_get_distance(FlowField const *, uint32_t x, uint32_t y);
+
+/*
+ * Finds the next tile to go to from the given one, which is the free
+ * neighbour closest to the goals. Returns false if there is no such tile.
+ */
+bool flow_field_next_step(FlowField const *, uint32_t x, uint32_t y, uint32_t *next_x, uint32_t *next_y);
+
+#endif /* ifndef __FLOW_FIELD__H__ */
@@ -0,0 +1,206 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "fov.h"
+#include "point.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Fov {
+  // Parameters of the last computation
+  Map const *_map;
+  uint32_t   _x;
+  uint32_t   _y;
+  uint32_t   _radius;
+  uint8_t    _min_light;
+  uint64_t   _revision;
+  bool       _valid;
+
+  LightMap const *_light_map;
+  uint64_t        _light_revision;
+
+  // One bit per tile of the square of side 2 * radius + 1 centered on the
+  // origin, grown when needed and never shrunk.
+  uint64_t *_bits;
+  size_t    _words;
+  uint32_t  _side;
+  uint32_t  _visible;
+};
+
+// Transformations from the first octant to the other ones
+static int const OCTANTS[8][4] = {
+  {1, 0, 0, 1},   {0, 1, 1, 0},   {0, -1, 1, 0}, {-1, 0, 0, 1},
+  {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1},
+};
+
+Fov *fov_new(void) {
+  Fov *ret = calloc(1, sizeof(Fov));
+  ret->_valid = false;
+  return ret;
+}
+
+void fov_free(Fov *fov) {
+  free(fov->_bits);
+  free(fov);
+}
+
+inline void fov_invalidate(Fov *fov) {
+  fov->_valid = false;
+}
+
+void fov_set_light_map(Fov *fov, LightMap const *light_map) {
+  fov->_light_map = light_map;
+  fov->_valid = false;
+}
+
+// Internal method, marks a tile as visible if it is lit enough
+void fov_light_tile(Fov *fov, int64_t x, int64_t y, TileView const *tile) {
+  uint32_t light = fov->_light_map != nullptr ? light_map_get_level(fov->_light_map, x, y) : tile->base_light;
+  if (light < fov->_min_light) {
+    return;
+  }
+
+  size_t   bit = (size_t)(y - fov->_y + fov->_radius) * fov->_side + (size_t)(x - fov->_x + fov->_radius);
+  uint64_t mask = UINT64_C(1) << (bit % 64);
+  if ((fov->_bits[bit / 64] & mask) == 0) {
+    fov->_bits[bit / 64] |= mask;
+    fov->_visible++;
+  }
+}
+
+// Internal method, scans the rows of an octant starting from the given one,
+// start and end are the slopes delimiting the part of the octant which is
+// still lit. Walls split the lit part, the part before the wall is scanned
+// recursively.
+void fov_cast_light(Fov *fov, uint32_t row, double start, double end, int const transform[4]) {
+  if (start < end) {
+    return;
+  }
+
+  int64_t radius = fov->_radius;
+  double  new_start = 0.0;
+  for (int64_t distance = row; distance <= radius; distance++) {
+    bool    blocked = false;
+    int64_t dy = -distance;
+    for (int64_t dx = -distance; dx <= 0; dx++) {
+      double left_slope = (dx - 0.5) / (dy + 0.5);
+      double right_slope = (dx + 0.5) / (dy - 0.5);
+      if (start < right_slope) {
+        continue;
+      }
+      if (end > left_slope) {
+        break;
+      }
+
+      int64_t  x = (int64_t)fov->_x + dx * transform[0] + dy * transform[1];
+      int64_t  y = (int64_t)fov->_y + dx * transform[2] + dy * transform[3];
+      TileView tile = {.valid = false};
+      if (x >= 0 && y >= 0) {
+        tile = map_get_tile(fov->_map, x, y);
+      }
+
+      if (tile.valid && dx * dx + dy * dy <= radius * radius) {
+        fov_light_tile(fov, x, y, &tile);
+      }
+
+      bool opaque = !tile.valid || !tile.traversable;
+      if (blocked) {
+        if (opaque) {
+          new_start = right_slope;
+        } else {
+          blocked = false;
+          start = new_start;
+        }
+      } else if (opaque && distance < radius) {
+        blocked = true;
+        fov_cast_light(fov, distance + 1, start, left_slope, transform);
+        new_start = right_slope;
+      }
+    }
+
+    if (blocked) {
+      break;
+    }
+  }
+}
+
+bool fov_compute(Fov *fov, Map const *map, uint32_t x, uint32_t y, uint32_t radius, uint8_t min_light) {
+  uint64_t revision = map_get_tiles_revision(map, x - min(x, radius), y - min(y, radius), x + radius, y + radius);
+  uint64_t light_revision = fov->_light_map != nullptr ? light_map_get_revision(fov->_light_map) : 0;
+  if (fov->_valid && fov->_map == map && fov->_x == x && fov->_y == y && fov->_radius == radius && fov->_min_light == min_light &&
+      fov->_revision == revision && fov->_light_revision == light_revision) {
+    return false;
+  }
+
+  fov->_map = map;
+  fov->_x = x;
+  fov->_y = y;
+  fov->_radius = radius;
+  fov->_min_light = min_light;
+  fov->_revision = revision;
+  fov->_light_revision = light_revision;
+  fov->_valid = true;
+
+  fov->_side = 2 * radius + 1;
+  size_t words = ((size_t)fov->_side * fov->_side + 63) / 64;
+  if (words > fov->_words) {
+    fov->_bits = realloc(fov->_bits, words * sizeof(uint64_t));
+    fov->_words = words;
+  }
+  memset(fov->_bits, 0, words * sizeof(uint64_t));
+  fov->_visible = 0;
+
+  TileView origin = map_get_tile(map, x, y);
+  if (!origin.valid) {
+    return true;
+  }
+
+  // The origin is visible even in the dark
+  fov->_bits[(radius * fov->_side + radius) / 64] |= UINT64_C(1) << ((radius * fov->_side + radius) % 64);
+  fov->_visible++;
+
+  for (size_t octant = 0; octant < 8; octant++) {
+    fov_cast_light(fov, 1, 1.0, 0.0, OCTANTS[octant]);
+  }
+
+  return true;
+}
+
+bool fov_compute_for_entity(Fov *fov, Map const *map, Entity const *entity) {
+  Point coords = entity_get_position(entity);
+  return fov_compute(fov, map, coords.x, coords.y, entity_get_seeing_distance(entity), FOV_MIN_LIGHT);
+}
+
+bool fov_is_visible(Fov const *fov, uint32_t x, uint32_t y) {
+  if (!fov->_valid || x + fov->_radius < fov->_x || y + fov->_radius < fov->_y || x > fov->_x + fov->_radius ||
+      y > fov->_y + fov->_radius) {
+    return false;
+  }
+
+  size_t bit = (size_t)(y + fov->_radius - fov->_y) * fov->_side + (x + fov->_radius - fov->_x);
+  return (fov->_bits[bit / 64] & (UINT64_C(1) << (bit % 64))) != 0;
+}
+
+inline uint32_t fov_count_visible(Fov const *fov) {
+  return fov->_visible;
+}
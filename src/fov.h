@@ -0,0 +1,67 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __FOV__H__
+#define __FOV__H__
+
+#include "entity.h"
+#include "light.h"
+#include "map.h"
+#include <stdint.h>
+
+/*
+ * Field of view computed with recursive shadowcasting. Non traversable tiles
+ * block the sight (but are visible themselves) and tiles whose light is below
+ * the threshold are too dark to be seen, the origin is always visible.
+ *
+ * A Fov is meant to be kept around, one per entity: its buffers are reused
+ * from one computation to the other and nothing is computed again as long as
+ * the origin, the radius and the tiles in range stay the same.
+ */
+typedef struct Fov Fov;
+
+// Tiles darker than this cannot be seen by the entities
+#define FOV_MIN_LIGHT 1
+
+Fov *fov_new(void);
+void fov_free(Fov *);
+
+/*
+ * Computes the field of view around the given coordinates, returns false if
+ * the previous result was still up to date and nothing has been computed.
+ */
+bool fov_compute(Fov *, Map const *, uint32_t x, uint32_t y, uint32_t radius, uint8_t min_light);
+
+// Same as above, using the position and the seeing distance of the entity
+bool fov_compute_for_entity(Fov *, Map const *, Entity const *);
+
+// Forces the next computation to happen
+void fov_invalidate(Fov *);
+
+// Uses the levels of the light map instead of the base light of the tiles,
+// the light map is not owned by the Fov. Passing nullptr goes back to the
+// base light.
+void fov_set_light_map(Fov *, LightMap const *);
+
+bool     fov_is_visible(Fov const *, uint32_t x, uint32_t y);
+uint32_t fov_count_visible(Fov const *);
+
+#endif /* ifndef __FOV__H__ */
@@ -0,0 +1,288 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "generator.h"
+#include "tile.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Size of the biggest features of the terrain, each octave halves it
+#define GENERATOR_FEATURE_SIZE 128
+#define GENERATOR_OCTAVES      4
+#define GENERATOR_MIN_FEATURE  (GENERATOR_FEATURE_SIZE >> (GENERATOR_OCTAVES - 1))
+
+// Lattice points needed to cover a chunk with the smallest features
+#define GENERATOR_LATTICE_SIDE (GENERATOR_CHUNK_SIZE / GENERATOR_MIN_FEATURE + 2)
+
+// Thresholds over the elevation and the moisture, both in [0, 1)
+#define GENERATOR_MOUNTAIN_LEVEL 0.68f
+#define GENERATOR_HILL_LEVEL     0.62f
+#define GENERATOR_FOREST_LEVEL   0.58f
+#define GENERATOR_MEADOW_LEVEL   0.5f
+
+// Light filtering through the trees
+#define GENERATOR_FOREST_LIGHT 6
+
+// Crossroads are kept away from the borders of their chunk
+#define GENERATOR_ROAD_MARGIN 8
+
+typedef struct GeneratorJob {
+  MapPrefab  *_prefab;
+  uint32_t    _x_size;
+  uint32_t    _y_size;
+  uint32_t    _chunks_x;
+  uint32_t    _chunks_y;
+  uint64_t    _seed;
+  atomic_uint _next_chunk;
+} GeneratorJob;
+
+// Crossroad of a chunk and the roads leaving it toward the next chunks
+typedef struct GeneratorCrossroad {
+  uint32_t _x;
+  uint32_t _y;
+  bool     _east;
+  bool     _south;
+} GeneratorCrossroad;
+
+// splitmix64 finalizer over the seed and the coordinates
+static inline uint64_t generator_hash(uint64_t seed, uint64_t x, uint64_t y) {
+  uint64_t hash = seed ^ (x * 0x9E3779B97F4A7C15ULL) ^ (y * 0xC2B2AE3D27D4EB4FULL);
+  hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+  return hash ^ (hash >> 31);
+}
+
+static inline float generator_lerp(float from, float to, float ratio) {
+  return from + (to - from) * ratio;
+}
+
+// Internal method, fractal value noise over a chunk, values are in [0, 1)
+// and stored column by column. Only the lattice points around the chunk are
+// hashed, the tiles are interpolated between them.
+void generator_fractal(uint64_t seed, uint32_t from_x, uint32_t from_y, float *values) {
+  float lattice[GENERATOR_LATTICE_SIDE * GENERATOR_LATTICE_SIDE];
+  float ramp[GENERATOR_FEATURE_SIZE];
+  float amplitude = 1.0f;
+  float total = 0.0f;
+
+  for (uint32_t i = 0; i < GENERATOR_CHUNK_SIZE * GENERATOR_CHUNK_SIZE; i++) {
+    values[i] = 0.0f;
+  }
+
+  for (uint32_t octave = 0; octave < GENERATOR_OCTAVES; octave++) {
+    uint32_t scale = GENERATOR_FEATURE_SIZE >> octave;
+    uint32_t first_x = from_x / scale;
+    uint32_t first_y = from_y / scale;
+    uint32_t side = (GENERATOR_CHUNK_SIZE - 1) / scale + 2;
+    uint64_t octave_seed = generator_hash(seed, octave, 0);
+
+    for (uint32_t j = 0; j < side; j++) {
+      for (uint32_t i = 0; i < side; i++) {
+        lattice[i + j * side] = (float)(generator_hash(octave_seed, first_x + i, first_y + j) >> 40) / (float)(1 << 24);
+      }
+    }
+
+    // Smoothstep between two lattice points
+    for (uint32_t i = 0; i < scale; i++) {
+      float ratio = (float)i / (float)scale;
+      ramp[i] = ratio * ratio * (3.0f - 2.0f * ratio);
+    }
+
+    for (uint32_t x = 0; x < GENERATOR_CHUNK_SIZE; x++) {
+      uint32_t cell_x = (from_x + x) / scale - first_x;
+      float    ratio_x = ramp[(from_x + x) % scale];
+      for (uint32_t y = 0; y < GENERATOR_CHUNK_SIZE; y++) {
+        uint32_t     cell_y = (from_y + y) / scale - first_y;
+        float const *corner = &lattice[cell_x + cell_y * side];
+        float        top = generator_lerp(corner[0], corner[1], ratio_x);
+        float        bottom = generator_lerp(corner[side], corner[side + 1], ratio_x);
+        values[y + x * GENERATOR_CHUNK_SIZE] += amplitude * generator_lerp(top, bottom, ramp[(from_y + y) % scale]);
+      }
+    }
+
+    total += amplitude;
+    amplitude /= 2.0f;
+  }
+
+  for (uint32_t i = 0; i < GENERATOR_CHUNK_SIZE * GENERATOR_CHUNK_SIZE; i++) {
+    values[i] /= total;
+  }
+}
+
+// Internal method, everything about the crossroad of a chunk comes from the
+// seed of the chunk, so that neighbouring chunks agree on it.
+GeneratorCrossroad generator_crossroad(GeneratorJob const *job, uint32_t chunk_x, uint32_t chunk_y) {
+  uint64_t chunk_seed = generator_hash(job->_seed, chunk_x, chunk_y);
+  uint32_t from_x = chunk_x * GENERATOR_CHUNK_SIZE;
+  uint32_t from_y = chunk_y * GENERATOR_CHUNK_SIZE;
+  uint32_t width = min(GENERATOR_CHUNK_SIZE, job->_x_size - from_x);
+  uint32_t height = min(GENERATOR_CHUNK_SIZE, job->_y_size - from_y);
+  uint32_t margin_x = width > 4 * GENERATOR_ROAD_MARGIN ? GENERATOR_ROAD_MARGIN : 0;
+  uint32_t margin_y = height > 4 * GENERATOR_ROAD_MARGIN ? GENERATOR_ROAD_MARGIN : 0;
+
+  // Most of the chunks are linked to their neighbours
+  return (GeneratorCrossroad){
+    ._x = from_x + margin_x + (chunk_seed & 0xFFFF) % (width - 2 * margin_x),
+    ._y = from_y + margin_y + ((chunk_seed >> 16) & 0xFFFF) % (height - 2 * margin_y),
+    ._east = chunk_x + 1 < job->_chunks_x && ((chunk_seed >> 32) & 0x3) != 0,
+    ._south = chunk_y + 1 < job->_chunks_y && ((chunk_seed >> 34) & 0x3) != 0,
+  };
+}
+
+// Internal method, draws the part of an horizontal or vertical road inside
+// of the chunk.
+void generator_draw_road(uint8_t *kinds, uint32_t from_x, uint32_t from_y, uint32_t road_from_x, uint32_t road_from_y, uint32_t road_to_x,
+                         uint32_t road_to_y) {
+  uint32_t left = max(min(road_from_x, road_to_x), from_x);
+  uint32_t right = min(max(road_from_x, road_to_x), from_x + GENERATOR_CHUNK_SIZE - 1);
+  uint32_t top = max(min(road_from_y, road_to_y), from_y);
+  uint32_t bottom = min(max(road_from_y, road_to_y), from_y + GENERATOR_CHUNK_SIZE - 1);
+  for (uint32_t x = left; x <= right; x++) {
+    for (uint32_t y = top; y <= bottom; y++) {
+      kinds[(y - from_y) + (x - from_x) * GENERATOR_CHUNK_SIZE] = ROAD;
+    }
+  }
+}
+
+// Internal method, roads go east then south from a crossroad to the next ones
+void generator_draw_roads(GeneratorJob const *job, uint8_t *kinds, uint32_t chunk_x, uint32_t chunk_y) {
+  uint32_t from_x = chunk_x * GENERATOR_CHUNK_SIZE;
+  uint32_t from_y = chunk_y * GENERATOR_CHUNK_SIZE;
+
+  // Only the roads of this chunk and of the previous ones can come here
+  for (uint32_t i = chunk_x > 0 ? chunk_x - 1 : 0; i <= chunk_x; i++) {
+    for (uint32_t j = chunk_y > 0 ? chunk_y - 1 : 0; j <= chunk_y; j++) {
+      GeneratorCrossroad crossroad = generator_crossroad(job, i, j);
+      if (crossroad._east && j == chunk_y) {
+        GeneratorCrossroad next = generator_crossroad(job, i + 1, j);
+        generator_draw_road(kinds, from_x, from_y, crossroad._x, crossroad._y, next._x, crossroad._y);
+        generator_draw_road(kinds, from_x, from_y, next._x, crossroad._y, next._x, next._y);
+      }
+
+      if (crossroad._south && i == chunk_x) {
+        GeneratorCrossroad next = generator_crossroad(job, i, j + 1);
+        generator_draw_road(kinds, from_x, from_y, crossroad._x, crossroad._y, crossroad._x, next._y);
+        generator_draw_road(kinds, from_x, from_y, crossroad._x, next._y, next._x, next._y);
+      }
+    }
+  }
+}
+
+// Internal method
+void generator_fill_chunk(GeneratorJob const *job, uint32_t chunk_x, uint32_t chunk_y) {
+  float   elevation[GENERATOR_CHUNK_SIZE * GENERATOR_CHUNK_SIZE];
+  float   moisture[GENERATOR_CHUNK_SIZE * GENERATOR_CHUNK_SIZE];
+  uint8_t kinds[GENERATOR_CHUNK_SIZE * GENERATOR_CHUNK_SIZE];
+
+  uint32_t from_x = chunk_x * GENERATOR_CHUNK_SIZE;
+  uint32_t from_y = chunk_y * GENERATOR_CHUNK_SIZE;
+  generator_fractal(generator_hash(job->_seed, UINT64_MAX, 0), from_x, from_y, elevation);
+  generator_fractal(generator_hash(job->_seed, UINT64_MAX, 1), from_x, from_y, moisture);
+
+  for (uint32_t i = 0; i < GENERATOR_CHUNK_SIZE * GENERATOR_CHUNK_SIZE; i++) {
+    if (elevation[i] > GENERATOR_MOUNTAIN_LEVEL) {
+      kinds[i] = ROCK;
+    } else if (elevation[i] > GENERATOR_HILL_LEVEL) {
+      kinds[i] = GRAVIER;
+    } else if (moisture[i] > GENERATOR_FOREST_LEVEL) {
+      kinds[i] = FOREST;
+    } else if (moisture[i] > GENERATOR_MEADOW_LEVEL) {
+      kinds[i] = TALL_GRASS;
+    } else {
+      kinds[i] = GRASS;
+    }
+  }
+
+  generator_draw_roads(job, kinds, chunk_x, chunk_y);
+
+  uint32_t width = min(GENERATOR_CHUNK_SIZE, job->_x_size - from_x);
+  uint32_t height = min(GENERATOR_CHUNK_SIZE, job->_y_size - from_y);
+  for (uint32_t x = 0; x < width; x++) {
+    for (uint32_t y = 0; y < height; y++) {
+      TileKind       kind = kinds[y + x * GENERATOR_CHUNK_SIZE];
+      TileProperties props = {
+        .kind = kind,
+        .base_light = kind == FOREST ? GENERATOR_FOREST_LIGHT : 10,
+        .inside = false,
+        .traversable = kind != ROCK,
+      };
+      map_prefab_set_tile(job->_prefab, from_x + x, from_y + y, &props);
+    }
+  }
+}
+
+// Internal method, chunks are handed out one at a time to the workers
+void *generator_worker(void *arg) {
+  GeneratorJob *job = arg;
+  uint32_t      chunks = job->_chunks_x * job->_chunks_y;
+  for (uint32_t chunk = atomic_fetch_add(&job->_next_chunk, 1); chunk < chunks; chunk = atomic_fetch_add(&job->_next_chunk, 1)) {
+    generator_fill_chunk(job, chunk % job->_chunks_x, chunk / job->_chunks_x);
+  }
+
+  return nullptr;
+}
+
+void generator_fill_map(Map *map, uint64_t seed, uint32_t threads) {
+  MapBoundaries boundaries = map_get_boundaries(map);
+  if (boundaries.x == 0 || boundaries.y == 0) {
+    return;
+  }
+
+  if (threads == 0) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = processors > 0 ? processors : 1;
+  }
+
+  // The workers fill a prefab as big as the map, which is then stamped at once
+  GeneratorJob job = {
+    ._prefab = map_prefab_new(boundaries.x, boundaries.y),
+    ._x_size = boundaries.x,
+    ._y_size = boundaries.y,
+    ._chunks_x = (boundaries.x + GENERATOR_CHUNK_SIZE - 1) / GENERATOR_CHUNK_SIZE,
+    ._chunks_y = (boundaries.y + GENERATOR_CHUNK_SIZE - 1) / GENERATOR_CHUNK_SIZE,
+    ._seed = seed,
+  };
+  atomic_init(&job._next_chunk, 0);
+
+  // The calling thread works as well, the chunks left by the threads which
+  // could not be started are generated by the others.
+  pthread_t *workers = calloc(threads, sizeof(pthread_t));
+  bool      *started = calloc(threads, sizeof(bool));
+  for (uint32_t i = 1; i < threads; i++) {
+    started[i] = pthread_create(&workers[i], nullptr, &generator_worker, &job) == 0;
+  }
+
+  generator_worker(&job);
+  for (uint32_t i = 1; i < threads; i++) {
+    if (started[i]) {
+      pthread_join(workers[i], nullptr);
+    }
+  }
+
+  map_stamp_prefab(map, job._prefab, 0, 0);
+  map_prefab_free(job._prefab);
+  free(started);
+  free(workers);
+}
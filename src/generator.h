@@ -0,0 +1,43 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __GENERATOR__H__
+#define __GENERATOR__H__
+
+#include "map.h"
+#include <stdint.h>
+
+/*
+ * Procedural generation of the tiles of a map: grass and forests depending
+ * on the moisture, rocky hills and mountains depending on the elevation, and
+ * a network of roads going through all of it.
+ *
+ * The map is split in squares of GENERATOR_CHUNK_SIZE tiles generated by a
+ * pool of threads. Every square has its own seed derived from the seed of
+ * the map, so the result only depends on the seed and on the size of the
+ * map, not on the number of threads.
+ */
+#define GENERATOR_CHUNK_SIZE 64
+
+// Overwrites all the tiles of the map, 0 threads uses one per processor
+void generator_fill_map(Map *, uint64_t seed, uint32_t threads);
+
+#endif /* ifndef __GENERATOR__H__ */
@@ -0,0 +1,770 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "hpa.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HPA_NONE          UINT32_MAX
+#define HPA_CLUSTER_TILES (HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE)
+
+// On each of the four borders, at most one straight entrance every other tile
+// and one diagonal entrance between each pair of consecutive tiles, plus one
+// diagonal entrance at each of the four corners.
+#define HPA_MAX_CLUSTER_NODES (4 * (HPA_CLUSTER_SIZE / 2 + 1 + HPA_CLUSTER_SIZE) + 4)
+
+#define MIN_HPA_CAPACITY 16
+
+typedef struct HpaEdge {
+  uint32_t _target;
+  uint32_t _cost;
+} HpaEdge;
+
+// One side of an entrance, the other side is the twin node in the
+// neighbouring cluster. Nodes are recycled when their border is rebuilt.
+typedef struct HpaNode {
+  uint32_t _x;
+  uint32_t _y;
+  uint32_t _cluster;
+  uint32_t _twin;
+  HpaEdge *_edges; // Towards the nodes of the same cluster
+  uint32_t _edges_size;
+  uint32_t _edges_capacity;
+
+  // Search state, only meaningful when the stamps are the current one
+  uint32_t _cost;
+  uint32_t _parent;
+  uint32_t _stamp;
+  bool     _closed;
+  uint32_t _goal_cost;
+  uint32_t _goal_stamp;
+} HpaNode;
+
+// Entrances of the border between a cluster and its neighbour to the east
+// (or to the south), as pairs of nodes: the first one of each pair is inside
+// of the cluster, the second one inside of the neighbour.
+//
+// The corner border of a cluster holds the diagonal entrances between the
+// four clusters meeting at its bottom right corner.
+typedef struct HpaBorder {
+  uint32_t *_nodes;
+  uint32_t  _size;
+  uint32_t  _capacity;
+} HpaBorder;
+
+typedef struct HpaOpen {
+  uint32_t _total;
+  uint32_t _estimate;
+  uint32_t _node;
+} HpaOpen;
+
+typedef enum HpaMarks {
+  HPA_MARK_EAST = 1 << 0,
+  HPA_MARK_SOUTH = 1 << 1,
+  HPA_MARK_EDGES = 1 << 2,
+  HPA_MARK_CORNER = 1 << 3,
+} HpaMarks;
+
+struct HpaGraph {
+  Map const *_map;
+  uint32_t   _x_size;
+  uint32_t   _y_size;
+  uint32_t   _clusters_x;
+  uint32_t   _clusters_y;
+
+  // Tiles revision of each cluster when its entrances were computed
+  uint64_t  *_revisions;
+  uint64_t   _changes;
+  bool       _built;
+  uint8_t   *_marks;
+  uint32_t   _rebuilt;
+  HpaBorder *_east;
+  HpaBorder *_south;
+  HpaBorder *_corners;
+
+  HpaNode  *_nodes;
+  uint32_t  _nodes_size;
+  uint32_t  _nodes_capacity;
+  uint32_t *_free_nodes;
+  uint32_t  _free_nodes_size;
+
+  // Traversable tiles of one cluster, and a breadth first search inside of it
+  uint32_t _loaded_cluster;
+  uint64_t _loaded_changes;
+  uint32_t _origin_x;
+  uint32_t _origin_y;
+  uint32_t _width;
+  uint32_t _height;
+  bool     _traversable[HPA_CLUSTER_TILES];
+  uint32_t _distances[HPA_CLUSTER_TILES];
+  uint32_t _parents[HPA_CLUSTER_TILES];
+  uint32_t _queue[HPA_CLUSTER_TILES];
+  uint32_t _cluster_nodes[HPA_MAX_CLUSTER_NODES];
+
+  // Abstract search
+  uint32_t _stamp;
+  HpaOpen *_open;
+  uint32_t _open_size;
+  uint32_t _open_capacity;
+  uint32_t *_abstract;
+  uint32_t  _abstract_capacity;
+
+  // Result of the last search
+  PathStep *_path;
+  uint32_t  _path_length;
+  uint32_t  _path_capacity;
+};
+
+HpaGraph *hpa_graph_new(Map const *map) {
+  MapBoundaries boundaries = map_get_boundaries(map);
+
+  HpaGraph *ret = calloc(1, sizeof(HpaGraph));
+  ret->_map = map;
+  ret->_x_size = boundaries.x;
+  ret->_y_size = boundaries.y;
+  ret->_clusters_x = (boundaries.x + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+  ret->_clusters_y = (boundaries.y + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+
+  size_t clusters = (size_t)ret->_clusters_x * ret->_clusters_y;
+  ret->_revisions = calloc(clusters, sizeof(uint64_t));
+  ret->_marks = calloc(clusters, sizeof(uint8_t));
+  ret->_east = calloc(clusters, sizeof(HpaBorder));
+  ret->_south = calloc(clusters, sizeof(HpaBorder));
+  ret->_corners = calloc(clusters, sizeof(HpaBorder));
+  ret->_built = false;
+  ret->_loaded_cluster = HPA_NONE;
+  return ret;
+}
+
+void hpa_graph_free(HpaGraph *graph) {
+  for (size_t i = 0; i < (size_t)graph->_clusters_x * graph->_clusters_y; i++) {
+    free(graph->_east[i]._nodes);
+    free(graph->_south[i]._nodes);
+    free(graph->_corners[i]._nodes);
+  }
+
+  for (uint32_t i = 0; i < graph->_nodes_size; i++) {
+    free(graph->_nodes[i]._edges);
+  }
+
+  free(graph->_revisions);
+  free(graph->_marks);
+  free(graph->_east);
+  free(graph->_south);
+  free(graph->_corners);
+  free(graph->_nodes);
+  free(graph->_free_nodes);
+  free(graph->_open);
+  free(graph->_abstract);
+  free(graph->_path);
+  free(graph);
+}
+
+static inline uint32_t hpa_cluster_of(HpaGraph const *graph, uint32_t x, uint32_t y) {
+  return (x / HPA_CLUSTER_SIZE) + (y / HPA_CLUSTER_SIZE) * graph->_clusters_x;
+}
+
+// Internal method, diagonal moves cost the same as the straight ones
+static inline uint32_t hpa_distance(uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  uint32_t delta_x = from_x > to_x ? from_x - to_x : to_x - from_x;
+  uint32_t delta_y = from_y > to_y ? from_y - to_y : to_y - from_y;
+  return max(delta_x, delta_y);
+}
+
+// Internal method
+static inline bool hpa_is_traversable(HpaGraph const *graph, uint32_t x, uint32_t y) {
+  return map_test_plane(graph->_map, MAP_PLANE_TRAVERSABLE, x, y);
+}
+
+// Internal method, caches the traversable tiles of a cluster for the local
+// searches which follow.
+void hpa_load_cluster(HpaGraph *graph, uint32_t cluster) {
+  uint64_t changes = map_count_tile_changes(graph->_map);
+  if (graph->_loaded_cluster == cluster && graph->_loaded_changes == changes) {
+    return;
+  }
+
+  graph->_loaded_cluster = cluster;
+  graph->_loaded_changes = changes;
+  graph->_origin_x = (cluster % graph->_clusters_x) * HPA_CLUSTER_SIZE;
+  graph->_origin_y = (cluster / graph->_clusters_x) * HPA_CLUSTER_SIZE;
+  graph->_width = min(HPA_CLUSTER_SIZE, graph->_x_size - graph->_origin_x);
+  graph->_height = min(HPA_CLUSTER_SIZE, graph->_y_size - graph->_origin_y);
+
+  for (uint32_t y = 0; y < graph->_height; y++) {
+    for (uint32_t x = 0; x < graph->_width; x++) {
+      graph->_traversable[x + y * HPA_CLUSTER_SIZE] = hpa_is_traversable(graph, graph->_origin_x + x, graph->_origin_y + y);
+    }
+  }
+}
+
+// Internal method, breadth first search inside of the loaded cluster. The
+// parent of each tile is its neighbour closest to the origin of the search.
+void hpa_local_search(HpaGraph *graph, uint32_t x, uint32_t y) {
+  for (size_t i = 0; i < HPA_CLUSTER_TILES; i++) {
+    graph->_distances[i] = HPA_NONE;
+  }
+
+  uint32_t origin = (x - graph->_origin_x) + (y - graph->_origin_y) * HPA_CLUSTER_SIZE;
+  uint32_t size = 0;
+  graph->_distances[origin] = 0;
+  graph->_parents[origin] = HPA_NONE;
+  graph->_queue[size++] = origin;
+
+  for (uint32_t head = 0; head < size; head++) {
+    uint32_t current = graph->_queue[head];
+    uint32_t current_x = current % HPA_CLUSTER_SIZE;
+    uint32_t current_y = current / HPA_CLUSTER_SIZE;
+
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        uint32_t neighbour_x = current_x + dx;
+        uint32_t neighbour_y = current_y + dy;
+        if (neighbour_x >= graph->_width || neighbour_y >= graph->_height) {
+          continue;
+        }
+
+        uint32_t neighbour = neighbour_x + neighbour_y * HPA_CLUSTER_SIZE;
+        if (graph->_distances[neighbour] == HPA_NONE && graph->_traversable[neighbour]) {
+          graph->_distances[neighbour] = graph->_distances[current] + 1;
+          graph->_parents[neighbour] = current;
+          graph->_queue[size++] = neighbour;
+        }
+      }
+    }
+  }
+}
+
+// Internal method, distance of a tile of the loaded cluster from the origin
+// of the last local search.
+static inline uint32_t hpa_local_distance(HpaGraph const *graph, uint32_t x, uint32_t y) {
+  return graph->_distances[(x - graph->_origin_x) + (y - graph->_origin_y) * HPA_CLUSTER_SIZE];
+}
+
+// Internal method
+void hpa_append_step(HpaGraph *graph, uint32_t x, uint32_t y) {
+  if (graph->_path_length == graph->_path_capacity) {
+    graph->_path_capacity = max(graph->_path_capacity * 2, MIN_HPA_CAPACITY);
+    graph->_path = realloc(graph->_path, graph->_path_capacity * sizeof(PathStep));
+  }
+
+  graph->_path[graph->_path_length++] = (PathStep){.x = x, .y = y};
+}
+
+// Internal method, appends the tiles leading from the given one to the
+// origin of the last local search.
+void hpa_append_local_path(HpaGraph *graph, uint32_t x, uint32_t y) {
+  uint32_t current = (x - graph->_origin_x) + (y - graph->_origin_y) * HPA_CLUSTER_SIZE;
+  while (graph->_parents[current] != HPA_NONE) {
+    current = graph->_parents[current];
+    hpa_append_step(graph, graph->_origin_x + current % HPA_CLUSTER_SIZE, graph->_origin_y + current / HPA_CLUSTER_SIZE);
+  }
+}
+
+// Internal method
+uint32_t hpa_allocate_node(HpaGraph *graph, uint32_t x, uint32_t y) {
+  uint32_t id;
+  if (graph->_free_nodes_size > 0) {
+    id = graph->_free_nodes[--graph->_free_nodes_size];
+  } else {
+    if (graph->_nodes_size == graph->_nodes_capacity) {
+      graph->_nodes_capacity = max(graph->_nodes_capacity * 2, MIN_HPA_CAPACITY);
+      graph->_nodes = realloc(graph->_nodes, graph->_nodes_capacity * sizeof(HpaNode));
+      graph->_free_nodes = realloc(graph->_free_nodes, graph->_nodes_capacity * sizeof(uint32_t));
+    }
+
+    id = graph->_nodes_size++;
+    graph->_nodes[id] = (HpaNode){._edges = nullptr, ._edges_capacity = 0};
+  }
+
+  HpaNode *node = &graph->_nodes[id];
+  node->_x = x;
+  node->_y = y;
+  node->_cluster = hpa_cluster_of(graph, x, y);
+  node->_edges_size = 0;
+  node->_stamp = 0;
+  node->_goal_stamp = 0;
+  return id;
+}
+
+// Internal method, recycles all the nodes of a border
+void hpa_clear_border(HpaGraph *graph, HpaBorder *border) {
+  for (uint32_t i = 0; i < border->_size; i++) {
+    graph->_free_nodes[graph->_free_nodes_size++] = border->_nodes[i];
+  }
+  border->_size = 0;
+}
+
+// Internal method, adds an entrance between two neighbouring tiles of two
+// different clusters.
+void hpa_add_entrance(HpaGraph *graph, HpaBorder *border, uint32_t inside_x, uint32_t inside_y, uint32_t outside_x, uint32_t outside_y) {
+  uint32_t inside = hpa_allocate_node(graph, inside_x, inside_y);
+  uint32_t outside = hpa_allocate_node(graph, outside_x, outside_y);
+  graph->_nodes[inside]._twin = outside;
+  graph->_nodes[outside]._twin = inside;
+
+  if (border->_size + 2 > border->_capacity) {
+    border->_capacity = max(border->_capacity * 2, MIN_HPA_CAPACITY);
+    border->_nodes = realloc(border->_nodes, border->_capacity * sizeof(uint32_t));
+  }
+  border->_nodes[border->_size++] = inside;
+  border->_nodes[border->_size++] = outside;
+}
+
+// Internal method, replaces the entrances of a border. The border goes from
+// (x, y) to (x + length * step_y, y + length * step_x) and the neighbouring
+// cluster is at (step_x, step_y) from it.
+void hpa_build_border(HpaGraph *graph, HpaBorder *border, uint32_t x, uint32_t y, uint32_t length, uint32_t step_x,
+                      uint32_t step_y) {
+  hpa_clear_border(graph, border);
+
+  uint32_t run = 0;
+  for (uint32_t i = 0; i <= length; i++) {
+    uint32_t inside_x = x + i * step_y;
+    uint32_t inside_y = y + i * step_x;
+    if (i < length && hpa_is_traversable(graph, inside_x, inside_y) && hpa_is_traversable(graph, inside_x + step_x, inside_y + step_y)) {
+      run++;
+      continue;
+    }
+
+    if (run > 0) {
+      // One entrance in the middle of the run
+      uint32_t middle = i - (run + 1) / 2;
+      uint32_t middle_x = x + middle * step_y;
+      uint32_t middle_y = y + middle * step_x;
+      hpa_add_entrance(graph, border, middle_x, middle_y, middle_x + step_x, middle_y + step_y);
+      run = 0;
+    }
+  }
+
+  // Diagonal steps across the border, only needed when neither of the two
+  // tiles on the side of the step leads to a straight entrance.
+  for (uint32_t i = 0; i < length; i++) {
+    uint32_t inside_x = x + i * step_y;
+    uint32_t inside_y = y + i * step_x;
+    if (!hpa_is_traversable(graph, inside_x, inside_y) || hpa_is_traversable(graph, inside_x + step_x, inside_y + step_y)) {
+      continue;
+    }
+
+    for (int delta = -1; delta <= 1; delta += 2) {
+      uint32_t j = i + delta;
+      uint32_t side_x = x + j * step_y;
+      uint32_t side_y = y + j * step_x;
+      if (j < length && !hpa_is_traversable(graph, side_x, side_y) && hpa_is_traversable(graph, side_x + step_x, side_y + step_y)) {
+        hpa_add_entrance(graph, border, inside_x, inside_y, side_x + step_x, side_y + step_y);
+      }
+    }
+  }
+}
+
+// Internal method, replaces the entrances of the corner whose bottom right
+// tile is (x, y). A diagonal step across the corner needs its own entrance
+// when both of the tiles on its sides are blocked.
+void hpa_build_corner(HpaGraph *graph, HpaBorder *border, uint32_t x, uint32_t y) {
+  hpa_clear_border(graph, border);
+
+  bool north_west = hpa_is_traversable(graph, x - 1, y - 1);
+  bool north_east = hpa_is_traversable(graph, x, y - 1);
+  bool south_west = hpa_is_traversable(graph, x - 1, y);
+  bool south_east = hpa_is_traversable(graph, x, y);
+
+  if (north_west && south_east && !north_east && !south_west) {
+    hpa_add_entrance(graph, border, x - 1, y - 1, x, y);
+  }
+
+  if (north_east && south_west && !north_west && !south_east) {
+    hpa_add_entrance(graph, border, x, y - 1, x - 1, y);
+  }
+}
+
+// Internal method, collects the nodes of a cluster in _cluster_nodes
+uint32_t hpa_gather_nodes(HpaGraph *graph, uint32_t cluster) {
+  uint32_t         cluster_x = cluster % graph->_clusters_x;
+  uint32_t         cluster_y = cluster / graph->_clusters_x;
+  uint32_t         count = 0;
+  HpaBorder const *borders[8] = {
+    &graph->_east[cluster],
+    &graph->_south[cluster],
+    cluster_x > 0 ? &graph->_east[cluster - 1] : nullptr,
+    cluster_y > 0 ? &graph->_south[cluster - graph->_clusters_x] : nullptr,
+    &graph->_corners[cluster],
+    cluster_x > 0 ? &graph->_corners[cluster - 1] : nullptr,
+    cluster_y > 0 ? &graph->_corners[cluster - graph->_clusters_x] : nullptr,
+    cluster_x > 0 && cluster_y > 0 ? &graph->_corners[cluster - graph->_clusters_x - 1] : nullptr,
+  };
+
+  for (size_t i = 0; i < 8; i++) {
+    if (borders[i] == nullptr) {
+      continue;
+    }
+
+    // Corners are shared by four clusters, the nodes say which is theirs
+    for (uint32_t j = 0; j < borders[i]->_size; j++) {
+      if (graph->_nodes[borders[i]->_nodes[j]]._cluster == cluster) {
+        assert(count < HPA_MAX_CLUSTER_NODES);
+        graph->_cluster_nodes[count++] = borders[i]->_nodes[j];
+      }
+    }
+  }
+
+  return count;
+}
+
+// Internal method, computes the distances between the nodes of a cluster
+void hpa_build_edges(HpaGraph *graph, uint32_t cluster) {
+  hpa_load_cluster(graph, cluster);
+  uint32_t count = hpa_gather_nodes(graph, cluster);
+
+  for (uint32_t i = 0; i < count; i++) {
+    HpaNode *node = &graph->_nodes[graph->_cluster_nodes[i]];
+    node->_edges_size = 0;
+    hpa_local_search(graph, node->_x, node->_y);
+
+    for (uint32_t j = 0; j < count; j++) {
+      HpaNode const *other = &graph->_nodes[graph->_cluster_nodes[j]];
+      uint32_t       distance = hpa_local_distance(graph, other->_x, other->_y);
+      if (i == j || distance == HPA_NONE) {
+        continue;
+      }
+
+      if (node->_edges_size == node->_edges_capacity) {
+        node->_edges_capacity = max(node->_edges_capacity * 2, MIN_HPA_CAPACITY);
+        node->_edges = realloc(node->_edges, node->_edges_capacity * sizeof(HpaEdge));
+      }
+      node->_edges[node->_edges_size++] = (HpaEdge){._target = graph->_cluster_nodes[j], ._cost = distance};
+    }
+  }
+}
+
+// Internal method, brings the graph up to date with the tiles of the map.
+// The entrances of a cluster whose tiles changed are computed again, as well
+// as the edges of the cluster and of its eight neighbours.
+void hpa_graph_sync(HpaGraph *graph) {
+  uint64_t changes = map_count_tile_changes(graph->_map);
+  graph->_rebuilt = 0;
+  if (graph->_built && graph->_changes == changes) {
+    return;
+  }
+
+  uint32_t clusters = graph->_clusters_x * graph->_clusters_y;
+  for (uint32_t cluster = 0; cluster < clusters; cluster++) {
+    uint32_t cluster_x = cluster % graph->_clusters_x;
+    uint32_t cluster_y = cluster / graph->_clusters_x;
+    uint32_t from_x = cluster_x * HPA_CLUSTER_SIZE;
+    uint32_t from_y = cluster_y * HPA_CLUSTER_SIZE;
+    uint64_t revision = map_get_tiles_revision(graph->_map, from_x, from_y, from_x + HPA_CLUSTER_SIZE - 1, from_y + HPA_CLUSTER_SIZE - 1);
+    if (graph->_built && graph->_revisions[cluster] == revision) {
+      continue;
+    }
+
+    graph->_revisions[cluster] = revision;
+    graph->_rebuilt++;
+    for (uint32_t neighbour_y = cluster_y > 0 ? cluster_y - 1 : 0; neighbour_y <= cluster_y + 1 && neighbour_y < graph->_clusters_y;
+         neighbour_y++) {
+      for (uint32_t neighbour_x = cluster_x > 0 ? cluster_x - 1 : 0; neighbour_x <= cluster_x + 1 && neighbour_x < graph->_clusters_x;
+           neighbour_x++) {
+        graph->_marks[neighbour_x + neighbour_y * graph->_clusters_x] |= HPA_MARK_EDGES;
+      }
+    }
+
+    // The borders and corners touching the cluster
+    graph->_marks[cluster] |= HPA_MARK_EAST | HPA_MARK_SOUTH | HPA_MARK_CORNER;
+    if (cluster_x > 0) {
+      graph->_marks[cluster - 1] |= HPA_MARK_EAST | HPA_MARK_CORNER;
+    }
+    if (cluster_y > 0) {
+      graph->_marks[cluster - graph->_clusters_x] |= HPA_MARK_SOUTH | HPA_MARK_CORNER;
+    }
+    if (cluster_x > 0 && cluster_y > 0) {
+      graph->_marks[cluster - graph->_clusters_x - 1] |= HPA_MARK_CORNER;
+    }
+  }
+
+  for (uint32_t cluster = 0; cluster < clusters; cluster++) {
+    uint32_t cluster_x = cluster % graph->_clusters_x;
+    uint32_t cluster_y = cluster / graph->_clusters_x;
+    uint32_t from_x = cluster_x * HPA_CLUSTER_SIZE;
+    uint32_t from_y = cluster_y * HPA_CLUSTER_SIZE;
+
+    if ((graph->_marks[cluster] & HPA_MARK_EAST) && cluster_x + 1 < graph->_clusters_x) {
+      hpa_build_border(graph, &graph->_east[cluster], from_x + HPA_CLUSTER_SIZE - 1, from_y,
+                       min(HPA_CLUSTER_SIZE, graph->_y_size - from_y), 1, 0);
+    }
+
+    if ((graph->_marks[cluster] & HPA_MARK_SOUTH) && cluster_y + 1 < graph->_clusters_y) {
+      hpa_build_border(graph, &graph->_south[cluster], from_x, from_y + HPA_CLUSTER_SIZE - 1,
+                       min(HPA_CLUSTER_SIZE, graph->_x_size - from_x), 0, 1);
+    }
+
+    if ((graph->_marks[cluster] & HPA_MARK_CORNER) && cluster_x + 1 < graph->_clusters_x && cluster_y + 1 < graph->_clusters_y) {
+      hpa_build_corner(graph, &graph->_corners[cluster], from_x + HPA_CLUSTER_SIZE, from_y + HPA_CLUSTER_SIZE);
+    }
+  }
+
+  for (uint32_t cluster = 0; cluster < clusters; cluster++) {
+    if (graph->_marks[cluster] & HPA_MARK_EDGES) {
+      hpa_build_edges(graph, cluster);
+    }
+    graph->_marks[cluster] = 0;
+  }
+
+  graph->_built = true;
+  graph->_changes = changes;
+}
+
+// Internal method, opens a node with the given cost if it is better than
+// the one it already has.
+void hpa_relax(HpaGraph *graph, uint32_t id, uint32_t cost, uint32_t parent, uint32_t to_x, uint32_t to_y) {
+  HpaNode *node = &graph->_nodes[id];
+  if (node->_stamp != graph->_stamp) {
+    node->_stamp = graph->_stamp;
+    node->_cost = HPA_NONE;
+    node->_closed = false;
+  }
+
+  if (node->_closed || cost >= node->_cost) {
+    return;
+  }
+
+  node->_cost = cost;
+  node->_parent = parent;
+
+  // Binary heap with duplicates, outdated entries are skipped when popped
+  if (graph->_open_size == graph->_open_capacity) {
+    graph->_open_capacity = max(graph->_open_capacity * 2, MIN_HPA_CAPACITY);
+    graph->_open = realloc(graph->_open, graph->_open_capacity * sizeof(HpaOpen));
+  }
+
+  uint32_t estimate = hpa_distance(node->_x, node->_y, to_x, to_y);
+  HpaOpen  entry = {._total = cost + estimate, ._estimate = estimate, ._node = id};
+  uint32_t position = graph->_open_size++;
+  while (position > 0) {
+    HpaOpen const *parent_entry = &graph->_open[(position - 1) / 2];
+    if (parent_entry->_total < entry._total || (parent_entry->_total == entry._total && parent_entry->_estimate <= entry._estimate)) {
+      break;
+    }
+    graph->_open[position] = *parent_entry;
+    position = (position - 1) / 2;
+  }
+  graph->_open[position] = entry;
+}
+
+// Internal method
+HpaOpen hpa_pop(HpaGraph *graph) {
+  HpaOpen ret = graph->_open[0];
+  HpaOpen last = graph->_open[--graph->_open_size];
+
+  uint32_t position = 0;
+  while (true) {
+    uint32_t child = 2 * position + 1;
+    if (child >= graph->_open_size) {
+      break;
+    }
+
+    HpaOpen const *candidate = &graph->_open[child];
+    if (child + 1 < graph->_open_size) {
+      HpaOpen const *right = &graph->_open[child + 1];
+      if (right->_total < candidate->_total || (right->_total == candidate->_total && right->_estimate < candidate->_estimate)) {
+        candidate = right;
+        child++;
+      }
+    }
+
+    if (last._total < candidate->_total || (last._total == candidate->_total && last._estimate <= candidate->_estimate)) {
+      break;
+    }
+
+    graph->_open[position] = *candidate;
+    position = child;
+  }
+
+  if (graph->_open_size > 0) {
+    graph->_open[position] = last;
+  }
+
+  return ret;
+}
+
+// Internal method, turns the abstract path ending with the given node into
+// tiles, one cluster at a time.
+void hpa_refine(HpaGraph *graph, uint32_t last, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  uint32_t count = 0;
+  for (uint32_t id = last; id != HPA_NONE; id = graph->_nodes[id]._parent) {
+    count++;
+  }
+
+  if (count > graph->_abstract_capacity) {
+    graph->_abstract_capacity = max(count, graph->_abstract_capacity * 2);
+    graph->_abstract = realloc(graph->_abstract, graph->_abstract_capacity * sizeof(uint32_t));
+  }
+
+  uint32_t index = count;
+  for (uint32_t id = last; id != HPA_NONE; id = graph->_nodes[id]._parent) {
+    graph->_abstract[--index] = id;
+  }
+
+  // The start may not be traversable (an entity can be standing anywhere),
+  // so the first part of the path is searched from the start and reversed.
+  HpaNode const *first = &graph->_nodes[graph->_abstract[0]];
+  hpa_load_cluster(graph, first->_cluster);
+  hpa_local_search(graph, from_x, from_y);
+  hpa_append_step(graph, first->_x, first->_y);
+  hpa_append_local_path(graph, first->_x, first->_y);
+  graph->_path_length--;
+  for (uint32_t i = 0; i < graph->_path_length / 2; i++) {
+    PathStep step = graph->_path[i];
+    graph->_path[i] = graph->_path[graph->_path_length - 1 - i];
+    graph->_path[graph->_path_length - 1 - i] = step;
+  }
+
+  for (uint32_t i = 0; i + 1 < count; i++) {
+    HpaNode const *current = &graph->_nodes[graph->_abstract[i]];
+    HpaNode const *next = &graph->_nodes[graph->_abstract[i + 1]];
+    if (current->_twin == graph->_abstract[i + 1]) {
+      hpa_append_step(graph, next->_x, next->_y);
+    } else {
+      hpa_load_cluster(graph, current->_cluster);
+      hpa_local_search(graph, next->_x, next->_y);
+      hpa_append_local_path(graph, current->_x, current->_y);
+    }
+  }
+
+  HpaNode const *end = &graph->_nodes[last];
+  hpa_load_cluster(graph, end->_cluster);
+  hpa_local_search(graph, to_x, to_y);
+  hpa_append_local_path(graph, end->_x, end->_y);
+}
+
+bool hpa_graph_search(HpaGraph *graph, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  graph->_path_length = 0;
+  if (from_x >= graph->_x_size || from_y >= graph->_y_size || to_x >= graph->_x_size || to_y >= graph->_y_size ||
+      !hpa_is_traversable(graph, to_x, to_y)) {
+    return false;
+  }
+
+  hpa_graph_sync(graph);
+
+  // No need to search for what cannot be found
+  if (hpa_is_traversable(graph, from_x, from_y) && !map_same_region(graph->_map, from_x, from_y, to_x, to_y)) {
+    return false;
+  }
+
+  if (graph->_stamp == UINT32_MAX) {
+    for (uint32_t i = 0; i < graph->_nodes_size; i++) {
+      graph->_nodes[i]._stamp = 0;
+      graph->_nodes[i]._goal_stamp = 0;
+    }
+    graph->_stamp = 0;
+  }
+  graph->_stamp++;
+  graph->_open_size = 0;
+
+  uint32_t from_cluster = hpa_cluster_of(graph, from_x, from_y);
+  uint32_t to_cluster = hpa_cluster_of(graph, to_x, to_y);
+
+  // Distances from the destination to the entrances of its cluster, which
+  // is enough when both ends are inside of the same cluster.
+  hpa_load_cluster(graph, to_cluster);
+  hpa_local_search(graph, to_x, to_y);
+  if (from_cluster == to_cluster && hpa_local_distance(graph, from_x, from_y) != HPA_NONE) {
+    hpa_append_local_path(graph, from_x, from_y);
+    return true;
+  }
+
+  uint32_t count = hpa_gather_nodes(graph, to_cluster);
+  for (uint32_t i = 0; i < count; i++) {
+    HpaNode *node = &graph->_nodes[graph->_cluster_nodes[i]];
+    node->_goal_stamp = graph->_stamp;
+    node->_goal_cost = hpa_local_distance(graph, node->_x, node->_y);
+  }
+
+  hpa_load_cluster(graph, from_cluster);
+  hpa_local_search(graph, from_x, from_y);
+  count = hpa_gather_nodes(graph, from_cluster);
+  for (uint32_t i = 0; i < count; i++) {
+    HpaNode const *node = &graph->_nodes[graph->_cluster_nodes[i]];
+    uint32_t       distance = hpa_local_distance(graph, node->_x, node->_y);
+    if (distance != HPA_NONE) {
+      hpa_relax(graph, graph->_cluster_nodes[i], distance, HPA_NONE, to_x, to_y);
+    }
+  }
+
+  uint32_t best_cost = HPA_NONE;
+  uint32_t best_node = HPA_NONE;
+  while (graph->_open_size > 0) {
+    HpaOpen  entry = hpa_pop(graph);
+    HpaNode *node = &graph->_nodes[entry._node];
+    if (node->_closed || entry._total != node->_cost + entry._estimate) {
+      continue;
+    }
+
+    if (entry._total >= best_cost) {
+      break;
+    }
+    node->_closed = true;
+
+    if (node->_goal_stamp == graph->_stamp && node->_goal_cost != HPA_NONE && node->_cost + node->_goal_cost < best_cost) {
+      best_cost = node->_cost + node->_goal_cost;
+      best_node = entry._node;
+    }
+
+    uint32_t cost = node->_cost;
+    hpa_relax(graph, node->_twin, cost + 1, entry._node, to_x, to_y);
+    for (uint32_t i = 0; i < graph->_nodes[entry._node]._edges_size; i++) {
+      HpaEdge edge = graph->_nodes[entry._node]._edges[i];
+      hpa_relax(graph, edge._target, cost + edge._cost, entry._node, to_x, to_y);
+    }
+  }
+
+  if (best_node == HPA_NONE) {
+    return false;
+  }
+
+  hpa_refine(graph, best_node, from_x, from_y, to_x, to_y);
+  return true;
+}
+
+inline uint32_t hpa_graph_get_length(HpaGraph const *graph) {
+  return graph->_path_length;
+}
+
+inline PathStep hpa_graph_get_step(HpaGraph const *graph, uint32_t index) {
+  assert(index < graph->_path_length);
+  return graph->_path[index];
+}
+
+uint32_t hpa_graph_count_entrances(HpaGraph *graph) {
+  hpa_graph_sync(graph);
+
+  uint32_t ret = 0;
+  for (size_t i = 0; i < (size_t)graph->_clusters_x * graph->_clusters_y; i++) {
+    ret += (graph->_east[i]._size + graph->_south[i]._size + graph->_corners[i]._size) / 2;
+  }
+
+  return ret;
+}
+
+inline uint32_t hpa_graph_count_rebuilt(HpaGraph const *graph) {
+  return graph->_rebuilt;
+}
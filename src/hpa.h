@@ -0,0 +1,61 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __HPA__H__
+#define __HPA__H__
+
+#include "map.h"
+#include "path.h"
+#include <stdint.h>
+
+/*
+ * Hierarchical path finder (HPA*) for the big maps. The map is split in
+ * square clusters, neighbouring clusters are linked by entrances (one for
+ * each run of traversable tiles along their common border) and the
+ * distances between the entrances of each cluster are precomputed. A search
+ * is then an A* over the entrances, refined into tiles one cluster at a time.
+ *
+ * Paths go through the traversable tiles and ignore the entities, they are
+ * close to the shortest ones but not always the shortest. The graph is
+ * updated before each search, only for the clusters whose tiles changed.
+ */
+typedef struct HpaGraph HpaGraph;
+
+#define HPA_CLUSTER_SIZE 16
+
+HpaGraph *hpa_graph_new(Map const *);
+void      hpa_graph_free(HpaGraph *);
+
+/*
+ * Searches a path between the two tiles, returns false if there is none.
+ * The path is kept until the next search.
+ */
+bool hpa_graph_search(HpaGraph *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+
+// Same as the PathFinder ones
+uint32_t hpa_graph_get_length(HpaGraph const *);
+PathStep hpa_graph_get_step(HpaGraph const *, uint32_t);
+
+// PERF: Only useful for tests
+uint32_t hpa_graph_count_entrances(HpaGraph *);
+uint32_t hpa_graph_count_rebuilt(HpaGraph const *); // Clusters updated by the last search
+
+#endif /* ifndef __HPA__H__ */
@@ -53,7 +53,8 @@ struct Item {
   uint32_t _weight;
   uint32_t _value;
   void    *_properties;
-  Point   *_coords;
+  Point    _coords;
+  bool     _has_coords;
 };
 
 struct WeaponProperties {
@@ -83,7 +84,7 @@ Item *item_new(ItemType item_type, const char *name, uint32_t weight, uint32_t v
   ret->_weight = weight;
   ret->_value = value;
   ret->_properties = nullptr;
-  ret->_coords = nullptr;
+  ret->_has_coords = false;
 
   return ret;
 }
@@ -129,7 +130,8 @@ Item *item_clone(Item const *origin) {
 
   if (item_has_coords(origin)) {
     LOG_DEBUG("Item has coordinates", 0);
-    ret->_coords = point_new(point_get_x(item_get_coords(origin)), point_get_y(item_get_coords(origin)));
+    ret->_coords = origin->_coords;
+    ret->_has_coords = true;
   }
 
   return ret;
@@ -240,8 +242,8 @@ void item_serialize(Item const *item, msgpack_sbuffer *buffer) {
   serde_pack_str(&packer, "coords");
   if (item_has_coords(item)) {
     msgpack_pack_array(&packer, 2);
-    msgpack_pack_uint32(&packer, point_get_x(item->_coords));
-    msgpack_pack_uint32(&packer, point_get_y(item->_coords));
+    msgpack_pack_uint32(&packer, item->_coords.x);
+    msgpack_pack_uint32(&packer, item->_coords.y);
   } else {
     msgpack_pack_array(&packer, 0);
   }
@@ -274,8 +276,6 @@ void item_free(Item *item) {
     free(item->_properties);
   }
 
-  item_clear_coords(item);
-
   free(item->_name);
   free(item);
 }
@@ -305,10 +305,14 @@ inline ItemType item_get_type(Item const *item) {
 }
 
 inline bool item_has_coords(Item const *item) {
-  return item->_coords != nullptr;
+  return item->_has_coords;
 }
 
 inline Point const *item_get_coords(Item const *item) {
+  return item->_has_coords ? &item->_coords : nullptr;
+}
+
+inline Point item_get_position(Item const *item) {
   return item->_coords;
 }
 
@@ -346,18 +350,16 @@ inline uint8_t armor_get_armor_class(ArmorProperties const *armor) {
 
 void item_set_coords(Item *item, uint32_t x, uint32_t y) {
   LOG_INFO("Setting coords for item '%s'", item_get_name(item));
-  item_clear_coords(item);
-
-  item->_coords = point_new(x, y);
+  item->_coords = point_at(x, y);
+  item->_has_coords = true;
 }
 
 void item_clear_coords(Item *item) {
   if (item_has_coords(item)) {
     LOG_INFO("Cleaning coords for item '%s'", item_get_name(item));
-    point_free(item->_coords);
   }
 
-  item->_coords = nullptr;
+  item->_has_coords = false;
 }
 
 void item_deserialize_check_map(msgpack_object_map const *msgpack_map) {
@@ -59,7 +59,8 @@ uint32_t     item_get_weight(Item const *);
 uint32_t     item_get_value(Item const *);
 ItemType     item_get_type(Item const *);
 bool         item_has_coords(Item const *);
-Point const *item_get_coords(Item const *);
+Point const *item_get_coords(Item const *);  // nullptr if the item has no coordinates
+Point        item_get_position(Item const *); // Only meaningful if the item has coordinates
 
 // Getters for Weapon
 uint8_t  weapon_get_hands(WeaponProperties const *);
@@ -0,0 +1,298 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "light.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Changes of base light are tracked by blocks of tiles
+#define LIGHT_BLOCK_SIZE 16
+
+#define MIN_LIGHT_CAPACITY 8
+
+// Inclusive rectangle of tiles
+typedef struct LightRect {
+  uint32_t _from_x;
+  uint32_t _from_y;
+  uint32_t _to_x;
+  uint32_t _to_y;
+} LightRect;
+
+typedef struct LightSource {
+  uint32_t _x;
+  uint32_t _y;
+  uint32_t _radius;
+  uint8_t  _intensity;
+  uint8_t *_kernel; // Light added to the square of side 2 * radius + 1 around the source
+  bool     _alive;
+} LightSource;
+
+struct LightMap {
+  Map const *_map;
+  uint32_t   _x_size;
+  uint32_t   _y_size;
+  uint8_t   *_levels;
+  uint64_t   _revision;
+
+  LightSource *_sources;
+  uint32_t     _sources_size;
+  uint32_t     _sources_capacity;
+  uint32_t     _sources_count;
+  uint32_t    *_free_sources;
+  uint32_t     _free_sources_size;
+
+  // Rectangles to compute again at the next update
+  LightRect *_dirty;
+  uint32_t   _dirty_size;
+  uint32_t   _dirty_capacity;
+
+  // Tiles revision of each block as of the last update
+  uint64_t *_block_revisions;
+  uint32_t  _blocks_x;
+  uint32_t  _blocks_y;
+  uint64_t  _tile_changes;
+  bool      _built;
+};
+
+LightMap *light_map_new(Map const *map) {
+  MapBoundaries boundaries = map_get_boundaries(map);
+
+  LightMap *ret = calloc(1, sizeof(LightMap));
+  ret->_map = map;
+  ret->_x_size = boundaries.x;
+  ret->_y_size = boundaries.y;
+  ret->_levels = calloc((size_t)boundaries.x * boundaries.y, sizeof(uint8_t));
+  ret->_blocks_x = (boundaries.x + LIGHT_BLOCK_SIZE - 1) / LIGHT_BLOCK_SIZE;
+  ret->_blocks_y = (boundaries.y + LIGHT_BLOCK_SIZE - 1) / LIGHT_BLOCK_SIZE;
+  ret->_block_revisions = calloc((size_t)ret->_blocks_x * ret->_blocks_y, sizeof(uint64_t));
+  ret->_built = false;
+  return ret;
+}
+
+void light_map_free(LightMap *light_map) {
+  for (uint32_t i = 0; i < light_map->_sources_size; i++) {
+    free(light_map->_sources[i]._kernel);
+  }
+
+  free(light_map->_sources);
+  free(light_map->_free_sources);
+  free(light_map->_dirty);
+  free(light_map->_block_revisions);
+  free(light_map->_levels);
+  free(light_map);
+}
+
+// Internal method, clips the rectangle to the map
+void light_map_mark_dirty(LightMap *light_map, int64_t from_x, int64_t from_y, int64_t to_x, int64_t to_y) {
+  if (to_x < 0 || to_y < 0 || from_x >= light_map->_x_size || from_y >= light_map->_y_size) {
+    return;
+  }
+
+  if (light_map->_dirty_size == light_map->_dirty_capacity) {
+    light_map->_dirty_capacity = max(light_map->_dirty_capacity * 2, MIN_LIGHT_CAPACITY);
+    light_map->_dirty = realloc(light_map->_dirty, light_map->_dirty_capacity * sizeof(LightRect));
+  }
+
+  light_map->_dirty[light_map->_dirty_size++] = (LightRect){
+    ._from_x = from_x < 0 ? 0 : from_x,
+    ._from_y = from_y < 0 ? 0 : from_y,
+    ._to_x = to_x >= light_map->_x_size ? light_map->_x_size - 1 : to_x,
+    ._to_y = to_y >= light_map->_y_size ? light_map->_y_size - 1 : to_y,
+  };
+}
+
+// Internal method
+static inline void light_map_mark_source(LightMap *light_map, LightSource const *source) {
+  int64_t radius = source->_radius;
+  light_map_mark_dirty(light_map, (int64_t)source->_x - radius, (int64_t)source->_y - radius, (int64_t)source->_x + radius,
+                       (int64_t)source->_y + radius);
+}
+
+uint32_t light_map_add_source(LightMap *light_map, uint32_t x, uint32_t y, uint32_t radius, uint8_t intensity) {
+  uint32_t id;
+  if (light_map->_free_sources_size > 0) {
+    id = light_map->_free_sources[--light_map->_free_sources_size];
+  } else {
+    if (light_map->_sources_size == light_map->_sources_capacity) {
+      light_map->_sources_capacity = max(light_map->_sources_capacity * 2, MIN_LIGHT_CAPACITY);
+      light_map->_sources = realloc(light_map->_sources, light_map->_sources_capacity * sizeof(LightSource));
+      light_map->_free_sources = realloc(light_map->_free_sources, light_map->_sources_capacity * sizeof(uint32_t));
+    }
+    id = light_map->_sources_size++;
+  }
+
+  // Quadratic falloff, computed once for all
+  uint32_t side = 2 * radius + 1;
+  uint64_t range = ((uint64_t)radius + 1) * (radius + 1);
+  uint8_t *kernel = malloc((size_t)side * side);
+  for (uint32_t j = 0; j < side; j++) {
+    for (uint32_t i = 0; i < side; i++) {
+      int64_t  dx = (int64_t)i - radius;
+      int64_t  dy = (int64_t)j - radius;
+      uint64_t distance = dx * dx + dy * dy;
+      kernel[i + j * side] = distance <= (uint64_t)radius * radius ? intensity * (range - distance) / range : 0;
+    }
+  }
+
+  light_map->_sources[id] = (LightSource){
+    ._x = x,
+    ._y = y,
+    ._radius = radius,
+    ._intensity = intensity,
+    ._kernel = kernel,
+    ._alive = true,
+  };
+  light_map->_sources_count++;
+  light_map_mark_source(light_map, &light_map->_sources[id]);
+  return id;
+}
+
+void light_map_move_source(LightMap *light_map, uint32_t id, uint32_t x, uint32_t y) {
+  if (id >= light_map->_sources_size || !light_map->_sources[id]._alive) {
+    return;
+  }
+
+  LightSource *source = &light_map->_sources[id];
+  if (source->_x == x && source->_y == y) {
+    return;
+  }
+
+  light_map_mark_source(light_map, source);
+  source->_x = x;
+  source->_y = y;
+  light_map_mark_source(light_map, source);
+}
+
+void light_map_remove_source(LightMap *light_map, uint32_t id) {
+  if (id >= light_map->_sources_size || !light_map->_sources[id]._alive) {
+    return;
+  }
+
+  LightSource *source = &light_map->_sources[id];
+  light_map_mark_source(light_map, source);
+  free(source->_kernel);
+  source->_kernel = nullptr;
+  source->_alive = false;
+  light_map->_free_sources[light_map->_free_sources_size++] = id;
+  light_map->_sources_count--;
+}
+
+inline uint32_t light_map_count_sources(LightMap const *light_map) {
+  return light_map->_sources_count;
+}
+
+// Internal method, saturated sum of two rows of levels. Kept trivial so that
+// the compiler turns it into vector instructions.
+static inline void light_add_row(uint8_t *restrict levels, uint8_t const *restrict kernel, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    uint32_t sum = levels[i] + kernel[i];
+    levels[i] = sum > LIGHT_MAX_LEVEL ? LIGHT_MAX_LEVEL : sum;
+  }
+}
+
+// Internal method, computes the levels of a rectangle from scratch
+void light_map_compute(LightMap *light_map, LightRect const *rect) {
+  for (uint32_t y = rect->_from_y; y <= rect->_to_y; y++) {
+    for (uint32_t x = rect->_from_x; x <= rect->_to_x; x++) {
+      light_map->_levels[x + (size_t)y * light_map->_x_size] = min(map_get_tile(light_map->_map, x, y).base_light, LIGHT_MAX_LEVEL);
+    }
+  }
+
+  for (uint32_t i = 0; i < light_map->_sources_size; i++) {
+    LightSource const *source = &light_map->_sources[i];
+    if (!source->_alive) {
+      continue;
+    }
+
+    // Part of the kernel overlapping the rectangle
+    int64_t origin_x = (int64_t)source->_x - source->_radius;
+    int64_t origin_y = (int64_t)source->_y - source->_radius;
+    int64_t from_x = origin_x > rect->_from_x ? origin_x : rect->_from_x;
+    int64_t from_y = origin_y > rect->_from_y ? origin_y : rect->_from_y;
+    int64_t to_x = (int64_t)source->_x + source->_radius < rect->_to_x ? (int64_t)source->_x + source->_radius : rect->_to_x;
+    int64_t to_y = (int64_t)source->_y + source->_radius < rect->_to_y ? (int64_t)source->_y + source->_radius : rect->_to_y;
+    if (from_x > to_x || from_y > to_y) {
+      continue;
+    }
+
+    size_t side = 2 * (size_t)source->_radius + 1;
+    for (int64_t y = from_y; y <= to_y; y++) {
+      light_add_row(&light_map->_levels[from_x + y * light_map->_x_size], &source->_kernel[(from_x - origin_x) + (y - origin_y) * side],
+                    to_x - from_x + 1);
+    }
+  }
+}
+
+bool light_map_update(LightMap *light_map) {
+  uint64_t changes = map_count_tile_changes(light_map->_map);
+  if (!light_map->_built || changes != light_map->_tile_changes) {
+    for (uint32_t block_y = 0; block_y < light_map->_blocks_y; block_y++) {
+      for (uint32_t block_x = 0; block_x < light_map->_blocks_x; block_x++) {
+        uint32_t  from_x = block_x * LIGHT_BLOCK_SIZE;
+        uint32_t  from_y = block_y * LIGHT_BLOCK_SIZE;
+        uint64_t  revision = map_get_tiles_revision(light_map->_map, from_x, from_y, from_x + LIGHT_BLOCK_SIZE - 1, from_y + LIGHT_BLOCK_SIZE - 1);
+        uint64_t *known = &light_map->_block_revisions[block_x + (size_t)block_y * light_map->_blocks_x];
+        if (light_map->_built && *known != revision) {
+          light_map_mark_dirty(light_map, from_x, from_y, from_x + LIGHT_BLOCK_SIZE - 1, from_y + LIGHT_BLOCK_SIZE - 1);
+        }
+        *known = revision;
+      }
+    }
+
+    if (!light_map->_built) {
+      light_map->_dirty_size = 0;
+      light_map_mark_dirty(light_map, 0, 0, light_map->_x_size - 1, light_map->_y_size - 1);
+    }
+
+    light_map->_built = true;
+    light_map->_tile_changes = changes;
+  }
+
+  if (light_map->_dirty_size == 0) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < light_map->_dirty_size; i++) {
+    light_map_compute(light_map, &light_map->_dirty[i]);
+  }
+
+  light_map->_dirty_size = 0;
+  light_map->_revision++;
+  return true;
+}
+
+inline uint8_t const *light_map_get_levels(LightMap const *light_map) {
+  return light_map->_levels;
+}
+
+inline uint8_t light_map_get_level(LightMap const *light_map, uint32_t x, uint32_t y) {
+  if (x >= light_map->_x_size || y >= light_map->_y_size) {
+    return 0;
+  }
+
+  return light_map->_levels[x + (size_t)y * light_map->_x_size];
+}
+
+inline uint64_t light_map_get_revision(LightMap const *light_map) {
+  return light_map->_revision;
+}
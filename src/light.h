@@ -0,0 +1,58 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __LIGHT__H__
+#define __LIGHT__H__
+
+#include "map.h"
+#include <stdint.h>
+
+/*
+ * Light level of every tile of a map: the base light of the tile plus the
+ * light of the point sources (torches and the like) around it, fading with
+ * the distance. Levels use the same scale as the base light of the tiles.
+ *
+ * Changes are not applied right away, light_map_update() only computes again
+ * the tiles around the sources which changed and the tiles whose base light
+ * changed.
+ */
+typedef struct LightMap LightMap;
+
+#define LIGHT_MAX_LEVEL 10
+
+LightMap *light_map_new(Map const *);
+void      light_map_free(LightMap *);
+
+// Light sources are identified by the value returned when adding them
+uint32_t light_map_add_source(LightMap *, uint32_t x, uint32_t y, uint32_t radius, uint8_t intensity);
+void     light_map_move_source(LightMap *, uint32_t, uint32_t x, uint32_t y);
+void     light_map_remove_source(LightMap *, uint32_t);
+uint32_t light_map_count_sources(LightMap const *);
+
+// Returns false if there was nothing to update
+bool light_map_update(LightMap *);
+
+// Levels as of the last update, one per tile at x + y * width
+uint8_t const *light_map_get_levels(LightMap const *);
+uint8_t        light_map_get_level(LightMap const *, uint32_t x, uint32_t y);
+uint64_t       light_map_get_revision(LightMap const *); // Bumped by every update
+
+#endif /* ifndef __LIGHT__H__ */
@@ -20,6 +20,10 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "map.h"
+#include "chunk_store.h"
+#include "collections/hash_index.h"
+#include "collections/spatial_grid.h"
+#include "collections/union_find.h"
 #include "entity.h"
 #include "item.h"
 #include "logger.h"
@@ -39,45 +43,944 @@
 #include <string.h>
 #include <sys/types.h>
 
+#define CHUNK_SIZE  16
+#define CHUNK_TILES (CHUNK_SIZE * CHUNK_SIZE)
+
+// Size of the cells of the spatial grid indexing the entities
+#define ENTITIES_CELL_SIZE 16
+
+// Smallest size of the entity and item tables once they start growing
+#define MIN_ENTITIES_CAPACITY 8
+#define MIN_ITEMS_CAPACITY    8
+
+// Size of the cells of the spatial grid indexing the items
+#define ITEMS_CELL_SIZE 16
+
+// A chunk stores its tiles as a structure of arrays, indexed by
+// map_chunk_tile_index(), the coordinates are implied by the index.
+typedef struct TileChunk {
+  uint8_t _kinds[CHUNK_TILES];
+  uint8_t _noise[CHUNK_TILES];
+  uint8_t _light[CHUNK_TILES];
+  uint8_t _flags[CHUNK_TILES];
+
+  // Streaming bookkeeping, see ChunkCache
+  size_t            _index;
+  uint64_t          _epoch;
+  bool              _dirty;
+  struct TileChunk *_prev;
+  struct TileChunk *_next;
+} TileChunk;
+
+// All the materialized chunks are linked together, most recently used first.
+// When a store is attached, map_stream_around() writes the least recently used
+// chunks to it and evicts them as long as there are more than _budget of them,
+// they are loaded back transparently the next time one of their tiles is read.
+// Chunks streamed in or written since the last map_stream_around() are pinned
+// (their epoch is the current one), the ones loaded back by reads are not and
+// make room for themselves by evicting the others.
+//
+// This lives outside of Map because chunks are loaded back from the const
+// accessors as well.
+typedef struct ChunkCache {
+  TileChunk  *_head;
+  TileChunk  *_tail;
+  uint32_t    _resident;
+  uint32_t    _budget;
+  uint64_t    _epoch;
+  ChunkStore *_store;
+  bool       *_stored; // One per chunk, true if the store holds a copy
+} ChunkCache;
+
+// Handles point to slots, a slot knows where its entity currently is inside of
+// the dense array of entities. The generation is bumped every time the entity
+// of the slot is removed, so that old handles can be detected.
+typedef struct EntitySlot {
+  uint32_t _dense_index;
+  uint32_t _generation;
+} EntitySlot;
+
+#define MAP_NO_REGION     UINT32_MAX
+#define MIN_REGION_LABELS 64
+
+// Groups of traversable tiles connected to each other. Each traversable tile
+// has a label, the labels of the same region being in the same set. They are
+// only built by the first query: tiles becoming traversable merge the regions
+// around them right away, while tiles becoming blocked label again the parts
+// of the region they split, if any. Bulk writes build everything again.
+typedef struct MapRegions {
+  UnionFind *_sets;   // Of labels
+  uint32_t  *_labels; // Of each tile (x + y * _x_size), meaningless for the blocked ones
+  uint32_t   _labels_size;
+  size_t    *_queue;
+  size_t     _queue_capacity;
+  bool       _stale;
+} MapRegions;
+
+typedef struct OccupancyChunk {
+  uint32_t _count;
+  Entity  *_slots[CHUNK_TILES];
+} OccupancyChunk;
+
 struct Map {
   uint32_t _x_size;
   uint32_t _y_size;
   uint32_t _last_index;
   uint32_t _entities_size;
   uint32_t _items_size;
+  uint32_t _items_capacity;
   char    *_name;
   Entity **_entities;
   Item   **_items;
-  Tile   **_tiles;
+
+  // Tiles are grouped in square chunks which are only allocated once one of
+  // their tiles is modified, until then all the tiles of the chunk are read
+  // from DEFAULT_CHUNK.
+  uint32_t    _chunks_x;
+  uint32_t    _chunks_y;
+  TileChunk **_tile_chunks;
+  ChunkCache *_chunk_cache;
+
+  // One counter per chunk, bumped every time one of its tiles changes. Unlike
+  // the chunks themselves they are never evicted. There is one more counter
+  // at the end, for the whole map.
+  uint64_t *_tile_revisions;
+
+  MapRegions *_regions;
+
+  // One bitplane per MapPlane, kept in sync with the tiles and the occupancy,
+  // each row takes _plane_words words.
+  uint64_t *_planes[MAP_PLANES];
+  uint32_t  _plane_words;
+
+  // One slot per tile, pointing to the entity standing on it (if any). This
+  // is kept in sync by map_add_entity(), map_remove_entity() and
+  // map_move_entity() so that "who is at (x, y)" is a constant time lookup.
+  // Slots are grouped in chunks as well, which only exist while there is
+  // at least one entity inside of them.
+  OccupancyChunk **_occupancy;
+
+  // Entities are packed in _entities[0, _last_index), removing one of them
+  // moves the last one in its place.
+  EntitySlot *_entity_slots;
+  uint32_t   *_dense_slots; // Index in _entities -> slot of the entity
+  uint32_t   *_free_slots;
+  uint32_t    _free_slots_count;
+  uint32_t    _used_slots; // Slots which have been handed out at least once
+
+  // Hot stats of the entities, slot i being the one of _entities[i]
+  EntityStats *_stats;
+
+  // Entity name -> slot
+  HashIndex *_entities_index;
+
+  // Entities bucketed by position, for area queries
+  SpatialGrid *_entities_grid;
+
+  // Items are packed in _items[0, _items_size) like the entities, the index
+  // maps their names to their position inside _items.
+  HashIndex   *_items_index;
+  SpatialGrid *_items_grid;
 };
 
-Map *map_new(uint32_t x_size, uint32_t y_size, uint32_t max_entities, char const *name) {
-  Map *ret = calloc(1, sizeof(Map));
-  ret->_x_size = x_size;
-  ret->_y_size = y_size;
-  ret->_last_index = 0;
-  ret->_entities_size = max_entities;
-  ret->_name = strdup(name);
+// Tiles are stored column by column like in the chunks, so that stamping
+// copies whole columns at once.
+struct MapPrefab {
+  uint32_t _x_size;
+  uint32_t _y_size;
+  uint8_t *_kinds;
+  uint8_t *_light;
+  uint8_t *_flags;
+};
+
+typedef enum TileFlags {
+  TILE_FLAG_INSIDE = 1 << 0,
+  TILE_FLAG_TRAVERSABLE = 1 << 1,
+} TileFlags;
+
+// Values for freshly created tiles, same as tile_new()
+#define DEFAULT_TILE_KIND  GRASS
+#define DEFAULT_TILE_NOISE 3
+#define DEFAULT_TILE_LIGHT 10
+#define DEFAULT_TILE_FLAGS TILE_FLAG_TRAVERSABLE
+
+// Shared by all the chunks which have never been modified
+static TileChunk const DEFAULT_CHUNK = {
+  ._kinds = {[0 ... CHUNK_TILES - 1] = DEFAULT_TILE_KIND},
+  ._noise = {[0 ... CHUNK_TILES - 1] = DEFAULT_TILE_NOISE},
+  ._light = {[0 ... CHUNK_TILES - 1] = DEFAULT_TILE_LIGHT},
+  ._flags = {[0 ... CHUNK_TILES - 1] = DEFAULT_TILE_FLAGS},
+};
+
+static inline bool map_in_bounds(Map const *map, uint32_t x, uint32_t y) {
+  return x < map->_x_size && y < map->_y_size;
+}
+
+static inline size_t map_chunk_index(Map const *map, uint32_t x, uint32_t y) {
+  return (y / CHUNK_SIZE) + ((size_t)(x / CHUNK_SIZE) * map->_chunks_y);
+}
+
+static inline size_t map_chunk_tile_index(uint32_t x, uint32_t y) {
+  return (y % CHUNK_SIZE) + ((x % CHUNK_SIZE) * CHUNK_SIZE);
+}
+
+static inline void map_set_plane(Map const *map, MapPlane plane, uint32_t x, uint32_t y, bool value) {
+  uint64_t *word = &map->_planes[plane][x / 64 + (size_t)y * map->_plane_words];
+  uint64_t  bit = 1ULL << (x % 64);
+  *word = value ? *word | bit : *word & ~bit;
+}
 
-  unsigned long tiles_size = (unsigned long)x_size * y_size;
+// Internal method, the planes of a tile depending on its properties
+static inline void map_set_tile_planes(Map const *map, uint32_t x, uint32_t y, uint8_t light, uint8_t flags) {
+  map_set_plane(map, MAP_PLANE_TRAVERSABLE, x, y, (flags & TILE_FLAG_TRAVERSABLE) != 0);
+  map_set_plane(map, MAP_PLANE_INSIDE, x, y, (flags & TILE_FLAG_INSIDE) != 0);
+  map_set_plane(map, MAP_PLANE_LIT, x, y, light > 0);
+}
+
+// Internal method, allocates the planes for tiles which are all default ones
+void map_allocate_planes(Map *map) {
+  map->_plane_words = (map->_x_size + 63) / 64;
+  for (uint32_t plane = 0; plane < MAP_PLANES; plane++) {
+    map->_planes[plane] = calloc((size_t)map->_plane_words * map->_y_size, sizeof(uint64_t));
+  }
+
+  // Only the bits inside of the map are set
+  uint64_t last_word = map->_x_size % 64 == 0 ? UINT64_MAX : (1ULL << (map->_x_size % 64)) - 1;
+  for (uint32_t y = 0; y < map->_y_size; y++) {
+    for (uint32_t word = 0; word < map->_plane_words; word++) {
+      uint64_t bits = word + 1 == map->_plane_words ? last_word : UINT64_MAX;
+      size_t   index = word + (size_t)y * map->_plane_words;
+      map->_planes[MAP_PLANE_TRAVERSABLE][index] = (DEFAULT_TILE_FLAGS & TILE_FLAG_TRAVERSABLE) != 0 ? bits : 0;
+      map->_planes[MAP_PLANE_INSIDE][index] = (DEFAULT_TILE_FLAGS & TILE_FLAG_INSIDE) != 0 ? bits : 0;
+      map->_planes[MAP_PLANE_LIT][index] = DEFAULT_TILE_LIGHT > 0 ? bits : 0;
+    }
+  }
+}
 
-  // Create the tiles array, store all the xs then all the ys
-  ret->_tiles = calloc(tiles_size, sizeof(Tile **));
-  uint32_t current_index = 0;
-  for (uint32_t x = 0; x < x_size; x++) {
-    for (uint32_t y = 0; y < y_size; y++) {
-      ret->_tiles[current_index] = tile_new(GRASS, x, y);
-      current_index++;
+// Internal method, refreshes the planes of all the tiles of a chunk, used when
+// the chunk does not come from the tile writers (e.g. when deserializing).
+void map_set_chunk_planes(Map const *map, TileChunk const *chunk) {
+  uint32_t const from_x = (uint32_t)(chunk->_index / map->_chunks_y) * CHUNK_SIZE;
+  uint32_t const from_y = (uint32_t)(chunk->_index % map->_chunks_y) * CHUNK_SIZE;
+  uint32_t const to_x = min(from_x + CHUNK_SIZE, map->_x_size);
+  uint32_t const to_y = min(from_y + CHUNK_SIZE, map->_y_size);
+
+  for (uint32_t x = from_x; x < to_x; x++) {
+    for (uint32_t y = from_y; y < to_y; y++) {
+      size_t index = map_chunk_tile_index(x, y);
+      map_set_tile_planes(map, x, y, chunk->_light[index], chunk->_flags[index]);
     }
   }
+}
+
+// Internal method, allocates the chunks directory, all the chunks start as
+// non-materialized.
+void map_allocate_tiles(Map *map) {
+  map->_chunks_x = (map->_x_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  map->_chunks_y = (map->_y_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  map->_tile_chunks = calloc((size_t)map->_chunks_x * map->_chunks_y, sizeof(TileChunk *));
+  map->_occupancy = calloc((size_t)map->_chunks_x * map->_chunks_y, sizeof(OccupancyChunk *));
+  map->_chunk_cache = calloc(1, sizeof(ChunkCache));
+  map->_tile_revisions = calloc((size_t)map->_chunks_x * map->_chunks_y + 1, sizeof(uint64_t));
+  map->_regions = calloc(1, sizeof(MapRegions));
+  map_allocate_planes(map);
+}
+
+static inline size_t map_count_chunks(Map const *map) {
+  return (size_t)map->_chunks_x * map->_chunks_y;
+}
+
+// Internal method, marks the chunk as the most recently used one
+void map_link_chunk(ChunkCache *cache, TileChunk *chunk) {
+  chunk->_epoch = cache->_epoch;
+  chunk->_prev = nullptr;
+  chunk->_next = cache->_head;
+  if (cache->_head != nullptr) {
+    cache->_head->_prev = chunk;
+  } else {
+    cache->_tail = chunk;
+  }
+  cache->_head = chunk;
+  cache->_resident++;
+}
+
+// Internal method
+void map_unlink_chunk(ChunkCache *cache, TileChunk *chunk) {
+  if (chunk->_prev != nullptr) {
+    chunk->_prev->_next = chunk->_next;
+  } else {
+    cache->_head = chunk->_next;
+  }
+
+  if (chunk->_next != nullptr) {
+    chunk->_next->_prev = chunk->_prev;
+  } else {
+    cache->_tail = chunk->_prev;
+  }
 
-  ret->_entities = calloc(max_entities, sizeof(Entity *));
-  for (uint32_t i = 0; i < max_entities; i++) {
-    ret->_entities[i] = nullptr;
+  chunk->_prev = nullptr;
+  chunk->_next = nullptr;
+  cache->_resident--;
+}
+
+// Internal method, chunks are packed as a dictionary holding the position of
+// the chunk and one binary blob per property.
+void map_pack_chunk(Map const *map, TileChunk const *chunk, msgpack_packer *packer) {
+  msgpack_pack_map(packer, 6);
+
+  serde_pack_str(packer, "x");
+  msgpack_pack_uint32(packer, chunk->_index / map->_chunks_y);
+
+  serde_pack_str(packer, "y");
+  msgpack_pack_uint32(packer, chunk->_index % map->_chunks_y);
+
+  serde_pack_str(packer, "kinds");
+  msgpack_pack_bin_with_body(packer, chunk->_kinds, CHUNK_TILES);
+
+  serde_pack_str(packer, "noise");
+  msgpack_pack_bin_with_body(packer, chunk->_noise, CHUNK_TILES);
+
+  serde_pack_str(packer, "light");
+  msgpack_pack_bin_with_body(packer, chunk->_light, CHUNK_TILES);
+
+  serde_pack_str(packer, "flags");
+  msgpack_pack_bin_with_body(packer, chunk->_flags, CHUNK_TILES);
+}
+
+// Internal method, the returned chunk is not linked in the cache yet
+TileChunk *map_unpack_chunk(Map const *map, msgpack_object_map const *msgpack_map) {
+  serde_map_assert(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "x");
+  serde_map_assert(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "y");
+  serde_map_assert(msgpack_map, MSGPACK_OBJECT_BIN, "kinds");
+  serde_map_assert(msgpack_map, MSGPACK_OBJECT_BIN, "noise");
+  serde_map_assert(msgpack_map, MSGPACK_OBJECT_BIN, "light");
+  serde_map_assert(msgpack_map, MSGPACK_OBJECT_BIN, "flags");
+
+  uint64_t chunk_x = *(uint64_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "x");
+  uint64_t chunk_y = *(uint64_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "y");
+  assert(chunk_x < map->_chunks_x && chunk_y < map->_chunks_y);
+
+  TileChunk *chunk = calloc(1, sizeof(TileChunk));
+  chunk->_index = chunk_y + (chunk_x * map->_chunks_y);
+
+  struct {
+    char const *key;
+    uint8_t    *destination;
+  } const properties[] = {
+    {"kinds", chunk->_kinds},
+    {"noise", chunk->_noise},
+    {"light", chunk->_light},
+    {"flags", chunk->_flags},
+  };
+
+  for (size_t i = 0; i < sizeof(properties) / sizeof(properties[0]); i++) {
+    msgpack_object_bin const *bin = serde_map_get(msgpack_map, MSGPACK_OBJECT_BIN, properties[i].key);
+    assert(bin->size == CHUNK_TILES);
+    memcpy(properties[i].destination, bin->ptr, CHUNK_TILES);
   }
 
-  ret->_items_size = 0;
-  ret->_items = nullptr;
+  return chunk;
+}
+
+// Internal method, brings back a chunk from the store, returns nullptr if the
+// chunk has never been written to the store (i.e. it is a default one).
+TileChunk *map_load_chunk(Map const *map, size_t chunk_index) {
+  ChunkCache *cache = map->_chunk_cache;
+  if (cache->_store == nullptr || !cache->_stored[chunk_index]) {
+    return nullptr;
+  }
+
+  size_t size;
+  char  *data = chunk_store_read(cache->_store, chunk_index, &size);
+  if (data == nullptr) {
+    panic("Chunk %zu of map '%s' is missing from the store", EC_CHUNK_STORE_UNAVAILABLE, chunk_index, map->_name);
+  }
+
+  msgpack_unpacked unpacked;
+  size_t           offset = 0;
+  msgpack_unpacked_init(&unpacked);
+  if (msgpack_unpack_next(&unpacked, data, size, &offset) != MSGPACK_UNPACK_SUCCESS || unpacked.data.type != MSGPACK_OBJECT_MAP) {
+    panic("Chunk %zu of map '%s' is corrupted", EC_CHUNK_STORE_UNAVAILABLE, chunk_index, map->_name);
+  }
+
+  TileChunk *chunk = map_unpack_chunk(map, &unpacked.data.via.map);
+  assert(chunk->_index == chunk_index);
+  msgpack_unpacked_destroy(&unpacked);
+  free(data);
+
+  chunk->_dirty = false;
+  map_link_chunk(cache, chunk);
+  map->_tile_chunks[chunk_index] = chunk;
+
+  return chunk;
+}
+
+// Internal method, writes the chunk to the store (unless the store already
+// has an up to date copy of it) and frees it. Returns false if the chunk
+// could not be written, in which case it stays in memory.
+bool map_evict_chunk(Map const *map, TileChunk *chunk) {
+  ChunkCache *cache = map->_chunk_cache;
+  assert(cache->_store != nullptr);
+
+  if (chunk->_dirty || !cache->_stored[chunk->_index]) {
+    msgpack_sbuffer buffer;
+    msgpack_packer  packer;
+    msgpack_sbuffer_init(&buffer);
+    msgpack_packer_init(&packer, &buffer, &msgpack_sbuffer_write);
+    map_pack_chunk(map, chunk, &packer);
+
+    bool written = chunk_store_write(cache->_store, chunk->_index, buffer.data, buffer.size);
+    msgpack_sbuffer_destroy(&buffer);
+    if (!written) {
+      return false;
+    }
+
+    cache->_stored[chunk->_index] = true;
+  }
+
+  map_unlink_chunk(cache, chunk);
+  map->_tile_chunks[chunk->_index] = nullptr;
+  free(chunk);
+
+  return true;
+}
+
+// Internal method, evicts the least recently used chunks until the budget is
+// respected, apart from the given one (if any). Pinned chunks are never
+// evicted, even if that means going over the budget.
+void map_enforce_budget(Map const *map, TileChunk const *keep) {
+  ChunkCache *cache = map->_chunk_cache;
+  TileChunk  *chunk = cache->_tail;
+  while (cache->_resident > cache->_budget && chunk != nullptr) {
+    TileChunk *previous = chunk->_prev;
+    if (chunk != keep && chunk->_epoch != cache->_epoch && !map_evict_chunk(map, chunk)) {
+      LOG_WARNING("Unable to evict chunks of map '%s', going over budget", map->_name);
+      break;
+    }
+    chunk = previous;
+  }
+}
+
+// Internal method, loads back a chunk for a read, without pinning it: the
+// budget still holds afterwards, as long as the pinned chunks fit in it.
+TileChunk *map_fetch_chunk(Map const *map, size_t chunk_index) {
+  TileChunk *chunk = map_load_chunk(map, chunk_index);
+  if (chunk != nullptr) {
+    chunk->_epoch = map->_chunk_cache->_epoch - 1;
+    map_enforce_budget(map, chunk);
+  }
+
+  return chunk;
+}
+
+// Internal method, registers the entity on the tile it is standing on
+void map_occupy(Map *map, Entity *entity) {
+  Point    coords = entity_get_position(entity);
+  uint32_t x = coords.x;
+  uint32_t y = coords.y;
+  if (!map_in_bounds(map, x, y)) {
+    return;
+  }
+
+  size_t chunk_index = map_chunk_index(map, x, y);
+  if (map->_occupancy[chunk_index] == nullptr) {
+    map->_occupancy[chunk_index] = calloc(1, sizeof(OccupancyChunk));
+  }
+
+  OccupancyChunk *chunk = map->_occupancy[chunk_index];
+  size_t          index = map_chunk_tile_index(x, y);
+  if (chunk->_slots[index] == nullptr) {
+    chunk->_count++;
+  }
+
+  chunk->_slots[index] = entity;
+  map_set_plane(map, MAP_PLANE_OCCUPIED, x, y, true);
+}
+
+// Internal method, releases the tile the entity is standing on
+void map_release(Map *map, Entity const *entity) {
+  Point    coords = entity_get_position(entity);
+  uint32_t x = coords.x;
+  uint32_t y = coords.y;
+  if (!map_in_bounds(map, x, y)) {
+    return;
+  }
+
+  size_t          chunk_index = map_chunk_index(map, x, y);
+  OccupancyChunk *chunk = map->_occupancy[chunk_index];
+  size_t          index = map_chunk_tile_index(x, y);
+  if (chunk == nullptr || chunk->_slots[index] != entity) {
+    return;
+  }
+
+  chunk->_slots[index] = nullptr;
+  map_set_plane(map, MAP_PLANE_OCCUPIED, x, y, false);
+  chunk->_count--;
+  if (chunk->_count == 0) {
+    free(chunk);
+    map->_occupancy[chunk_index] = nullptr;
+  }
+}
+
+// Internal method, returns the chunk holding the tile, which may be the
+// shared DEFAULT_CHUNK. The coordinates must be inside the map.
+static inline TileChunk const *map_read_chunk(Map const *map, uint32_t x, uint32_t y) {
+  size_t           chunk_index = map_chunk_index(map, x, y);
+  TileChunk const *chunk = map->_tile_chunks[chunk_index];
+  if (chunk == nullptr) {
+    chunk = map_fetch_chunk(map, chunk_index);
+  }
+
+  return chunk != nullptr ? chunk : &DEFAULT_CHUNK;
+}
+
+// Internal method, the coordinates must be inside the map
+static inline bool map_is_traversable(Map const *map, uint32_t x, uint32_t y) {
+  return (map->_planes[MAP_PLANE_TRAVERSABLE][x / 64 + (size_t)y * map->_plane_words] >> (x % 64)) & 1;
+}
+
+// Internal method
+static inline size_t map_tile_index(Map const *map, uint32_t x, uint32_t y) {
+  return x + (size_t)y * map->_x_size;
+}
+
+// Internal method, hands out the label of a new region
+uint32_t map_new_region_label(MapRegions *regions) {
+  if (regions->_labels_size == MAP_NO_REGION) {
+    panic("Too many regions to label", EC_MAP_TOO_MANY_REGIONS);
+  }
+
+  uint32_t size = union_find_size(regions->_sets);
+  if (regions->_labels_size == size) {
+    union_find_grow(regions->_sets, size > UINT32_MAX / 2 ? UINT32_MAX : max(size * 2, MIN_REGION_LABELS));
+  }
+
+  return regions->_labels_size++;
+}
+
+// Internal method, builds the regions from scratch. Diagonal neighbours are
+// connected, as entities can move diagonally. Tiles take the label of one of
+// the neighbours already seen, and all the labels around them are merged.
+void map_build_regions(Map const *map) {
+  MapRegions *regions = map->_regions;
+  if (regions->_sets == nullptr) {
+    regions->_sets = union_find_new(MIN_REGION_LABELS);
+    regions->_labels = malloc((size_t)map->_x_size * map->_y_size * sizeof(uint32_t));
+  } else {
+    union_find_reset(regions->_sets);
+  }
+  regions->_labels_size = 0;
+
+  for (uint32_t y = 0; y < map->_y_size; y++) {
+    for (uint32_t x = 0; x < map->_x_size; x++) {
+      if (!map_is_traversable(map, x, y)) {
+        continue;
+      }
+
+      uint32_t label = x > 0 && map_is_traversable(map, x - 1, y) ? regions->_labels[map_tile_index(map, x - 1, y)] : MAP_NO_REGION;
+      for (uint32_t above_x = x > 0 ? x - 1 : x; y > 0 && above_x <= x + 1 && above_x < map->_x_size; above_x++) {
+        if (!map_is_traversable(map, above_x, y - 1)) {
+          continue;
+        }
+
+        uint32_t above = regions->_labels[map_tile_index(map, above_x, y - 1)];
+        if (label == MAP_NO_REGION) {
+          label = above;
+        } else {
+          union_find_unite(regions->_sets, label, above);
+        }
+      }
+
+      regions->_labels[map_tile_index(map, x, y)] = label != MAP_NO_REGION ? label : map_new_region_label(regions);
+    }
+  }
+
+  regions->_stale = false;
+}
+
+// Internal method, a tile which just became traversable merges the regions
+// around it.
+void map_merge_regions(Map *map, uint32_t x, uint32_t y) {
+  MapRegions *regions = map->_regions;
+  uint32_t    label = MAP_NO_REGION;
+  for (uint32_t neighbour_y = y > 0 ? y - 1 : y; neighbour_y <= y + 1 && neighbour_y < map->_y_size; neighbour_y++) {
+    for (uint32_t neighbour_x = x > 0 ? x - 1 : x; neighbour_x <= x + 1 && neighbour_x < map->_x_size; neighbour_x++) {
+      if ((neighbour_x == x && neighbour_y == y) || !map_is_traversable(map, neighbour_x, neighbour_y)) {
+        continue;
+      }
+
+      uint32_t neighbour = regions->_labels[map_tile_index(map, neighbour_x, neighbour_y)];
+      if (label == MAP_NO_REGION) {
+        label = neighbour;
+      } else {
+        union_find_unite(regions->_sets, label, neighbour);
+      }
+    }
+  }
+
+  regions->_labels[map_tile_index(map, x, y)] = label != MAP_NO_REGION ? label : map_new_region_label(regions);
+}
+
+// Internal method, labels a tile and queues it, see map_relabel_region()
+static inline void map_queue_relabel(MapRegions *regions, size_t tile, uint32_t label, size_t *size) {
+  if (*size == regions->_queue_capacity) {
+    regions->_queue_capacity = regions->_queue_capacity * 2 + MIN_REGION_LABELS;
+    regions->_queue = realloc(regions->_queue, regions->_queue_capacity * sizeof(size_t));
+  }
+
+  regions->_labels[tile] = label;
+  regions->_queue[(*size)++] = tile;
+}
+
+// Internal method, labels again the traversable tiles connected to the given
+// one which still have a label older than the first one.
+void map_relabel_region(Map *map, uint32_t x, uint32_t y, uint32_t first) {
+  MapRegions *regions = map->_regions;
+  uint32_t    label = map_new_region_label(regions);
+  size_t      size = 0;
+
+  map_queue_relabel(regions, map_tile_index(map, x, y), label, &size);
+  while (size > 0) {
+    size_t   current = regions->_queue[--size];
+    uint32_t current_x = current % map->_x_size;
+    uint32_t current_y = current / map->_x_size;
+
+    for (uint32_t neighbour_y = current_y > 0 ? current_y - 1 : current_y; neighbour_y <= current_y + 1 && neighbour_y < map->_y_size;
+         neighbour_y++) {
+      for (uint32_t neighbour_x = current_x > 0 ? current_x - 1 : current_x;
+           neighbour_x <= current_x + 1 && neighbour_x < map->_x_size; neighbour_x++) {
+        size_t neighbour = map_tile_index(map, neighbour_x, neighbour_y);
+        if (map_is_traversable(map, neighbour_x, neighbour_y) && regions->_labels[neighbour] < first) {
+          map_queue_relabel(regions, neighbour, label, &size);
+        }
+      }
+    }
+  }
+}
+
+// Internal method, a tile which just got blocked splits its region only if
+// the traversable tiles around it are not connected to each other any more
+// without it. In that case, all the parts but one are labelled again, which
+// only costs as much as the region which has been split.
+void map_split_regions(Map *map, uint32_t x, uint32_t y) {
+  // The neighbours of the tile, going around it
+  static int const ring_x[8] = {-1, 0, 1, 1, 1, 0, -1, -1};
+  static int const ring_y[8] = {-1, -1, -1, 0, 1, 1, 1, 0};
+
+  bool    traversable[8];
+  uint8_t parts[8];
+  for (uint32_t i = 0; i < 8; i++) {
+    uint32_t neighbour_x = x + ring_x[i];
+    uint32_t neighbour_y = y + ring_y[i];
+    traversable[i] = map_in_bounds(map, neighbour_x, neighbour_y) && map_is_traversable(map, neighbour_x, neighbour_y);
+    parts[i] = i;
+  }
+
+  // Consecutive neighbours touch each other, so do the two neighbours on
+  // each side of the ones straight above, below, left and right.
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < 8; i++) {
+    count += traversable[i];
+  }
+
+  for (uint32_t i = 0; i < 8; i++) {
+    for (uint32_t step = 1; step <= (i % 2 == 1 ? 2 : 1); step++) {
+      uint32_t j = (i + step) % 8;
+      if (!traversable[i] || !traversable[j]) {
+        continue;
+      }
+
+      uint32_t lhs = i;
+      uint32_t rhs = j;
+      while (parts[lhs] != lhs) {
+        lhs = parts[lhs];
+      }
+      while (parts[rhs] != rhs) {
+        rhs = parts[rhs];
+      }
+      if (lhs != rhs) {
+        parts[rhs] = lhs;
+        count--;
+      }
+    }
+  }
+
+  if (count <= 1) {
+    return;
+  }
+
+  MapRegions *regions = map->_regions;
+  uint32_t    first = regions->_labels_size;
+  for (uint32_t i = 0; i < 8 && count > 1; i++) {
+    if (!traversable[i] || parts[i] != i) {
+      continue;
+    }
+
+    // The last part keeps its labels
+    count--;
+    uint32_t neighbour_x = x + ring_x[i];
+    uint32_t neighbour_y = y + ring_y[i];
+    if (regions->_labels[map_tile_index(map, neighbour_x, neighbour_y)] < first) {
+      map_relabel_region(map, neighbour_x, neighbour_y, first);
+    }
+  }
+}
+
+// Internal method, called once the traversability of a tile changed
+void map_update_regions(Map *map, uint32_t x, uint32_t y, bool traversable) {
+  MapRegions *regions = map->_regions;
+  if (regions->_sets == nullptr || regions->_stale) {
+    return;
+  }
+
+  if (traversable) {
+    map_merge_regions(map, x, y);
+  } else {
+    map_split_regions(map, x, y);
+  }
+}
+
+// Internal method, returns the chunk holding the tile, materializing it
+// if needed. The chunk is pinned, so that the reads following the write (of
+// the regions for instance) do not evict it. The coordinates must be inside
+// the map.
+TileChunk *map_write_chunk(Map const *map, uint32_t x, uint32_t y) {
+  size_t     chunk_index = map_chunk_index(map, x, y);
+  TileChunk *chunk = map->_tile_chunks[chunk_index];
+  if (chunk == nullptr) {
+    chunk = map_load_chunk(map, chunk_index);
+  }
+
+  if (chunk == nullptr) {
+    chunk = malloc(sizeof(TileChunk));
+    memcpy(chunk, &DEFAULT_CHUNK, sizeof(TileChunk));
+    chunk->_index = chunk_index;
+    map_link_chunk(map->_chunk_cache, chunk);
+    map->_tile_chunks[chunk_index] = chunk;
+  }
+
+  chunk->_epoch = map->_chunk_cache->_epoch;
+  chunk->_dirty = true;
+  return chunk;
+}
+
+// Internal method, writes all the properties of a tile, the chunk is only
+// materialized if the tile is not a default one.
+void map_write_tile(Map *map, uint32_t x, uint32_t y, uint8_t kind, uint8_t noise, uint8_t light, uint8_t flags) {
+  size_t           index = map_chunk_tile_index(x, y);
+  TileChunk const *current = map_read_chunk(map, x, y);
+  if (current->_kinds[index] == kind && current->_noise[index] == noise && current->_light[index] == light &&
+      current->_flags[index] == flags) {
+    return;
+  }
+
+  bool was_traversable = (current->_flags[index] & TILE_FLAG_TRAVERSABLE) != 0;
+  bool is_traversable = (flags & TILE_FLAG_TRAVERSABLE) != 0;
+
+  TileChunk *chunk = map_write_chunk(map, x, y);
+  chunk->_kinds[index] = kind;
+  chunk->_noise[index] = noise;
+  chunk->_light[index] = light;
+  chunk->_flags[index] = flags;
+  map_set_tile_planes(map, x, y, light, flags);
+  if (was_traversable != is_traversable) {
+    map_update_regions(map, x, y, is_traversable);
+  }
+  map->_tile_revisions[chunk->_index]++;
+  map->_tile_revisions[map_count_chunks(map)]++;
+}
+
+// Internal method, writes the inclusive rectangle (inside of the map) from
+// columns of kinds, light levels and flags, the columns being stride bytes
+// apart. A nullptr light keeps the current levels. Chunks are only
+// materialized if one of their tiles changes, and the revisions and the
+// regions are only updated once.
+void map_write_rect(Map *map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, uint8_t const *kinds,
+                    uint8_t const *light, uint8_t const *flags, size_t stride) {
+  bool changed = false;
+  bool traversability_changed = false;
+  for (uint32_t chunk_x = from_x / CHUNK_SIZE; chunk_x <= to_x / CHUNK_SIZE; chunk_x++) {
+    for (uint32_t chunk_y = from_y / CHUNK_SIZE; chunk_y <= to_y / CHUNK_SIZE; chunk_y++) {
+      uint32_t left = max(from_x, chunk_x * CHUNK_SIZE);
+      uint32_t right = min(to_x, chunk_x * CHUNK_SIZE + CHUNK_SIZE - 1);
+      uint32_t top = max(from_y, chunk_y * CHUNK_SIZE);
+      uint32_t bottom = min(to_y, chunk_y * CHUNK_SIZE + CHUNK_SIZE - 1);
+      size_t   height = bottom - top + 1;
+
+      TileChunk const *current = map_read_chunk(map, left, top);
+      bool             differs = false;
+      for (uint32_t x = left; x <= right && !differs; x++) {
+        size_t index = map_chunk_tile_index(x, top);
+        size_t source = (top - from_y) + (x - from_x) * stride;
+        differs = memcmp(&current->_kinds[index], &kinds[source], height) != 0 ||
+                  memcmp(&current->_flags[index], &flags[source], height) != 0 ||
+                  (light != nullptr && memcmp(&current->_light[index], &light[source], height) != 0);
+      }
+
+      if (!differs) {
+        continue;
+      }
+
+      TileChunk *chunk = map_write_chunk(map, left, top);
+      for (uint32_t x = left; x <= right; x++) {
+        size_t index = map_chunk_tile_index(x, top);
+        size_t source = (top - from_y) + (x - from_x) * stride;
+        for (size_t i = 0; i < height && !traversability_changed; i++) {
+          traversability_changed = ((chunk->_flags[index + i] ^ flags[source + i]) & TILE_FLAG_TRAVERSABLE) != 0;
+        }
+
+        memcpy(&chunk->_kinds[index], &kinds[source], height);
+        memcpy(&chunk->_flags[index], &flags[source], height);
+        if (light != nullptr) {
+          memcpy(&chunk->_light[index], &light[source], height);
+        }
+
+        for (uint32_t y = top; y <= bottom; y++) {
+          map_set_tile_planes(map, x, y, chunk->_light[index + y - top], chunk->_flags[index + y - top]);
+        }
+      }
+
+      map->_tile_revisions[chunk->_index]++;
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    map->_tile_revisions[map_count_chunks(map)]++;
+  }
+
+  // Merging the regions tile by tile would cost more than building them again
+  if (traversability_changed) {
+    map->_regions->_stale = true;
+  }
+}
+
+// Internal method, allocates the table of entities with room for the given
+// number of entities, the table grows when needed afterwards.
+void map_allocate_entities(Map *map, uint32_t capacity) {
+  map->_last_index = 0;
+  map->_entities_size = 0;
+  map->_entities = nullptr;
+  map->_entity_slots = nullptr;
+  map->_dense_slots = nullptr;
+  map->_free_slots = nullptr;
+  map->_free_slots_count = 0;
+  map->_used_slots = 0;
+  map->_stats = entity_stats_new(capacity);
+  map->_entities_index = hash_index_new(capacity);
+  map->_entities_grid = spatial_grid_new(map->_x_size, map->_y_size, ENTITIES_CELL_SIZE);
+  map_reserve_entities(map, capacity);
+}
+
+void map_reserve_entities(Map *map, uint32_t capacity) {
+  if (capacity <= map->_entities_size) {
+    return;
+  }
+
+  map->_entities = realloc(map->_entities, capacity * sizeof(Entity *));
+  map->_entity_slots = realloc(map->_entity_slots, capacity * sizeof(EntitySlot));
+  map->_dense_slots = realloc(map->_dense_slots, capacity * sizeof(uint32_t));
+  map->_free_slots = realloc(map->_free_slots, capacity * sizeof(uint32_t));
+  entity_stats_reserve(map->_stats, capacity);
+
+  for (uint32_t i = map->_entities_size; i < capacity; i++) {
+    map->_entities[i] = nullptr;
+  }
+
+  map->_entities_size = capacity;
+}
+
+// Internal method, appends the entity to the table (growing it if needed) and
+// registers it in all the indexes.
+uint32_t map_insert_entity(Map *map, Entity *entity) {
+  if (map->_last_index == map->_entities_size) {
+    map_reserve_entities(map, max(map->_entities_size * 2, MIN_ENTITIES_CAPACITY));
+  }
+
+  uint32_t slot;
+  if (map->_free_slots_count > 0) {
+    slot = map->_free_slots[--map->_free_slots_count];
+  } else {
+    slot = map->_used_slots++;
+    map->_entity_slots[slot]._generation = 1;
+  }
+
+  uint32_t dense_index = map->_last_index++;
+  map->_entities[dense_index] = entity;
+  map->_dense_slots[dense_index] = slot;
+  map->_entity_slots[slot]._dense_index = dense_index;
+
+  // Both are appended, and both fill holes with their last element
+  uint32_t stats_slot = entity_stats_attach(map->_stats, entity);
+  assert(stats_slot == dense_index);
+
+  Point coords = entity_get_position(entity);
+  hash_index_put(map->_entities_index, entity_get_name(entity), slot);
+  map_occupy(map, entity);
+  spatial_grid_insert(map->_entities_grid, entity, coords.x, coords.y);
+
+  return slot;
+}
+
+// Internal method, removes and frees the entity of a slot in constant time
+void map_erase_entity(Map *map, uint32_t slot) {
+  uint32_t     dense_index = map->_entity_slots[slot]._dense_index;
+  Entity      *removed = map->_entities[dense_index];
+  Point        coords = entity_get_position(removed);
+
+  hash_index_remove(map->_entities_index, entity_get_name(removed));
+  map_release(map, removed);
+  spatial_grid_remove(map->_entities_grid, removed, coords.x, coords.y);
+  entity_stats_detach(removed);
+  entity_free(removed);
+
+  // Fill the hole with the last entity
+  uint32_t last_index = --map->_last_index;
+  if (dense_index != last_index) {
+    map->_entities[dense_index] = map->_entities[last_index];
+    map->_dense_slots[dense_index] = map->_dense_slots[last_index];
+    map->_entity_slots[map->_dense_slots[dense_index]]._dense_index = dense_index;
+  }
+  map->_entities[last_index] = nullptr;
+
+  map->_entity_slots[slot]._generation++;
+  map->_free_slots[map->_free_slots_count++] = slot;
+}
+
+// Internal method
+void map_allocate_items(Map *map) {
+  map->_items_size = 0;
+  map->_items_capacity = 0;
+  map->_items = nullptr;
+  map->_items_index = hash_index_new(0);
+  map->_items_grid = spatial_grid_new(map->_x_size, map->_y_size, ITEMS_CELL_SIZE);
+}
+
+// Internal method, appends an item which already has its coordinates
+void map_insert_item(Map *map, Item *item) {
+  if (map->_items_size == map->_items_capacity) {
+    map->_items_capacity = max(map->_items_capacity * 2, MIN_ITEMS_CAPACITY);
+    map->_items = realloc(map->_items, map->_items_capacity * sizeof(Item *));
+  }
+
+  hash_index_put(map->_items_index, item_get_name(item), map->_items_size);
+  map->_items[map->_items_size++] = item;
+
+  if (item_has_coords(item)) {
+    Point coords = item_get_position(item);
+    spatial_grid_insert(map->_items_grid, item, coords.x, coords.y);
+  }
+}
+
+Map *map_new(uint32_t x_size, uint32_t y_size, uint32_t reserved_entities, char const *name) {
+  Map *ret = calloc(1, sizeof(Map));
+  ret->_x_size = x_size;
+  ret->_y_size = y_size;
+  ret->_name = strdup(name);
+
+  map_allocate_tiles(ret);
+  map_allocate_entities(ret, reserved_entities);
+  map_allocate_items(ret);
 
   return ret;
 }
@@ -94,10 +997,14 @@ Map *map_deserialize(msgpack_object_map const *msgpack_map) {
   serde_map_assert(msgpack_map, MSGPACK_OBJECT_STR, "name");
   serde_map_assert(msgpack_map, MSGPACK_OBJECT_ARRAY, "entities");
   serde_map_assert(msgpack_map, MSGPACK_OBJECT_ARRAY, "items");
-  serde_map_assert(msgpack_map, MSGPACK_OBJECT_ARRAY, "tiles");
+
+  // Older maps store all of their tiles one by one
+  assert(serde_map_find(msgpack_map, MSGPACK_OBJECT_ARRAY, "chunks") != nullptr ||
+         serde_map_find(msgpack_map, MSGPACK_OBJECT_ARRAY, "tiles") != nullptr);
 
   msgpack_object_array const *items = serde_map_get(msgpack_map, MSGPACK_OBJECT_ARRAY, "items");
   msgpack_object_array const *entities = serde_map_get(msgpack_map, MSGPACK_OBJECT_ARRAY, "entities");
+  msgpack_object_array const *chunks = serde_map_get(msgpack_map, MSGPACK_OBJECT_ARRAY, "chunks");
   msgpack_object_array const *tiles = serde_map_get(msgpack_map, MSGPACK_OBJECT_ARRAY, "tiles");
   msgpack_object_str const   *name = serde_map_get(msgpack_map, MSGPACK_OBJECT_STR, "name");
 
@@ -105,33 +1012,56 @@ Map *map_deserialize(msgpack_object_map const *msgpack_map) {
 
   map->_x_size = *(uint32_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "x_size");
   map->_y_size = *(uint32_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "y_size");
-  map->_entities_size = *(uint32_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "max_entities");
-  map->_last_index = *(uint32_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "last_index");
   map->_name = malloc(name->size);
   memcpy(map->_name, name->ptr, name->size);
-  map->_items_size = items->size;
-
-  map->_entities = calloc(map->_entities_size, sizeof(Entity *));
-  for (uint i = 0; i < map->_entities_size; i++) {
-    map->_entities[i] = nullptr;
-  }
+  map_allocate_tiles(map);
+  map_allocate_items(map);
+  map_allocate_entities(map, *(uint32_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "max_entities"));
 
+  // Handles are not serialized, entities get new ones
   for (uint i = 0; i < entities->size; i++) {
     msgpack_object_map entity_map = entities->ptr[i].via.map;
-    map->_entities[i] = entity_deserialize(&entity_map);
+    map_insert_entity(map, entity_deserialize(&entity_map));
   }
+  assert(map->_last_index == *(uint32_t *)serde_map_get(msgpack_map, MSGPACK_OBJECT_POSITIVE_INTEGER, "last_index"));
 
-  // +1 because we need to allocate the nullptr
-  map->_items = calloc(items->size + 1, sizeof(Item *));
-  map->_items[items->size] = nullptr;
   for (uint i = 0; i < items->size; i++) {
     msgpack_object_map item_map = items->ptr[i].via.map;
-    map->_items[i] = item_deserialize(&item_map);
+    map_insert_item(map, item_deserialize(&item_map));
+  }
+
+  for (uint i = 0; chunks != nullptr && i < chunks->size; i++) {
+    TileChunk *chunk = map_unpack_chunk(map, &chunks->ptr[i].via.map);
+    assert(map->_tile_chunks[chunk->_index] == nullptr);
+    chunk->_dirty = true;
+    map_link_chunk(map->_chunk_cache, chunk);
+    map->_tile_chunks[chunk->_index] = chunk;
+    map_set_chunk_planes(map, chunk);
   }
 
-  map->_tiles = calloc(tiles->size, sizeof(Tile *));
-  for (uint i = 0; i < tiles->size; i++) {
-    map->_tiles[i] = tile_deserialize(&tiles->ptr[i].via.map);
+  assert(tiles == nullptr || tiles->size == (size_t)map->_x_size * map->_y_size);
+  for (uint i = 0; tiles != nullptr && i < tiles->size; i++) {
+    Tile    *tile = tile_deserialize(&tiles->ptr[i].via.map);
+    Point    coords = tile_get_position(tile);
+    uint32_t light = tile_get_base_light(tile);
+    assert(map_in_bounds(map, coords.x, coords.y));
+
+    // Same rule as tile_set_base_light(), tile_deserialize() does not check it
+    map_write_tile(map, coords.x, coords.y, tile_get_tile_kind(tile), min(tile_get_base_noise(tile), UINT8_MAX),
+                   light <= 10 ? light : DEFAULT_TILE_LIGHT,
+                   (tile_is_inside(tile) ? TILE_FLAG_INSIDE : 0) | (tile_is_traversable(tile) ? TILE_FLAG_TRAVERSABLE : 0));
+
+    // Items lying on the tile are owned by the map
+    while (tile_count_items(tile) > 0) {
+      Item const *item = tile_get_item_at(tile, 0);
+      Item *clone = item_clone(item);
+      if (!map_add_item(map, clone, coords.x, coords.y)) {
+        item_free(clone);
+      }
+      tile_remove_item(tile, item_get_name(item));
+    }
+
+    tile_free(tile);
   }
 
   return map;
@@ -160,9 +1090,10 @@ void map_serialize(Map const *map, msgpack_sbuffer *buffer) {
   msgpack_pack_uint32(&packer, map->_last_index);
 
   serde_pack_str(&packer, "entities");
+  EntitySpan entities = map_get_entity_span(map);
   msgpack_pack_array(&packer, map_count_entities(map));
-  for (uint32_t i = 0; i < map_count_entities(map); i++) {
-    entity_serialize(map->_entities[i], buffer);
+  for (Entity **current = entities.begin; current != entities.end; current++) {
+    entity_serialize(*current, buffer);
   }
 
   serde_pack_str(&packer, "items");
@@ -171,31 +1102,76 @@ void map_serialize(Map const *map, msgpack_sbuffer *buffer) {
     item_serialize(map->_items[i], buffer);
   }
 
-  serde_pack_str(&packer, "tiles");
-  unsigned long total_tiles = (unsigned long)map->_x_size * map->_y_size;
-  msgpack_pack_array(&packer, total_tiles);
-  for (uint32_t i = 0; i < total_tiles; i++) {
-    tile_serialize(map->_tiles[i], buffer);
+  // Only the chunks which have been modified are serialized, the evicted ones
+  // are copied as they are from the store.
+  ChunkCache const *cache = map->_chunk_cache;
+  size_t            nb_chunks = 0;
+  for (size_t i = 0; i < map_count_chunks(map); i++) {
+    if (map->_tile_chunks[i] != nullptr || (cache->_store != nullptr && cache->_stored[i])) {
+      nb_chunks++;
+    }
+  }
+
+  serde_pack_str(&packer, "chunks");
+  msgpack_pack_array(&packer, nb_chunks);
+  for (size_t i = 0; i < map_count_chunks(map); i++) {
+    if (map->_tile_chunks[i] != nullptr) {
+      map_pack_chunk(map, map->_tile_chunks[i], &packer);
+    } else if (cache->_store != nullptr && cache->_stored[i]) {
+      size_t size;
+      char  *data = chunk_store_read(cache->_store, i, &size);
+      if (data == nullptr) {
+        panic("Chunk %zu of map '%s' is missing from the store", EC_CHUNK_STORE_UNAVAILABLE, i, map->_name);
+      }
+      msgpack_sbuffer_write(buffer, data, size);
+      free(data);
+    }
   }
 }
 
 void map_free(Map *map) {
+  // Still linear in the number of entities, each one frees its own name,
+  // inventory and perks, only the entity itself goes back to its pool
   for (uint32_t i = 0; i < map->_last_index; i++) {
     entity_free(map->_entities[i]);
   }
+  entity_stats_free(map->_stats);
 
-  if (map->_items != nullptr) {
-    for (size_t i = 0; i < map->_items_size; i++) {
-      item_free(map->_items[i]);
-    }
-    free(map->_items);
+  for (size_t i = 0; i < map->_items_size; i++) {
+    item_free(map->_items[i]);
+  }
+  free(map->_items);
+  hash_index_free(map->_items_index);
+  spatial_grid_free(map->_items_grid);
+
+  for (size_t i = 0; i < map_count_chunks(map); i++) {
+    free(map->_tile_chunks[i]);
+    free(map->_occupancy[i]);
   }
 
-  for (uint32_t i = 0; i < (unsigned long)map->_x_size * map->_y_size; i++) {
-    tile_free(map->_tiles[i]);
+  if (map->_chunk_cache->_store != nullptr) {
+    chunk_store_free(map->_chunk_cache->_store);
   }
 
-  free(map->_tiles);
+  free(map->_chunk_cache->_stored);
+  free(map->_chunk_cache);
+  free(map->_tile_chunks);
+  free(map->_occupancy);
+  free(map->_tile_revisions);
+  if (map->_regions->_sets != nullptr) {
+    union_find_free(map->_regions->_sets);
+  }
+  free(map->_regions->_labels);
+  free(map->_regions->_queue);
+  free(map->_regions);
+  for (uint32_t plane = 0; plane < MAP_PLANES; plane++) {
+    free(map->_planes[plane]);
+  }
+  hash_index_free(map->_entities_index);
+  spatial_grid_free(map->_entities_grid);
+  free(map->_entity_slots);
+  free(map->_dense_slots);
+  free(map->_free_slots);
   free(map->_entities);
   free(map->_name);
   free(map);
@@ -206,44 +1182,85 @@ inline char const *map_get_name(Map const *map) {
 }
 
 Item *map_get_item(Map const *map, const char *item_name) {
-  Item *ret = nullptr;
-  for (size_t i = 0; i < map->_items_size; i++) {
-    if (strings_equal(item_get_name(map->_items[i]), item_name)) {
-      ret = map->_items[i];
-      break;
-    }
+  uint32_t index;
+  if (!hash_index_get(map->_items_index, item_name, &index)) {
+    return nullptr;
   }
 
-  return ret;
+  return map->_items[index];
 }
 
 Entity *map_get_entity(Map const *map, const char *name) {
-  Entity *ret = nullptr;
-  for (uint32_t i = 0; i < map->_last_index; i++) {
-    Entity *current_entity = map->_entities[i];
-    if (strings_equal(entity_get_name(current_entity), name)) {
-      ret = current_entity;
-      break;
-    }
+  uint32_t slot;
+  if (!hash_index_get(map->_entities_index, name, &slot)) {
+    return nullptr;
   }
 
-  return ret;
+  return map->_entities[map->_entity_slots[slot]._dense_index];
 }
 
 Entity **map_get_all_entities(Map const *map) {
   return map->_entities;
 }
 
+inline EntitySpan map_get_entity_span(Map const *map) {
+  EntitySpan span;
+  span.begin = map->_entities;
+  span.end = map->_entities + map->_last_index;
+
+  return span;
+}
+
 int map_get_index_of_entity(Map const *map, const char *name) {
-  int32_t index = -1;
-  for (int32_t i = 0; i < map->_last_index; i++) {
-    if (strings_equal(entity_get_name(map->_entities[i]), name)) {
-      index = i;
-      break;
-    }
+  uint32_t slot;
+  if (!hash_index_get(map->_entities_index, name, &slot)) {
+    return -1;
+  }
+
+  return (int)map->_entity_slots[slot]._dense_index;
+}
+
+int map_get_index_of_handle(Map const *map, EntityHandle handle) {
+  if (!map_is_entity_handle_valid(map, handle)) {
+    return -1;
   }
 
-  return index;
+  return (int)map->_entity_slots[handle.index]._dense_index;
+}
+
+inline EntityStatsView map_get_stats_view(Map const *map) {
+  return entity_stats_get_view(map->_stats);
+}
+
+inline void map_set_needs_clock(Map *map, NeedsClock clock) {
+  entity_stats_set_needs_clock(map->_stats, clock);
+}
+
+inline void map_settle_needs(Map *map, EntityType type) {
+  entity_stats_settle_needs(map->_stats, type);
+}
+
+EntityHandle map_get_entity_handle(Map const *map, const char *name) {
+  EntityHandle handle = ENTITY_HANDLE_INVALID;
+  uint32_t     slot;
+  if (hash_index_get(map->_entities_index, name, &slot)) {
+    handle.index = slot;
+    handle.generation = map->_entity_slots[slot]._generation;
+  }
+
+  return handle;
+}
+
+inline bool map_is_entity_handle_valid(Map const *map, EntityHandle handle) {
+  return handle.index < map->_used_slots && handle.generation == map->_entity_slots[handle.index]._generation;
+}
+
+Entity *map_get_entity_by_handle(Map const *map, EntityHandle handle) {
+  if (!map_is_entity_handle_valid(map, handle)) {
+    return nullptr;
+  }
+
+  return map->_entities[map->_entity_slots[handle.index]._dense_index];
 }
 
 MapBoundaries map_get_boundaries(Map const *map) {
@@ -254,27 +1271,33 @@ MapBoundaries map_get_boundaries(Map const *map) {
   return boundaries;
 }
 
-int map_count_entities(Map const *map) {
-  int count = 0;
-  for (uint32_t i = 0; i < map->_entities_size; i++) {
-    if (map->_entities[i] != nullptr) {
-      count++;
-    }
-  }
-
-  return count;
+inline int map_count_entities(Map const *map) {
+  return (int)map->_last_index;
 }
 
-void map_add_entity(Map *map, Entity *entity) {
-  Point const *coords = entity_get_coords(entity);
-  if (!map_is_tile_free(map, point_get_x(coords), point_get_y(coords))) {
-    return;
+bool map_add_entity(Map *map, Entity *entity) {
+  Point coords = entity_get_position(entity);
+  if (!map_in_bounds(map, coords.x, coords.y)) {
+    LOG_WARNING("Entity '%s' is out of the map boundaries", entity_get_name(entity));
+    return false;
+  }
+
+  if (!map_is_tile_free(map, coords.x, coords.y)) {
+    LOG_WARNING("Tile of entity '%s' is already occupied", entity_get_name(entity));
+    return false;
   }
 
-  if (map->_last_index < map->_entities_size) {
-    map->_entities[map->_last_index] = entity;
-    map->_last_index++;
+  if (map_contains_entity(map, entity_get_name(entity))) {
+    LOG_WARNING("Map already contains an entity named '%s'", entity_get_name(entity));
+    return false;
   }
+
+  map_insert_entity(map, entity);
+  return true;
+}
+
+inline uint32_t map_get_entities_capacity(Map const *map) {
+  return map->_entities_size;
 }
 
 Entity **map_filter_entities(Map const *map, bool (*filter_function)(Entity const *), ssize_t *nb_results) {
@@ -292,134 +1315,392 @@ Entity **map_filter_entities(Map const *map, bool (*filter_function)(Entity cons
   return result;
 }
 
-void map_update_index(Map *map) {
-  uint32_t count = 0;
-  for (uint32_t i = 0; i < map->_entities_size; i++) {
-    if (map->_entities[i] == nullptr) {
-      break;
-    }
+void map_remove_entity(Map *map, const char *name) {
+  uint32_t slot;
+  if (hash_index_get(map->_entities_index, name, &slot)) {
+    map_erase_entity(map, slot);
+  }
+}
 
-    count++;
+bool map_remove_entity_by_handle(Map *map, EntityHandle handle) {
+  if (!map_is_entity_handle_valid(map, handle)) {
+    return false;
   }
 
-  map->_last_index = count;
+  map_erase_entity(map, handle.index);
+  return true;
 }
 
-void map_remove_entity(Map *map, const char *name) {
-  if (!map_contains_entity(map, name)) {
+bool map_contains_entity(Map const *map, const char *name) {
+  return hash_index_contains(map->_entities_index, name);
+}
+
+bool map_add_item(Map *map, Item *item, uint32_t x, uint32_t y) {
+  if (map_contains_item(map, item_get_name(item))) {
+    LOG_WARNING("Map already contains an item named '%s'", item_get_name(item));
+    return false;
+  }
+
+  item_clear_coords(item);
+  item_set_coords(item, x, y);
+  map_insert_item(map, item);
+  return true;
+}
+
+void map_remove_item(Map *map, const char *name) {
+  uint32_t index;
+  if (!hash_index_get(map->_items_index, name, &index)) {
     return;
   }
 
-  uint32_t removed_index = 0;
-  for (; removed_index < map->_last_index; removed_index++) {
-    Entity *current_entity = map->_entities[removed_index];
-    if (strings_equal(entity_get_name(current_entity), name)) {
-      map->_entities[removed_index] = nullptr;
-      entity_free(current_entity);
-      break;
-    }
+  Item *removed = map->_items[index];
+  hash_index_remove(map->_items_index, name);
+  if (item_has_coords(removed)) {
+    Point coords = item_get_position(removed);
+    spatial_grid_remove(map->_items_grid, removed, coords.x, coords.y);
   }
+  item_free(removed);
 
-  // Now reorder all the heap!
-  for (uint32_t i = removed_index + 1; i < map->_last_index; i++) {
-    if (map->_entities[i] == nullptr) {
-      map->_last_index = i;
-      break;
-    }
-    map->_entities[i - 1] = map->_entities[i];
-    map->_entities[i] = nullptr;
+  // Fill the hole with the last item
+  map->_items_size--;
+  if (index != map->_items_size) {
+    map->_items[index] = map->_items[map->_items_size];
+    hash_index_put(map->_items_index, item_get_name(map->_items[index]), index);
   }
+  map->_items[map->_items_size] = nullptr;
+}
 
-  map_update_index(map);
+bool map_contains_item(Map const *map, const char *item_name) {
+  return hash_index_contains(map->_items_index, item_name);
 }
 
-bool map_contains_entity(Map const *map, const char *name) {
-  Entity const *ret = map_get_entity(map, name);
-  return ret != nullptr ? 1 : 0;
+inline size_t map_get_items_at(Map const *map, uint32_t x, uint32_t y, Item **buffer, size_t buffer_size) {
+  return spatial_grid_query_rect(map->_items_grid, x, y, x, y, (void **)buffer, buffer_size);
 }
 
-void map_add_item(Map *map, Item *item, uint32_t x, uint32_t y) {
-  if (map_contains_item(map, item_get_name(item))) {
+inline size_t map_get_items_in_radius(Map const *map, uint32_t x, uint32_t y, uint32_t radius, Item **buffer, size_t buffer_size) {
+  return spatial_grid_query_radius(map->_items_grid, x, y, radius, (void **)buffer, buffer_size);
+}
+
+uint32_t map_count_items(Map const *map) {
+  return map->_items_size;
+}
+
+// Tiles outside of the map are considered free, it is up to the caller
+// to check the boundaries before moving an entity there.
+bool map_is_tile_free(Map const *map, uint32_t x, uint32_t y) {
+  return map_get_entity_at(map, x, y) == nullptr;
+}
+
+Entity *map_get_entity_at(Map const *map, uint32_t x, uint32_t y) {
+  if (!map_in_bounds(map, x, y)) {
+    return nullptr;
+  }
+
+  OccupancyChunk const *chunk = map->_occupancy[map_chunk_index(map, x, y)];
+  if (chunk == nullptr) {
+    return nullptr;
+  }
+
+  return chunk->_slots[map_chunk_tile_index(x, y)];
+}
+
+bool map_move_entity(Map *map, Entity *entity, uint32_t delta_x, uint32_t delta_y) {
+  Point    coords = entity_get_position(entity);
+  uint32_t target_x = coords.x + delta_x;
+  uint32_t target_y = coords.y + delta_y;
+
+  if (!map_in_bounds(map, target_x, target_y) || !map_is_tile_free(map, target_x, target_y) || !entity_can_move(entity)) {
+    return false;
+  }
+
+  uint32_t from_x = coords.x;
+  uint32_t from_y = coords.y;
+
+  map_release(map, entity);
+  entity_move(entity, delta_x, delta_y);
+  map_occupy(map, entity);
+  spatial_grid_move(map->_entities_grid, entity, from_x, from_y, target_x, target_y);
+
+  return true;
+}
+
+inline size_t map_get_entities_in_rect(Map const *map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, Entity **buffer,
+                                       size_t buffer_size) {
+  return spatial_grid_query_rect(map->_entities_grid, from_x, from_y, to_x, to_y, (void **)buffer, buffer_size);
+}
+
+inline size_t map_get_entities_in_radius(Map const *map, uint32_t x, uint32_t y, uint32_t radius, Entity **buffer, size_t buffer_size) {
+  return spatial_grid_query_radius(map->_entities_grid, x, y, radius, (void **)buffer, buffer_size);
+}
+
+TileView map_get_tile(Map const *map, uint32_t x, uint32_t y) {
+  TileView view = {.valid = false, .x = x, .y = y};
+  if (!map_in_bounds(map, x, y)) {
+    return view;
+  }
+
+  TileChunk const *chunk = map_read_chunk(map, x, y);
+  size_t           index = map_chunk_tile_index(x, y);
+  view.valid = true;
+  view.kind = chunk->_kinds[index];
+  view.base_noise = chunk->_noise[index];
+  view.base_light = chunk->_light[index];
+  view.inside = (chunk->_flags[index] & TILE_FLAG_INSIDE) != 0;
+  view.traversable = (chunk->_flags[index] & TILE_FLAG_TRAVERSABLE) != 0;
+
+  return view;
+}
+
+void map_set_tile_properties(Map *map, uint32_t x, uint32_t y, TileProperties const *tile_props) {
+  if (!map_in_bounds(map, x, y)) {
     return;
   }
 
-  map->_items_size++;
-  map->_items = realloc(map->_items, map->_items_size * sizeof(Item *));
-  map->_items[map->_items_size - 1] = item;
-  item_clear_coords(item);
-  item_set_coords(item, x, y);
+  TileChunk const *current = map_read_chunk(map, x, y);
+  size_t           index = map_chunk_tile_index(x, y);
+
+  // Same rule as tile_set_base_light()
+  uint8_t light = tile_props->base_light <= 10 ? tile_props->base_light : current->_light[index];
+  uint8_t flags = (tile_props->inside ? TILE_FLAG_INSIDE : 0) | (tile_props->traversable ? TILE_FLAG_TRAVERSABLE : 0);
+
+  map_write_tile(map, x, y, tile_props->kind, current->_noise[index], light, flags);
 }
 
-void map_remove_item(Map *map, const char *name) {
-  if (!map_contains_item(map, name)) {
+void map_fill_tiles(Map *map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, TileProperties const *tile_props) {
+  if (from_x > to_x || from_y > to_y || !map_in_bounds(map, from_x, from_y)) {
     return;
   }
 
-  ssize_t item_index = -1;
+  to_x = min(to_x, map->_x_size - 1);
+  to_y = min(to_y, map->_y_size - 1);
 
-  for (size_t i = 0; i < map->_items_size; i++) {
-    if (strings_equal(item_get_name(map->_items[i]), name)) {
-      item_index = i;
-      item_free(map->_items[i]);
-    } else if (item_index != -1) {
-      map->_items[i - 1] = map->_items[i];
-    }
+  // A single column, written again for every column of the rectangle
+  size_t   height = to_y - from_y + 1;
+  uint8_t *column = malloc(3 * height);
+  uint8_t  flags = (tile_props->inside ? TILE_FLAG_INSIDE : 0) | (tile_props->traversable ? TILE_FLAG_TRAVERSABLE : 0);
+  memset(column, tile_props->kind, height);
+  memset(column + height, flags, height);
+  memset(column + 2 * height, tile_props->base_light, height);
+
+  // Same rule as tile_set_base_light()
+  map_write_rect(map, from_x, from_y, to_x, to_y, column, tile_props->base_light <= 10 ? column + 2 * height : nullptr, column + height, 0);
+  free(column);
+}
+
+MapPrefab *map_prefab_new(uint32_t x_size, uint32_t y_size) {
+  size_t     size = (size_t)x_size * y_size;
+  MapPrefab *ret = malloc(sizeof(MapPrefab));
+  ret->_x_size = x_size;
+  ret->_y_size = y_size;
+  ret->_kinds = malloc(size);
+  ret->_light = malloc(size);
+  ret->_flags = malloc(size);
+  memset(ret->_kinds, DEFAULT_TILE_KIND, size);
+  memset(ret->_light, DEFAULT_TILE_LIGHT, size);
+  memset(ret->_flags, DEFAULT_TILE_FLAGS, size);
+  return ret;
+}
+
+void map_prefab_free(MapPrefab *prefab) {
+  free(prefab->_kinds);
+  free(prefab->_light);
+  free(prefab->_flags);
+  free(prefab);
+}
+
+void map_prefab_set_tile(MapPrefab *prefab, uint32_t x, uint32_t y, TileProperties const *tile_props) {
+  if (x >= prefab->_x_size || y >= prefab->_y_size) {
+    return;
   }
 
-  if (item_index != -1) {
-    map->_items_size--;
-    map->_items = realloc(map->_items, map->_items_size * sizeof(Item *));
+  size_t index = y + (size_t)x * prefab->_y_size;
+  prefab->_kinds[index] = tile_props->kind;
+  prefab->_flags[index] = (tile_props->inside ? TILE_FLAG_INSIDE : 0) | (tile_props->traversable ? TILE_FLAG_TRAVERSABLE : 0);
+
+  // Same rule as tile_set_base_light()
+  if (tile_props->base_light <= 10) {
+    prefab->_light[index] = tile_props->base_light;
   }
 }
 
-bool map_contains_item(Map const *map, const char *item_name) {
-  for (size_t i = 0; i < map->_items_size; i++) {
-    if (strings_equal(item_get_name(map->_items[i]), item_name)) {
-      return true;
+void map_stamp_prefab(Map *map, MapPrefab const *prefab, uint32_t x, uint32_t y) {
+  if (prefab->_x_size == 0 || prefab->_y_size == 0 || !map_in_bounds(map, x, y)) {
+    return;
+  }
+
+  // Parts of the prefab outside of the map are dropped
+  uint32_t to_x = x + min(prefab->_x_size, map->_x_size - x) - 1;
+  uint32_t to_y = y + min(prefab->_y_size, map->_y_size - y) - 1;
+  map_write_rect(map, x, y, to_x, to_y, prefab->_kinds, prefab->_light, prefab->_flags, prefab->_y_size);
+}
+
+uint64_t map_get_tiles_revision(Map const *map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  if (from_x >= map->_x_size || from_y >= map->_y_size) {
+    return 0;
+  }
+
+  to_x = min(to_x, map->_x_size - 1);
+  to_y = min(to_y, map->_y_size - 1);
+
+  uint64_t revision = 0;
+  for (uint32_t x = from_x - from_x % CHUNK_SIZE; x <= to_x; x += CHUNK_SIZE) {
+    for (uint32_t y = from_y - from_y % CHUNK_SIZE; y <= to_y; y += CHUNK_SIZE) {
+      revision += map->_tile_revisions[map_chunk_index(map, x, y)];
     }
   }
 
-  return false;
+  return revision;
 }
 
-uint32_t map_count_items(Map const *map) {
-  return map->_items_size;
+bool map_same_region(Map const *map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  if (!map_in_bounds(map, from_x, from_y) || !map_in_bounds(map, to_x, to_y) || !map_is_traversable(map, from_x, from_y) ||
+      !map_is_traversable(map, to_x, to_y)) {
+    return false;
+  }
+
+  if (map->_regions->_sets == nullptr || map->_regions->_stale) {
+    map_build_regions(map);
+  }
+
+  MapRegions const *regions = map->_regions;
+  return union_find_same(regions->_sets, regions->_labels[map_tile_index(map, from_x, from_y)],
+                         regions->_labels[map_tile_index(map, to_x, to_y)]);
 }
 
-bool map_is_tile_free(Map const *map, uint32_t x, uint32_t y) {
-  bool is_free = true;
-  for (uint32_t i = 0; i < map->_last_index; i++) {
-    Point const *point = entity_get_coords(map->_entities[i]);
-    if (point_get_x(point) == x && point_get_y(point) == y) {
-      is_free = false;
-      break;
+inline uint64_t map_count_tile_changes(Map const *map) {
+  return map->_tile_revisions[map_count_chunks(map)];
+}
+
+inline bool map_test_plane(Map const *map, MapPlane plane, uint32_t x, uint32_t y) {
+  if (!map_in_bounds(map, x, y)) {
+    return false;
+  }
+
+  return (map->_planes[plane][x / 64 + (size_t)y * map->_plane_words] >> (x % 64)) & 1;
+}
+
+inline uint64_t const *map_get_plane_row(Map const *map, MapPlane plane, uint32_t y) {
+  assert(y < map->_y_size);
+  return &map->_planes[plane][(size_t)y * map->_plane_words];
+}
+
+inline uint32_t map_count_plane_words(Map const *map) {
+  return map->_plane_words;
+}
+
+// Internal method, bits of the word between from_x and to_x (inclusive)
+static inline uint64_t map_plane_mask(uint32_t word, uint32_t from_x, uint32_t to_x) {
+  uint64_t mask = UINT64_MAX;
+  if (word == from_x / 64) {
+    mask &= UINT64_MAX << (from_x % 64);
+  }
+
+  if (word == to_x / 64) {
+    mask &= UINT64_MAX >> (63 - to_x % 64);
+  }
+
+  return mask;
+}
+
+uint32_t map_count_in_plane(Map const *map, MapPlane plane, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  if (from_x > to_x || from_y > to_y || !map_in_bounds(map, from_x, from_y)) {
+    return 0;
+  }
+
+  to_x = min(to_x, map->_x_size - 1);
+  to_y = min(to_y, map->_y_size - 1);
+
+  uint32_t count = 0;
+  for (uint32_t y = from_y; y <= to_y; y++) {
+    uint64_t const *row = map_get_plane_row(map, plane, y);
+    for (uint32_t word = from_x / 64; word <= to_x / 64; word++) {
+      count += __builtin_popcountll(row[word] & map_plane_mask(word, from_x, to_x));
     }
   }
 
-  return is_free;
+  return count;
 }
 
-// Internal method, we're allowed to modify a tile only by passing by
-// the exposed map's APIs
-Tile *map_modify_tile(Map const *map, uint32_t x, uint32_t y) {
-  if (x >= map->_x_size || y >= map->_y_size) {
-    return nullptr;
+bool map_find_free_tile(Map const *map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, uint32_t *x, uint32_t *y) {
+  if (from_x > to_x || from_y > to_y || !map_in_bounds(map, from_x, from_y)) {
+    return false;
+  }
+
+  to_x = min(to_x, map->_x_size - 1);
+  to_y = min(to_y, map->_y_size - 1);
+
+  // 64 tiles are tested at once
+  for (uint32_t current_y = from_y; current_y <= to_y; current_y++) {
+    uint64_t const *traversable = map_get_plane_row(map, MAP_PLANE_TRAVERSABLE, current_y);
+    uint64_t const *occupied = map_get_plane_row(map, MAP_PLANE_OCCUPIED, current_y);
+    for (uint32_t word = from_x / 64; word <= to_x / 64; word++) {
+      uint64_t free_tiles = traversable[word] & ~occupied[word] & map_plane_mask(word, from_x, to_x);
+      if (free_tiles != 0) {
+        *x = word * 64 + __builtin_ctzll(free_tiles);
+        *y = current_y;
+        return true;
+      }
+    }
   }
 
-  return map->_tiles[y + ((unsigned long)x * map->_y_size)];
+  return false;
 }
 
-inline Tile const *map_get_tile(Map const *map, uint32_t x, uint32_t y) {
-  return (Tile const *)map_modify_tile(map, x, y);
+uint32_t map_count_tile_chunks(Map const *map) {
+  return map->_chunk_cache->_resident;
 }
 
-inline void map_set_tile_properties(Map const *map, uint32_t x, uint32_t y, TileProperties const *tile_props) {
-  Tile *tile_at = map_modify_tile(map, x, y);
-  if (tile_at != nullptr) {
-    tile_set_base_light(tile_at, tile_props->base_light);
-    tile_set_inside(tile_at, tile_props->inside);
-    tile_set_traversable(tile_at, tile_props->traversable);
-    tile_set_kind(tile_at, tile_props->kind);
+void map_set_chunk_store(Map *map, ChunkStore *store, size_t memory_budget) {
+  ChunkCache *cache = map->_chunk_cache;
+
+  // Bring everything back from the previous store before dropping it
+  if (cache->_store != nullptr) {
+    for (size_t i = 0; i < map_count_chunks(map); i++) {
+      if (map->_tile_chunks[i] == nullptr && cache->_stored[i]) {
+        map_load_chunk(map, i)->_dirty = true;
+      }
+    }
+
+    chunk_store_free(cache->_store);
+    free(cache->_stored);
+    cache->_stored = nullptr;
+  }
+
+  cache->_store = store;
+  cache->_budget = min(memory_budget / sizeof(TileChunk), UINT32_MAX);
+  if (store != nullptr) {
+    cache->_stored = calloc(map_count_chunks(map), sizeof(bool));
+    cache->_epoch++;
+    map_enforce_budget(map, nullptr);
   }
 }
 
+void map_stream_around(Map *map, uint32_t x, uint32_t y, uint32_t radius) {
+  ChunkCache *cache = map->_chunk_cache;
+  if (cache->_store == nullptr || !map_in_bounds(map, x, y)) {
+    return;
+  }
+
+  cache->_epoch++;
+
+  uint32_t from_x = (x > radius ? x - radius : 0) / CHUNK_SIZE;
+  uint32_t from_y = (y > radius ? y - radius : 0) / CHUNK_SIZE;
+  uint32_t to_x = (radius < map->_x_size - x ? x + radius : map->_x_size - 1) / CHUNK_SIZE;
+  uint32_t to_y = (radius < map->_y_size - y ? y + radius : map->_y_size - 1) / CHUNK_SIZE;
+
+  for (uint32_t chunk_x = from_x; chunk_x <= to_x; chunk_x++) {
+    for (uint32_t chunk_y = from_y; chunk_y <= to_y; chunk_y++) {
+      size_t     chunk_index = chunk_y + ((size_t)chunk_x * map->_chunks_y);
+      TileChunk *chunk = map->_tile_chunks[chunk_index];
+      if (chunk != nullptr) {
+        map_unlink_chunk(cache, chunk);
+        map_link_chunk(cache, chunk);
+      } else {
+        map_load_chunk(map, chunk_index);
+      }
+    }
+  }
+
+  map_enforce_budget(map, nullptr);
+}
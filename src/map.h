@@ -22,6 +22,7 @@
 #ifndef __MAP__H__
 #define __MAP__H__
 
+#include "chunk_store.h"
 #include "entity.h"
 #include "item.h"
 #include "tile.h"
@@ -31,13 +32,23 @@
 #include <stdint.h>
 #include <sys/types.h>
 
-typedef struct Map Map;
+typedef struct Map       Map;
+typedef struct MapPrefab MapPrefab;
 
 typedef struct MapBoundaries {
   uint32_t x;
   uint32_t y;
 } MapBoundaries;
 
+// Bitplanes kept by the map, with one bit per tile
+typedef enum MapPlane {
+  MAP_PLANE_TRAVERSABLE,
+  MAP_PLANE_INSIDE,
+  MAP_PLANE_OCCUPIED, // An entity is standing on the tile
+  MAP_PLANE_LIT,      // The base light of the tile is not 0
+  MAP_PLANES,
+} MapPlane;
+
 typedef struct TileProperties {
   TileKind kind;
   uint32_t base_light;
@@ -45,8 +56,38 @@ typedef struct TileProperties {
   bool     traversable;
 } TileProperties;
 
+// Lightweight view over a tile stored inside a map, it is a copy of the tile
+// properties, modifying it has no effect on the map.
+typedef struct TileView {
+  bool     valid; // false if the coordinates are outside of the map
+  uint32_t x;
+  uint32_t y;
+  TileKind kind;
+  uint32_t base_noise;
+  uint32_t base_light;
+  bool     inside;
+  bool     traversable;
+} TileView;
+
+// Stable reference to an entity of a map, it stops being valid as soon as the
+// entity is removed, even if another entity takes its place afterwards.
+typedef struct EntityHandle {
+  uint32_t index;
+  uint32_t generation; // 0 is never a valid generation
+} EntityHandle;
+
+#define ENTITY_HANDLE_INVALID ((EntityHandle){.index = 0, .generation = 0})
+
+// All the entities of a map, stored contiguously from begin to end (excluded).
+// Adding or removing entities invalidates the span.
+typedef struct EntitySpan {
+  Entity **begin;
+  Entity **end;
+} EntitySpan;
+
 // Constructors and destructors
-Map *map_new(uint32_t x_size, uint32_t y_size, uint32_t max_entities, char const *);
+// The number of entities is only a hint, the map grows when needed
+Map *map_new(uint32_t x_size, uint32_t y_size, uint32_t reserved_entities, char const *);
 Map *map_deserialize(msgpack_object_map const *);
 void map_serialize(Map const *, msgpack_sbuffer *);
 void map_free(Map *);
@@ -56,25 +97,110 @@ char const   *map_get_name(Map const *);
 Item         *map_get_item(Map const *, const char *);
 Entity       *map_get_entity(Map const *, const char *);
 Entity      **map_get_all_entities(Map const *);
+EntitySpan    map_get_entity_span(Map const *);
 int           map_get_index_of_entity(Map const *, const char *);
+int           map_get_index_of_handle(Map const *, EntityHandle); // -1 if the handle is not valid
 MapBoundaries map_get_boundaries(Map const *);
 
 // Methods for entities
-int      map_count_entities(Map const *);
-void     map_add_entity(Map *, Entity *);
+int      map_count_entities(Map const *); // Constant time
+bool     map_add_entity(Map *, Entity *); // The caller keeps the entity on failure
+void     map_reserve_entities(Map *, uint32_t);
+uint32_t map_get_entities_capacity(Map const *);
 Entity **map_filter_entities(Map const *, bool (*)(Entity const *), ssize_t *);
 void     map_remove_entity(Map *, const char *);
 bool     map_contains_entity(Map const *, const char *);
+bool     map_move_entity(Map *, Entity *, uint32_t delta_x, uint32_t delta_y);
+
+// Handle based methods for entities
+EntityHandle map_get_entity_handle(Map const *, const char *);
+Entity      *map_get_entity_by_handle(Map const *, EntityHandle);
+bool         map_is_entity_handle_valid(Map const *, EntityHandle);
+bool         map_remove_entity_by_handle(Map *, EntityHandle);
+
+// Hot stats of the entities of the map, stat i being the one of the entity i
+// of map_get_entity_span() (see map_get_index_of_handle()). Entities added
+// to the map move their stats to it, and take them back when they leave.
+EntityStatsView map_get_stats_view(Map const *);
+
+// Needs of the entities of the map only grow once it has a clock, see
+// NeedsClock.
+void map_set_needs_clock(Map *, NeedsClock);
+void map_settle_needs(Map *, EntityType);
+
+// Area queries, the entities found are stored in the given buffer (up to its
+// size) and the total number of entities found is returned, which can be
+// bigger than the size of the buffer. Rectangles are inclusive.
+size_t map_get_entities_in_rect(Map const *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, Entity **, size_t);
+size_t map_get_entities_in_radius(Map const *, uint32_t x, uint32_t y, uint32_t radius, Entity **, size_t);
 
 // Methods for items
-void     map_add_item(Map *, Item *, uint32_t x, uint32_t y);
+bool     map_add_item(Map *, Item *, uint32_t x, uint32_t y); // The caller keeps the item on failure
 void     map_remove_item(Map *, const char *);
 bool     map_contains_item(Map const *, const char *);
 uint32_t map_count_items(Map const *);
 
+// Same as the area queries for entities
+size_t map_get_items_at(Map const *, uint32_t x, uint32_t y, Item **, size_t);
+size_t map_get_items_in_radius(Map const *, uint32_t x, uint32_t y, uint32_t radius, Item **, size_t);
+
 // Methods for tiles
 bool        map_is_tile_free(Map const *, uint32_t x, uint32_t y);
-Tile const *map_get_tile(Map const *, uint32_t x, uint32_t y);
-void        map_set_tile_properties(Map const *, uint32_t x, uint32_t y, TileProperties const *);
+Entity     *map_get_entity_at(Map const *, uint32_t x, uint32_t y);
+TileView    map_get_tile(Map const *, uint32_t x, uint32_t y);
+void        map_set_tile_properties(Map *, uint32_t x, uint32_t y, TileProperties const *);
+uint32_t    map_count_tile_chunks(Map const *); // PERF: Only useful for tests
+
+// Bulk modifications, for generators writing whole rooms at once. The
+// rectangle is inclusive and clipped to the map, the same rules as
+// map_set_tile_properties() apply to every tile.
+void map_fill_tiles(Map *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, TileProperties const *);
+
+// Prefabs are rectangles of tiles stamped as a whole into maps, their tiles
+// start as the default ones (traversable grass, fully lit).
+MapPrefab *map_prefab_new(uint32_t x_size, uint32_t y_size);
+void       map_prefab_free(MapPrefab *);
+void       map_prefab_set_tile(MapPrefab *, uint32_t x, uint32_t y, TileProperties const *);
+void       map_stamp_prefab(Map *, MapPrefab const *, uint32_t x, uint32_t y); // (x, y) is the top left corner
+
+// Changes every time a tile of the rectangle (inclusive) is modified, only
+// meant to be compared with a previous value for the same rectangle.
+uint64_t map_get_tiles_revision(Map const *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+uint64_t map_count_tile_changes(Map const *); // Same, for the whole map
+
+// True if an entity could walk from one tile to the other, ignoring the other
+// entities. Both tiles must be traversable. Constant time, apart from the
+// first call after a tile stops being traversable.
+bool map_same_region(Map const *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+
+// Bitplanes, rows are arrays of words holding the bits of 64 tiles each:
+// the bit of (x, y) is bit x % 64 of word x / 64 of row y. The bits past the
+// end of a row are always 0.
+bool            map_test_plane(Map const *, MapPlane, uint32_t x, uint32_t y); // false outside of the map
+uint64_t const *map_get_plane_row(Map const *, MapPlane, uint32_t y);
+uint32_t        map_count_plane_words(Map const *); // Number of words of each row
+uint32_t        map_count_in_plane(Map const *, MapPlane, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+
+// Looks for a traversable tile without entities inside of the (inclusive)
+// rectangle, row by row. Returns false if there is none.
+bool map_find_free_tile(Map const *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, uint32_t *x, uint32_t *y);
+
+// Chunk streaming, the map takes the ownership of the store and keeps at most
+// memory_budget bytes of tiles in memory, the rest is swapped out to the store.
+// Reads of evicted tiles load their chunk back and evict another one in its
+// place. Only the chunks around the last map_stream_around() and the ones
+// modified since then can go over the budget.
+// Passing a nullptr store brings everything back in memory.
+//
+// Only the tiles (kind, noise, light and flags) are streamed, the budget
+// bounds them and nothing else. Flow fields and noise fields only allocate
+// memory around their goals and noises. What follows stays in memory whatever
+// the budget, streaming it is out of the scope of the chunk store:
+// - the entities and the items, whatever their chunk, with their occupancy
+// - the planes (4 bits per tile) and the revisions of the chunks
+// - the region labels (4 bytes per tile), once a region has been queried
+// - the light maps (1 byte per tile) and the path finders built on the map
+void map_set_chunk_store(Map *, ChunkStore *, size_t memory_budget);
+void map_stream_around(Map *, uint32_t x, uint32_t y, uint32_t radius);
 
 #endif
@@ -0,0 +1,251 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "noise.h"
+#include "point.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct NoiseEvent {
+  uint32_t _x;
+  uint32_t _y;
+  uint8_t  _loudness;
+} NoiseEvent;
+
+// Levels are stored by square blocks of tiles, allocated once a noise reaches
+// one of their tiles. Block (x, y) is at index x + y * _blocks_x.
+#define NOISE_BLOCK_SIZE 16
+
+typedef struct NoiseBlock {
+  uint8_t _levels[NOISE_BLOCK_SIZE * NOISE_BLOCK_SIZE]; // x + y * NOISE_BLOCK_SIZE, inside of the block
+} NoiseBlock;
+
+struct NoiseField {
+  Map const   *_map;
+  uint32_t     _x_size;
+  uint32_t     _y_size;
+  uint32_t     _blocks_x;
+  NoiseBlock **_blocks; // nullptr where nothing can be heard
+
+  // Blocks allocated by the last propagation, and the ones of the propagation
+  // before it which can be reused. Both have room for _used_capacity blocks.
+  uint32_t    *_used;
+  uint32_t     _used_size;
+  uint32_t     _used_capacity;
+  NoiseBlock **_spare;
+  uint32_t     _spare_size;
+
+  // Noises emitted since the last propagation
+  NoiseEvent *_events;
+  uint32_t    _events_size;
+  uint32_t    _events_capacity;
+
+  // Tiles reached by the last propagation, in the order they have been
+  // reached. Reused as the queue of the next propagation.
+  uint32_t *_queue;
+  uint32_t  _queue_size;
+  uint32_t  _queue_capacity;
+};
+
+#define MIN_NOISE_CAPACITY 16
+
+NoiseField *noise_field_new(Map const *map) {
+  MapBoundaries boundaries = map_get_boundaries(map);
+
+  NoiseField *ret = calloc(1, sizeof(NoiseField));
+  ret->_map = map;
+  ret->_x_size = boundaries.x;
+  ret->_y_size = boundaries.y;
+  ret->_blocks_x = (boundaries.x + NOISE_BLOCK_SIZE - 1) / NOISE_BLOCK_SIZE;
+  ret->_blocks = calloc((size_t)ret->_blocks_x * ((boundaries.y + NOISE_BLOCK_SIZE - 1) / NOISE_BLOCK_SIZE), sizeof(NoiseBlock *));
+  return ret;
+}
+
+void noise_field_free(NoiseField *field) {
+  for (uint32_t i = 0; i < field->_used_size; i++) {
+    free(field->_blocks[field->_used[i]]);
+  }
+  for (uint32_t i = 0; i < field->_spare_size; i++) {
+    free(field->_spare[i]);
+  }
+  free(field->_blocks);
+  free(field->_used);
+  free(field->_spare);
+  free(field->_events);
+  free(field->_queue);
+  free(field);
+}
+
+void noise_field_emit(NoiseField *field, uint32_t x, uint32_t y, uint8_t loudness) {
+  if (x >= field->_x_size || y >= field->_y_size || loudness == 0) {
+    return;
+  }
+
+  if (field->_events_size == field->_events_capacity) {
+    field->_events_capacity = max(field->_events_capacity * 2, MIN_NOISE_CAPACITY);
+    field->_events = realloc(field->_events, field->_events_capacity * sizeof(NoiseEvent));
+  }
+
+  field->_events[field->_events_size++] = (NoiseEvent){._x = x, ._y = y, ._loudness = loudness};
+}
+
+void noise_field_emit_movement(NoiseField *field, uint32_t x, uint32_t y) {
+  TileView tile = map_get_tile(field->_map, x, y);
+  if (tile.valid) {
+    noise_field_emit(field, x, y, min(tile.base_noise * NOISE_MOVEMENT_FACTOR, UINT8_MAX));
+  }
+}
+
+// Internal method, loudest events first
+int noise_event_compare(void const *lhs, void const *rhs) {
+  return ((NoiseEvent const *)rhs)->_loudness - ((NoiseEvent const *)lhs)->_loudness;
+}
+
+// Internal method, returns the block holding the tile, allocating it if
+// needed. The coordinates must be inside the field.
+NoiseBlock *noise_field_block(NoiseField *field, uint32_t x, uint32_t y) {
+  size_t index = x / NOISE_BLOCK_SIZE + (size_t)(y / NOISE_BLOCK_SIZE) * field->_blocks_x;
+  if (field->_blocks[index] != nullptr) {
+    return field->_blocks[index];
+  }
+
+  if (field->_used_size == field->_used_capacity) {
+    field->_used_capacity = max(field->_used_capacity * 2, MIN_NOISE_CAPACITY);
+    field->_used = realloc(field->_used, field->_used_capacity * sizeof(uint32_t));
+    field->_spare = realloc(field->_spare, field->_used_capacity * sizeof(NoiseBlock *));
+  }
+
+  NoiseBlock *block;
+  if (field->_spare_size > 0) {
+    block = field->_spare[--field->_spare_size];
+    memset(block, 0, sizeof(NoiseBlock));
+  } else {
+    block = calloc(1, sizeof(NoiseBlock));
+  }
+
+  field->_blocks[index] = block;
+  field->_used[field->_used_size++] = index;
+  return block;
+}
+
+// Internal method, raises the level of a tile and queues it to propagate
+// the noise further. Tiles can only be reached once, by the loudest noise.
+void noise_field_reach(NoiseField *field, uint32_t x, uint32_t y, uint8_t level) {
+  uint8_t *current = &noise_field_block(field, x, y)->_levels[x % NOISE_BLOCK_SIZE + (y % NOISE_BLOCK_SIZE) * NOISE_BLOCK_SIZE];
+  if (*current >= level) {
+    return;
+  }
+
+  if (field->_queue_size == field->_queue_capacity) {
+    field->_queue_capacity = max(field->_queue_capacity * 2, MIN_NOISE_CAPACITY);
+    field->_queue = realloc(field->_queue, field->_queue_capacity * sizeof(uint32_t));
+  }
+
+  *current = level;
+  field->_queue[field->_queue_size++] = x + y * field->_x_size;
+}
+
+// Internal method, frees the blocks which have not been reused by the last
+// propagation
+void noise_field_trim(NoiseField *field) {
+  for (uint32_t i = 0; i < field->_spare_size; i++) {
+    free(field->_spare[i]);
+  }
+  field->_spare_size = 0;
+}
+
+void noise_field_propagate(NoiseField *field) {
+  // The blocks reached last time are only kept to be reused
+  for (uint32_t i = 0; i < field->_used_size; i++) {
+    field->_spare[field->_spare_size++] = field->_blocks[field->_used[i]];
+    field->_blocks[field->_used[i]] = nullptr;
+  }
+  field->_used_size = 0;
+  field->_queue_size = 0;
+
+  if (field->_events_size == 0) {
+    noise_field_trim(field);
+    return;
+  }
+
+  // Breadth first search from all the events at once, one level at a time.
+  // The events join the search when it reaches their loudness, so the queue
+  // always holds the tiles of the current level after the ones of the
+  // previous level.
+  qsort(field->_events, field->_events_size, sizeof(NoiseEvent), &noise_event_compare);
+
+  uint32_t head = 0;
+  uint32_t next_event = 0;
+  for (int level = field->_events[0]._loudness; level > 0; level--) {
+    while (next_event < field->_events_size && field->_events[next_event]._loudness == level) {
+      noise_field_reach(field, field->_events[next_event]._x, field->_events[next_event]._y, level);
+      next_event++;
+    }
+
+    if (level == 1) {
+      break;
+    }
+
+    uint32_t level_end = field->_queue_size;
+    for (; head < level_end; head++) {
+      uint32_t x = field->_queue[head] % field->_x_size;
+      uint32_t y = field->_queue[head] / field->_x_size;
+
+      for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+          uint32_t neighbour_x = x + dx;
+          uint32_t neighbour_y = y + dy;
+          if ((dx == 0 && dy == 0) || neighbour_x >= field->_x_size || neighbour_y >= field->_y_size) {
+            continue;
+          }
+
+          if (map_test_plane(field->_map, MAP_PLANE_TRAVERSABLE, neighbour_x, neighbour_y)) {
+            noise_field_reach(field, neighbour_x, neighbour_y, level - 1);
+          }
+        }
+      }
+    }
+  }
+
+  field->_events_size = 0;
+  noise_field_trim(field);
+}
+
+inline uint8_t noise_field_get_level(NoiseField const *field, uint32_t x, uint32_t y) {
+  if (x >= field->_x_size || y >= field->_y_size) {
+    return 0;
+  }
+
+  NoiseBlock const *block = field->_blocks[x / NOISE_BLOCK_SIZE + (size_t)(y / NOISE_BLOCK_SIZE) * field->_blocks_x];
+  return block != nullptr ? block->_levels[x % NOISE_BLOCK_SIZE + (y % NOISE_BLOCK_SIZE) * NOISE_BLOCK_SIZE] : 0;
+}
+
+bool noise_field_can_hear(NoiseField const *field, Entity const *entity) {
+  Point   coords = entity_get_position(entity);
+  uint8_t level = noise_field_get_level(field, coords.x, coords.y);
+  return level > 0 && level + entity_get_hearing_distance(entity) > NOISE_REFERENCE_HEARING;
+}
+
+inline uint32_t noise_field_count_pending(NoiseField const *field) {
+  return field->_events_size;
+}
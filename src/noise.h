@@ -0,0 +1,65 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __NOISE__H__
+#define __NOISE__H__
+
+#include "entity.h"
+#include "map.h"
+#include <stdint.h>
+
+/*
+ * Noise level of every tile of a map. Noises are emitted during a cycle and
+ * propagated all together at the end of it: a noise loses one level per tile
+ * it travels through, and it does not go through the non traversable tiles.
+ * Each tile keeps the level of the loudest noise which reached it. Levels are
+ * only kept in memory for the blocks of tiles reached by the last propagation.
+ */
+typedef struct NoiseField NoiseField;
+
+// Loudness of the events, the noise of a movement depends on the tile
+#define NOISE_MOVEMENT_FACTOR 2
+#define NOISE_COMBAT_LOUDNESS 20
+
+// Entities with this hearing distance hear any noise reaching them, the ones
+// hearing worse need the noise to be louder.
+#define NOISE_REFERENCE_HEARING 10
+
+NoiseField *noise_field_new(Map const *);
+void        noise_field_free(NoiseField *);
+
+// Queues a noise, it is only taken into account by the next propagation
+void noise_field_emit(NoiseField *, uint32_t x, uint32_t y, uint8_t loudness);
+
+// Same as above, the loudness depends on the base noise of the tile
+void noise_field_emit_movement(NoiseField *, uint32_t x, uint32_t y);
+
+/*
+ * Replaces the previous levels with the ones of the queued noises, all of
+ * them are propagated at once and the queue is emptied.
+ */
+void noise_field_propagate(NoiseField *);
+
+uint8_t  noise_field_get_level(NoiseField const *, uint32_t x, uint32_t y); // 0 if nothing can be heard
+bool     noise_field_can_hear(NoiseField const *, Entity const *);
+uint32_t noise_field_count_pending(NoiseField const *);
+
+#endif /* ifndef __NOISE__H__ */
@@ -0,0 +1,288 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "path.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_PARENT UINT32_MAX
+
+// One node per tile, indexed by x + y * _x_size. A node only holds meaningful
+// values when its stamp is the one of the current search, so that nothing has
+// to be cleared between two searches.
+typedef struct PathNode {
+  uint32_t _cost; // From the start
+  uint32_t _estimate;
+  uint32_t _parent;
+  uint32_t _heap_index; // Position inside the open set
+  uint32_t _stamp;
+  bool     _closed;
+} PathNode;
+
+struct PathFinder {
+  Map const *_map;
+  uint32_t   _x_size;
+  uint32_t   _y_size;
+  PathNode  *_nodes;
+  uint32_t   _stamp;
+
+  // Open set, binary heap of node indexes ordered by estimated total cost
+  uint32_t *_heap;
+  uint32_t  _heap_size;
+
+  // Result of the last search
+  PathStep *_path;
+  uint32_t  _path_length;
+  uint32_t  _expanded;
+};
+
+PathFinder *path_finder_new(Map const *map) {
+  MapBoundaries boundaries = map_get_boundaries(map);
+  size_t        nodes = (size_t)boundaries.x * boundaries.y;
+
+  PathFinder *ret = calloc(1, sizeof(PathFinder));
+  ret->_map = map;
+  ret->_x_size = boundaries.x;
+  ret->_y_size = boundaries.y;
+  ret->_nodes = calloc(nodes, sizeof(PathNode));
+  ret->_stamp = 0;
+  ret->_heap = calloc(nodes, sizeof(uint32_t));
+  ret->_path = calloc(nodes, sizeof(PathStep));
+  return ret;
+}
+
+void path_finder_free(PathFinder *finder) {
+  free(finder->_nodes);
+  free(finder->_heap);
+  free(finder->_path);
+  free(finder);
+}
+
+// Internal method, diagonal moves cost the same as the straight ones
+static inline uint32_t path_distance(uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  uint32_t delta_x = from_x > to_x ? from_x - to_x : to_x - from_x;
+  uint32_t delta_y = from_y > to_y ? from_y - to_y : to_y - from_y;
+  return max(delta_x, delta_y);
+}
+
+// Internal method, ties are broken in favour of the nodes closest to the
+// destination, which avoids expanding all the equivalent paths.
+static inline bool path_node_before(PathNode const *lhs, PathNode const *rhs) {
+  uint32_t lhs_total = lhs->_cost + lhs->_estimate;
+  uint32_t rhs_total = rhs->_cost + rhs->_estimate;
+  return lhs_total < rhs_total || (lhs_total == rhs_total && lhs->_estimate < rhs->_estimate);
+}
+
+// Internal method
+static inline void path_heap_set(PathFinder *finder, uint32_t position, uint32_t node) {
+  finder->_heap[position] = node;
+  finder->_nodes[node]._heap_index = position;
+}
+
+// Internal method, moves a node towards the root until the heap is ordered
+void path_heap_up(PathFinder *finder, uint32_t position) {
+  uint32_t node = finder->_heap[position];
+  while (position > 0) {
+    uint32_t parent = (position - 1) / 2;
+    if (!path_node_before(&finder->_nodes[node], &finder->_nodes[finder->_heap[parent]])) {
+      break;
+    }
+
+    path_heap_set(finder, position, finder->_heap[parent]);
+    position = parent;
+  }
+
+  path_heap_set(finder, position, node);
+}
+
+// Internal method, moves a node towards the leaves until the heap is ordered
+void path_heap_down(PathFinder *finder, uint32_t position) {
+  uint32_t node = finder->_heap[position];
+  while (true) {
+    uint32_t child = 2 * position + 1;
+    if (child >= finder->_heap_size) {
+      break;
+    }
+
+    if (child + 1 < finder->_heap_size &&
+        path_node_before(&finder->_nodes[finder->_heap[child + 1]], &finder->_nodes[finder->_heap[child]])) {
+      child++;
+    }
+
+    if (!path_node_before(&finder->_nodes[finder->_heap[child]], &finder->_nodes[node])) {
+      break;
+    }
+
+    path_heap_set(finder, position, finder->_heap[child]);
+    position = child;
+  }
+
+  path_heap_set(finder, position, node);
+}
+
+// Internal method
+uint32_t path_heap_pop(PathFinder *finder) {
+  uint32_t ret = finder->_heap[0];
+  finder->_heap_size--;
+  if (finder->_heap_size > 0) {
+    path_heap_set(finder, 0, finder->_heap[finder->_heap_size]);
+    path_heap_down(finder, 0);
+  }
+
+  return ret;
+}
+
+// Internal method, starts a new search. Stamps of previous searches are only
+// reset when the counter wraps around.
+void path_finder_reset(PathFinder *finder) {
+  finder->_heap_size = 0;
+  finder->_path_length = 0;
+  finder->_expanded = 0;
+
+  if (finder->_stamp == UINT32_MAX) {
+    for (size_t i = 0; i < (size_t)finder->_x_size * finder->_y_size; i++) {
+      finder->_nodes[i]._stamp = 0;
+    }
+    finder->_stamp = 0;
+  }
+
+  finder->_stamp++;
+}
+
+// Internal method, a tile can be walked through if it is traversable and
+// nobody is standing on it, apart for the destination.
+bool path_finder_can_enter(PathFinder const *finder, uint32_t x, uint32_t y, uint32_t to_x, uint32_t to_y) {
+  if (!map_test_plane(finder->_map, MAP_PLANE_TRAVERSABLE, x, y)) {
+    return false;
+  }
+
+  return (x == to_x && y == to_y) || map_is_tile_free(finder->_map, x, y);
+}
+
+// Internal method, writes the path from the start to the given node
+void path_finder_build_path(PathFinder *finder, uint32_t node) {
+  uint32_t length = 0;
+  for (uint32_t current = node; finder->_nodes[current]._parent != NO_PARENT; current = finder->_nodes[current]._parent) {
+    length++;
+  }
+
+  finder->_path_length = length;
+  for (uint32_t current = node; finder->_nodes[current]._parent != NO_PARENT; current = finder->_nodes[current]._parent) {
+    length--;
+    finder->_path[length] = (PathStep){.x = current % finder->_x_size, .y = current / finder->_x_size};
+  }
+}
+
+bool path_finder_search(PathFinder *finder, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y) {
+  path_finder_reset(finder);
+
+  if (from_x >= finder->_x_size || from_y >= finder->_y_size || to_x >= finder->_x_size || to_y >= finder->_y_size ||
+      !map_test_plane(finder->_map, MAP_PLANE_TRAVERSABLE, to_x, to_y)) {
+    return false;
+  }
+
+  // No need to search for what cannot be found
+  if (map_test_plane(finder->_map, MAP_PLANE_TRAVERSABLE, from_x, from_y) && !map_same_region(finder->_map, from_x, from_y, to_x, to_y)) {
+    return false;
+  }
+
+  uint32_t start = from_x + from_y * finder->_x_size;
+  uint32_t goal = to_x + to_y * finder->_x_size;
+
+  finder->_nodes[start] = (PathNode){
+    ._cost = 0,
+    ._estimate = path_distance(from_x, from_y, to_x, to_y),
+    ._parent = NO_PARENT,
+    ._stamp = finder->_stamp,
+    ._closed = false,
+  };
+  finder->_heap_size = 1;
+  path_heap_set(finder, 0, start);
+
+  while (finder->_heap_size > 0) {
+    uint32_t  current = path_heap_pop(finder);
+    PathNode *current_node = &finder->_nodes[current];
+    if (current == goal) {
+      path_finder_build_path(finder, goal);
+      return true;
+    }
+
+    current_node->_closed = true;
+    finder->_expanded++;
+
+    uint32_t x = current % finder->_x_size;
+    uint32_t y = current / finder->_x_size;
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        uint32_t neighbour_x = x + dx;
+        uint32_t neighbour_y = y + dy;
+        if ((dx == 0 && dy == 0) || neighbour_x >= finder->_x_size || neighbour_y >= finder->_y_size) {
+          continue;
+        }
+
+        uint32_t  neighbour = neighbour_x + neighbour_y * finder->_x_size;
+        PathNode *neighbour_node = &finder->_nodes[neighbour];
+        uint32_t  cost = current_node->_cost + 1;
+        bool      seen = neighbour_node->_stamp == finder->_stamp;
+
+        if (seen && (neighbour_node->_closed || neighbour_node->_cost <= cost)) {
+          continue;
+        }
+
+        if (!seen) {
+          if (!path_finder_can_enter(finder, neighbour_x, neighbour_y, to_x, to_y)) {
+            // Never look at this tile again during this search
+            *neighbour_node = (PathNode){._stamp = finder->_stamp, ._closed = true};
+            continue;
+          }
+
+          neighbour_node->_stamp = finder->_stamp;
+          neighbour_node->_closed = false;
+          neighbour_node->_estimate = path_distance(neighbour_x, neighbour_y, to_x, to_y);
+          neighbour_node->_heap_index = finder->_heap_size++;
+          finder->_heap[neighbour_node->_heap_index] = neighbour;
+        }
+
+        neighbour_node->_cost = cost;
+        neighbour_node->_parent = current;
+        path_heap_up(finder, neighbour_node->_heap_index);
+      }
+    }
+  }
+
+  return false;
+}
+
+inline uint32_t path_finder_get_length(PathFinder const *finder) {
+  return finder->_path_length;
+}
+
+inline PathStep path_finder_get_step(PathFinder const *finder, uint32_t index) {
+  assert(index < finder->_path_length);
+  return finder->_path[index];
+}
+
+inline uint32_t path_finder_count_expanded(PathFinder const *finder) {
+  return finder->_expanded;
+}
@@ -0,0 +1,58 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __PATH__H__
+#define __PATH__H__
+
+#include "map.h"
+#include <stdint.h>
+
+/*
+ * A* path finder over the tiles of a map. Entities move in 8 directions, one
+ * tile per cycle, through the traversable tiles which are not occupied by
+ * another entity (the destination may be occupied, to reach an entity).
+ *
+ * All the memory is allocated once for the whole map when the path finder is
+ * created, searches only reuse it: keep one path finder around and use it
+ * for all the searches on the same map.
+ */
+typedef struct PathFinder PathFinder;
+
+typedef struct PathStep {
+  uint32_t x;
+  uint32_t y;
+} PathStep;
+
+PathFinder *path_finder_new(Map const *);
+void        path_finder_free(PathFinder *);
+
+/*
+ * Searches the shortest path between the two tiles, returns false if there
+ * is none. The path is kept until the next search.
+ */
+bool path_finder_search(PathFinder *, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+
+// The path does not include the starting tile, the last step is the destination
+uint32_t path_finder_get_length(PathFinder const *);
+PathStep path_finder_get_step(PathFinder const *, uint32_t);
+uint32_t path_finder_count_expanded(PathFinder const *); // PERF: Only useful for tests
+
+#endif /* ifndef __PATH__H__ */
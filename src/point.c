@@ -20,45 +20,22 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "point.h"
+#include "collections/object_pool.h"
 #include <stdint.h>
-#include <stdlib.h>
 
-struct Point {
-  uint32_t _x;
-  uint32_t _y;
-};
+// Only used from the main thread
+static ObjectPool *point_pool = nullptr;
 
 Point *point_new(uint32_t x, uint32_t y) {
-  Point *ret = calloc(1, sizeof(Point));
-  ret->_x = x;
-  ret->_y = y;
+  Point *ret = object_pool_alloc_shared(&point_pool, sizeof(Point));
+  *ret = point_at(x, y);
   return ret;
 }
 
 void point_free(Point *point) {
-  free(point);
+  object_pool_release_shared(&point_pool, point);
 }
 
-inline uint32_t point_get_x(Point const *point) {
-  return point->_x;
-}
-
-inline uint32_t point_get_y(Point const *point) {
-  return point->_y;
-}
-
-inline bool point_has_coords(Point const *point, uint32_t x, uint32_t y) {
-  return point->_x == x && point->_y == y;
-}
-
-inline void point_set_x(Point *point, uint32_t x) {
-  point->_x = x;
-}
-
-inline void point_set_y(Point *point, uint32_t y) {
-  point->_y = y;
-}
-
-inline bool points_equal(Point const *lhs, Point const *rhs) {
-  return lhs->_x == rhs->_x && rhs->_y && lhs->_y;
+void point_shutdown() {
+  object_pool_free_shared(&point_pool);
 }
@@ -23,22 +23,59 @@
 #define __POINT__H__
 
 #include <stdint.h>
-typedef struct Point Point;
+
+// Coordinates of something on a map. Points are small enough to be stored
+// inline and passed around by value, there is no need to allocate them.
+typedef struct Point {
+  uint32_t x;
+  uint32_t y;
+} Point;
+
+static inline Point point_at(uint32_t x, uint32_t y) {
+  return (Point){.x = x, .y = y};
+}
+
+static inline bool point_is_at(Point point, uint32_t x, uint32_t y) {
+  return point.x == x && point.y == y;
+}
+
+static inline bool point_equals(Point lhs, Point rhs) {
+  return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+// Compatibility layer for the code handling points through pointers, new code
+// should use the value functions above instead.
 
 // Constructors and destructors
 Point *point_new(uint32_t x, uint32_t y);
 void   point_free(Point *);
+void   point_shutdown(); // Frees the memory kept for the points, all of them must have been freed
 
 // Getters
-uint32_t point_get_x(Point const *);
-uint32_t point_get_y(Point const *);
-bool     point_has_coords(Point const *, uint32_t x, uint32_t y);
+static inline uint32_t point_get_x(Point const *point) {
+  return point->x;
+}
+
+static inline uint32_t point_get_y(Point const *point) {
+  return point->y;
+}
+
+static inline bool point_has_coords(Point const *point, uint32_t x, uint32_t y) {
+  return point_is_at(*point, x, y);
+}
 
 // Setters
-void point_set_x(Point *, uint32_t);
-void point_set_y(Point *, uint32_t);
+static inline void point_set_x(Point *point, uint32_t x) {
+  point->x = x;
+}
+
+static inline void point_set_y(Point *point, uint32_t y) {
+  point->y = y;
+}
 
 // Methods
-bool points_equal(Point const *, Point const *);
+static inline bool points_equal(Point const *lhs, Point const *rhs) {
+  return point_equals(*lhs, *rhs);
+}
 
 #endif
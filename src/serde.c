@@ -91,6 +91,9 @@ void const *serde_map_get(msgpack_object_map const *map, msgpack_object_type typ
       case MSGPACK_OBJECT_FLOAT:
         ret = &obj->val.via.f64;
         break;
+      case MSGPACK_OBJECT_BIN:
+        ret = &obj->val.via.bin;
+        break;
       default:
         break;
     }
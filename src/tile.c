@@ -39,7 +39,7 @@ typedef struct Tile {
   bool     _inside;
   bool     _traversable;
   Item   **_items;
-  Point   *_coords;
+  Point    _coords;
 } Tile;
 
 Tile *tile_new(TileKind kind, uint32_t x, uint32_t y) {
@@ -52,7 +52,7 @@ Tile *tile_new(TileKind kind, uint32_t x, uint32_t y) {
   tile->_traversable = true;
   tile->_items = calloc(1, sizeof(Item *));
   tile->_items[0] = nullptr;
-  tile->_coords = point_new(x, y);
+  tile->_coords = point_at(x, y);
 
   return tile;
 }
@@ -86,7 +86,7 @@ Tile *tile_deserialize(msgpack_object_map const *map) {
     tile->_items[i] = item_deserialize(&items->ptr[i].via.map);
   }
 
-  tile->_coords = point_new(coords->ptr[0].via.u64, coords->ptr[1].via.u64);
+  tile->_coords = point_at(coords->ptr[0].via.u64, coords->ptr[1].via.u64);
 
   return tile;
 }
@@ -120,8 +120,8 @@ void tile_serialize(Tile const *tile, msgpack_sbuffer *sbuffer) {
 
   serde_pack_str(packer, "coords");
   msgpack_pack_array(packer, 2);
-  msgpack_pack_uint32(packer, point_get_x(tile->_coords));
-  msgpack_pack_uint32(packer, point_get_y(tile->_coords));
+  msgpack_pack_uint32(packer, tile->_coords.x);
+  msgpack_pack_uint32(packer, tile->_coords.y);
 
   msgpack_packer_free(packer);
 }
@@ -134,7 +134,6 @@ void tile_free(Tile *tile) {
     current_item = tile->_items[++index];
   }
 
-  point_free(tile->_coords);
   free(tile);
 }
 
@@ -159,6 +158,10 @@ inline uint32_t tile_get_base_light(Tile const *tile) {
 }
 
 inline Point const *tile_get_coords(Tile const *tile) {
+  return &tile->_coords;
+}
+
+inline Point tile_get_position(Tile const *tile) {
   return tile->_coords;
 }
 
@@ -36,6 +36,8 @@ typedef enum TileKind {
   ROAD = '#',
   GRAVIER = '*',
   FLOOR = ' ',
+  FOREST = '"',
+  ROCK = 'A',
 } TileKind;
 
 // Constructors and destructors
@@ -51,6 +53,7 @@ bool         tile_is_traversable(Tile const *);
 uint32_t     tile_get_base_noise(Tile const *);
 uint32_t     tile_get_base_light(Tile const *);
 Point const *tile_get_coords(Tile const *);
+Point        tile_get_position(Tile const *);
 
 // Items manipulation
 uint32_t    tile_count_items(Tile const *);
@@ -29,6 +29,10 @@ typedef enum ErrorCode {
   // 100 - onwards = error in code
   EC_DEPRECATED_FUNCTION = 101,
   EC_ENTITY_EMPTY_NAME = 102,
+  EC_MAP_TOO_MANY_REGIONS = 103,
+
+  // 200 - onwards = error in the environment
+  EC_CHUNK_STORE_UNAVAILABLE = 201,
 } ErrorCode;
 
 bool     strings_equal(const char *, const char *);
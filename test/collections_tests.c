@@ -1,3 +1,7 @@
+#include "collections/hash_index.h"
+#include "collections/object_pool.h"
+#include "collections/spatial_grid.h"
+#include "collections/union_find.h"
 #include "collections/linked_list.h"
 #include "entity.h"
 #include "item.h"
@@ -197,9 +201,235 @@ void linked_list_memory(void) {
   linked_list_free(list);
 }
 
+void hash_index_basics(void) {
+  HashIndex *index = hash_index_new(4);
+  CU_ASSERT_EQUAL(hash_index_count(index), 0);
+  CU_ASSERT_FALSE(hash_index_contains(index, "missing"));
+
+  hash_index_put(index, "first", 1);
+  hash_index_put(index, "second", 2);
+  CU_ASSERT_EQUAL(hash_index_count(index), 2);
+
+  uint32_t value = 0;
+  CU_ASSERT_TRUE(hash_index_get(index, "first", &value));
+  CU_ASSERT_EQUAL(value, 1);
+
+  // Updating an existing key does not add a new entry
+  hash_index_put(index, "first", 10);
+  CU_ASSERT_EQUAL(hash_index_count(index), 2);
+  CU_ASSERT_TRUE(hash_index_get(index, "first", &value));
+  CU_ASSERT_EQUAL(value, 10);
+
+  CU_ASSERT_TRUE(hash_index_remove(index, "first"));
+  CU_ASSERT_FALSE(hash_index_remove(index, "first"));
+  CU_ASSERT_FALSE(hash_index_contains(index, "first"));
+  CU_ASSERT_TRUE(hash_index_contains(index, "second"));
+  CU_ASSERT_EQUAL(hash_index_count(index), 1);
+
+  hash_index_clear(index);
+  CU_ASSERT_EQUAL(hash_index_count(index), 0);
+  CU_ASSERT_FALSE(hash_index_contains(index, "second"));
+
+  hash_index_free(index);
+}
+
+void hash_index_lot_items(void) {
+  HashIndex *index = hash_index_new(0);
+  char       names[2048][16];
+
+  for (uint32_t i = 0; i < 2048; i++) {
+    snprintf(names[i], sizeof(names[i]), "Entity #%d", i);
+    hash_index_put(index, names[i], i);
+  }
+
+  CU_ASSERT_EQUAL(hash_index_count(index), 2048);
+  CU_ASSERT_TRUE(hash_index_get_capacity(index) >= 2048);
+
+  // Remove all the odd ones, so that we have a lot of tombstones around
+  for (uint32_t i = 1; i < 2048; i += 2) {
+    CU_ASSERT_TRUE(hash_index_remove(index, names[i]));
+  }
+
+  CU_ASSERT_EQUAL(hash_index_count(index), 1024);
+
+  uint32_t value = 0;
+  CU_ASSERT_TRUE(hash_index_get(index, "Entity #444", &value));
+  CU_ASSERT_EQUAL(value, 444);
+  CU_ASSERT_FALSE(hash_index_contains(index, "Entity #445"));
+
+  // Put them back
+  for (uint32_t i = 1; i < 2048; i += 2) {
+    hash_index_put(index, names[i], i * 2);
+  }
+
+  CU_ASSERT_EQUAL(hash_index_count(index), 2048);
+  CU_ASSERT_TRUE(hash_index_get(index, "Entity #445", &value));
+  CU_ASSERT_EQUAL(value, 890);
+
+  hash_index_free(index);
+}
+
+void spatial_grid_queries(void) {
+  SpatialGrid *grid = spatial_grid_new(100, 50, 8);
+  int          values[5];
+  void        *found[5];
+
+  spatial_grid_insert(grid, &values[0], 10, 10);
+  spatial_grid_insert(grid, &values[1], 12, 10);
+  spatial_grid_insert(grid, &values[2], 10, 20);
+  spatial_grid_insert(grid, &values[3], 99, 49);
+
+  // Outside of the grid, ignored
+  spatial_grid_insert(grid, &values[4], 100, 10);
+  CU_ASSERT_EQUAL(spatial_grid_count(grid), 4);
+
+  CU_ASSERT_EQUAL(spatial_grid_query_rect(grid, 0, 0, 15, 15, found, 5), 2);
+  CU_ASSERT_PTR_EQUAL(found[0], &values[0]);
+  CU_ASSERT_PTR_EQUAL(found[1], &values[1]);
+
+  // Rectangles going past the boundaries are clamped
+  CU_ASSERT_EQUAL(spatial_grid_query_rect(grid, 90, 40, 200, 200, found, 5), 1);
+  CU_ASSERT_PTR_EQUAL(found[0], &values[3]);
+
+  // Radius is an euclidean distance
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 10, 10, 2, found, 5), 2);
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 10, 12, 2, found, 5), 1);
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 11, 15, 5, found, 5), 0);
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 10, 15, 10, found, 5), 3);
+
+  // The buffer is never overflown, but the total is returned anyway
+  found[1] = nullptr;
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 10, 15, 10, found, 1), 3);
+  CU_ASSERT_PTR_NULL(found[1]);
+
+  // Moving inside the same cell and to another one
+  CU_ASSERT_TRUE(spatial_grid_move(grid, &values[1], 12, 10, 13, 11));
+  CU_ASSERT_FALSE(spatial_grid_move(grid, &values[1], 12, 10, 13, 11));
+  CU_ASSERT_TRUE(spatial_grid_move(grid, &values[1], 13, 11, 98, 48));
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 99, 49, 2, found, 5), 2);
+  CU_ASSERT_EQUAL(spatial_grid_query_radius(grid, 10, 10, 5, found, 5), 1);
+
+  CU_ASSERT_TRUE(spatial_grid_remove(grid, &values[3], 99, 49));
+  CU_ASSERT_FALSE(spatial_grid_remove(grid, &values[3], 99, 49));
+  CU_ASSERT_EQUAL(spatial_grid_count(grid), 3);
+
+  spatial_grid_clear(grid);
+  CU_ASSERT_EQUAL(spatial_grid_count(grid), 0);
+  CU_ASSERT_EQUAL(spatial_grid_query_rect(grid, 0, 0, 99, 49, found, 5), 0);
+
+  spatial_grid_free(grid);
+}
+
+void union_find_sets(void) {
+  UnionFind *uf = union_find_new(10);
+  CU_ASSERT_EQUAL(union_find_size(uf), 10);
+  CU_ASSERT_EQUAL(union_find_count_sets(uf), 10);
+  CU_ASSERT_FALSE(union_find_same(uf, 1, 2));
+
+  CU_ASSERT_TRUE(union_find_unite(uf, 1, 2));
+  CU_ASSERT_TRUE(union_find_unite(uf, 3, 4));
+  CU_ASSERT_TRUE(union_find_unite(uf, 2, 4));
+  CU_ASSERT_FALSE(union_find_unite(uf, 1, 3));
+  CU_ASSERT_EQUAL(union_find_count_sets(uf), 7);
+  CU_ASSERT_TRUE(union_find_same(uf, 1, 3));
+  CU_ASSERT_EQUAL(union_find_find(uf, 1), union_find_find(uf, 4));
+  CU_ASSERT_FALSE(union_find_same(uf, 1, 5));
+
+  union_find_reset(uf);
+  CU_ASSERT_EQUAL(union_find_count_sets(uf), 10);
+  CU_ASSERT_FALSE(union_find_same(uf, 1, 3));
+
+  // Growing keeps the sets
+  union_find_unite(uf, 1, 3);
+  union_find_grow(uf, 20);
+  CU_ASSERT_EQUAL(union_find_size(uf), 20);
+  CU_ASSERT_EQUAL(union_find_count_sets(uf), 19);
+  CU_ASSERT_TRUE(union_find_same(uf, 1, 3));
+  CU_ASSERT_TRUE(union_find_unite(uf, 3, 15));
+  CU_ASSERT_TRUE(union_find_same(uf, 1, 15));
+
+  // A long chain
+  UnionFind *chain = union_find_new(10000);
+  for (uint32_t i = 1; i < 10000; i++) {
+    union_find_unite(chain, i - 1, i);
+  }
+  CU_ASSERT_EQUAL(union_find_count_sets(chain), 1);
+  CU_ASSERT_TRUE(union_find_same(chain, 0, 9999));
+
+  union_find_free(chain);
+  union_find_free(uf);
+}
+
+void object_pool_reuse(void) {
+  ObjectPool *pool = object_pool_new(sizeof(uint64_t) * 3);
+  CU_ASSERT_EQUAL(object_pool_count(pool), 0);
+  CU_ASSERT_EQUAL(object_pool_capacity(pool), 0);
+
+  uint64_t *objects[1000];
+  for (uint32_t i = 0; i < 1000; i++) {
+    objects[i] = object_pool_alloc(pool);
+    CU_ASSERT_EQUAL(objects[i][0] | objects[i][1] | objects[i][2], 0);
+    objects[i][0] = i;
+    objects[i][2] = i;
+  }
+  CU_ASSERT_EQUAL(object_pool_count(pool), 1000);
+  uint32_t const capacity = object_pool_capacity(pool);
+  CU_ASSERT_TRUE(capacity >= 1000);
+
+  // Objects do not overlap
+  for (uint32_t i = 0; i < 1000; i++) {
+    CU_ASSERT_EQUAL(objects[i][0], i);
+    CU_ASSERT_EQUAL(objects[i][2], i);
+  }
+
+  // Released objects are handed out again, zeroed, without growing the pool
+  object_pool_release(pool, objects[10]);
+  object_pool_release(pool, objects[500]);
+  CU_ASSERT_EQUAL(object_pool_count(pool), 998);
+
+  uint64_t *reused = object_pool_alloc(pool);
+  CU_ASSERT_PTR_EQUAL(reused, objects[500]);
+  CU_ASSERT_EQUAL(reused[0], 0);
+  CU_ASSERT_PTR_EQUAL(object_pool_alloc(pool), objects[10]);
+  CU_ASSERT_EQUAL(object_pool_count(pool), 1000);
+  CU_ASSERT_EQUAL(object_pool_capacity(pool), capacity);
+
+  // Releasing every object at once
+  object_pool_free(pool);
+
+  // Shared pools outlive their objects, up to the explicit shutdown
+  ObjectPool *shared = nullptr;
+  object_pool_free_shared(&shared);
+  CU_ASSERT_PTR_NULL(shared);
+
+  void *first = object_pool_alloc_shared(&shared, sizeof(uint32_t));
+  void *second = object_pool_alloc_shared(&shared, sizeof(uint32_t));
+  CU_ASSERT_PTR_NOT_NULL(shared);
+  CU_ASSERT_EQUAL(object_pool_count(shared), 2);
+
+  uint32_t shared_capacity = object_pool_capacity(shared);
+  object_pool_release_shared(&shared, first);
+  object_pool_release_shared(&shared, second);
+  CU_ASSERT_PTR_NOT_NULL(shared);
+  CU_ASSERT_EQUAL(object_pool_count(shared), 0);
+  CU_ASSERT_EQUAL(object_pool_capacity(shared), shared_capacity);
+
+  // The next wave reuses the same slab
+  CU_ASSERT_PTR_EQUAL(object_pool_alloc_shared(&shared, sizeof(uint32_t)), second);
+  CU_ASSERT_EQUAL(object_pool_capacity(shared), shared_capacity);
+
+  object_pool_free_shared(&shared);
+  CU_ASSERT_PTR_NULL(shared);
+}
+
 void collection_test_suite() {
   CU_pSuite suite = CU_add_suite("Collections Tests", nullptr, nullptr);
   CU_add_test(suite, "Linked Lists: Add and remove, list with 0 items", &linked_list_zero_items);
   CU_add_test(suite, "Linked Lists: Add and remove, lots of items", &linked_list_lot_items);
   CU_add_test(suite, "Linked Lists: Memory management", &linked_list_memory);
+  CU_add_test(suite, "Hash Index: Add and remove", &hash_index_basics);
+  CU_add_test(suite, "Hash Index: Lots of items", &hash_index_lot_items);
+  CU_add_test(suite, "Spatial Grid: Queries", &spatial_grid_queries);
+  CU_add_test(suite, "Union Find: Sets", &union_find_sets);
+  CU_add_test(suite, "Object Pool: Reuse", &object_pool_reuse);
 }
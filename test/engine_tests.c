@@ -42,6 +42,13 @@ void engine_entities_test(void) {
   engine_clear_active_entity(engine);
   CU_ASSERT_FALSE(engine_has_active_entity(engine));
 
+  // The active entity is forgotten once it leaves the map
+  engine_set_active_handle(engine, map_get_entity_handle(map, "e1"));
+  CU_ASSERT_PTR_EQUAL(engine_get_entity(engine, engine_get_active_handle(engine)), map_get_entity(map, "e1"));
+  map_remove_entity(map, "e1");
+  CU_ASSERT_FALSE(engine_has_active_entity(engine));
+  CU_ASSERT_PTR_NULL(engine_get_active_entity(engine));
+
   engine_free(engine);
 }
 
@@ -247,6 +254,125 @@ void engine_attack_test(void) {
   engine_entity_attack(engine, human3, zombie);
   CU_ASSERT_EQUAL(entity_get_life_points(zombie), 6);
 
+  // Fights are heard once the cycle is over
+  CU_ASSERT_FALSE(engine_entity_can_hear(engine, human1));
+  engine_propagate_noise(engine);
+  CU_ASSERT_TRUE(engine_entity_can_hear(engine, human1));
+  CU_ASSERT_EQUAL(noise_field_get_level(engine_get_noise_field(engine), 10, 10), NOISE_COMBAT_LOUDNESS);
+
+  engine_free(engine);
+}
+
+void engine_chase_test(void) {
+  Engine *engine = engine_new(map_new(40, 40, 10, "Some map"));
+  engine_add_entity(engine, entity_build(10, HUMAN, "h1", 20, 20));
+  engine_add_entity(engine, entity_build(10, INHUMAN, "z1", 10, 20));
+  engine_add_entity(engine, entity_build(10, INHUMAN, "z2", 25, 25));
+  engine_set_active_entity(engine, "h1");
+
+  // Inhuman entities walk straight to the active entity
+  for (uint32_t i = 0; i < 9; i++) {
+    engine_move_all_entities(engine);
+  }
+
+  Entity const *z1 = map_get_entity(engine_get_map(engine), "z1");
+  Entity const *z2 = map_get_entity(engine_get_map(engine), "z2");
+  CU_ASSERT_EQUAL(point_get_x(entity_get_coords(z1)), 19);
+  CU_ASSERT_EQUAL(point_get_y(entity_get_coords(z1)), 20);
+  CU_ASSERT_EQUAL(point_get_x(entity_get_coords(z2)), 21);
+  CU_ASSERT_EQUAL(point_get_y(entity_get_coords(z2)), 21);
+
+  // And they stay there
+  engine_move_all_entities(engine);
+  CU_ASSERT_EQUAL(point_get_x(entity_get_coords(z1)), 19);
+  CU_ASSERT_EQUAL(point_get_x(entity_get_coords(z2)), 21);
+
+  engine_free(engine);
+}
+
+void engine_needs_test(void) {
+  Engine *engine = engine_new(map_new(40, 40, 10, "Some map"));
+  Entity *human = entity_build(10, HUMAN, "h1", 1, 1);
+  Entity *animal = entity_build(10, ANIMAL, "a1", 2, 2);
+  Entity *tree = entity_build(10, TREE, "t1", 3, 3);
+  Entity *dead = entity_build(10, HUMAN, "h2", 4, 4);
+  engine_add_entity(engine, human);
+  engine_add_entity(engine, animal);
+  engine_add_entity(engine, tree);
+  engine_add_entity(engine, dead);
+  engine_set_active_entity(engine, "h1");
+  entity_hurt(dead, 10);
+
+  // Every cycle makes the living humans and animals a bit more needy
+  engine_handle_keypress(engine, ' ');
+  CU_ASSERT_EQUAL(entity_get_hunger(human), 1);
+  CU_ASSERT_EQUAL(entity_get_thirst(human), 1);
+  CU_ASSERT_EQUAL(entity_get_tiredness(animal), 1);
+  CU_ASSERT_EQUAL(entity_get_hunger(tree), 0);
+  CU_ASSERT_EQUAL(entity_get_hunger(dead), 0);
+
+  // Rates depend on the type
+  engine_set_needs_rates(engine, ANIMAL, (NeedsRates){.hunger = 2, .thirst = 0, .tiredness = 5});
+  CU_ASSERT_EQUAL(engine_get_needs_rates(engine, ANIMAL).tiredness, 5);
+  CU_ASSERT_EQUAL(engine_get_needs_rates(engine, TREE).hunger, 0);
+  engine_handle_keypress(engine, ' ');
+  CU_ASSERT_EQUAL(entity_get_hunger(animal), 3);
+  CU_ASSERT_EQUAL(entity_get_thirst(animal), 1);
+  CU_ASSERT_EQUAL(entity_get_tiredness(animal), 6);
+  CU_ASSERT_EQUAL(entity_get_hunger(human), 2);
+
+  // Needs saturate
+  entity_set_tiredness(animal, UINT32_MAX - 2);
+  engine_handle_keypress(engine, ' ');
+  CU_ASSERT_EQUAL(entity_get_tiredness(animal), UINT32_MAX);
+
+  // Each engine has its own cycles and rates
+  Engine *other = engine_new(map_new(40, 40, 10, "Other map"));
+  Entity *other_animal = entity_build(10, ANIMAL, "a2", 2, 2);
+  engine_add_entity(other, other_animal);
+  engine_set_active_entity(other, "a2");
+  CU_ASSERT_EQUAL(engine_get_needs_rates(other, ANIMAL).hunger, ENTITY_DEFAULT_NEEDS_RATE);
+  engine_handle_keypress(other, ' ');
+  CU_ASSERT_EQUAL(entity_get_hunger(other_animal), 1);
+  CU_ASSERT_EQUAL(entity_get_hunger(animal), 5);
+  engine_handle_keypress(engine, ' ');
+  CU_ASSERT_EQUAL(entity_get_hunger(other_animal), 1);
+  CU_ASSERT_EQUAL(entity_get_hunger(animal), 7);
+
+  engine_free(other);
+  engine_free(engine);
+}
+
+void engine_view_test(void) {
+  Map           *map = map_new(40, 40, 2, "Dark map");
+  TileProperties dark = {.kind = GRASS, .base_light = 0, .inside = false, .traversable = true};
+  map_fill_tiles(map, 0, 0, 39, 39, &dark);
+
+  Engine *engine = engine_new(map);
+  engine_add_entity(engine, entity_build(10, HUMAN, "Seer", 20, 20));
+  engine_set_active_entity(engine, "Seer");
+
+  // Nothing can be seen in the dark
+  CU_ASSERT_FALSE(engine_active_entity_can_see(engine, 21, 20));
+
+  // Until the next cycle brings the torch in
+  light_map_add_source(engine_get_light_map(engine), 20, 20, 4, 8);
+  CU_ASSERT_FALSE(engine_active_entity_can_see(engine, 21, 20));
+  engine_handle_keypress(engine, ' ');
+  CU_ASSERT_TRUE(engine_active_entity_can_see(engine, 21, 20));
+  CU_ASSERT_TRUE(engine_active_entity_can_see(engine, 23, 20));
+  CU_ASSERT_FALSE(engine_active_entity_can_see(engine, 26, 20));
+
+  // Lit tiles are still seen from the dark, not the dark ones around
+  for (int i = 0; i < 6; i++) {
+    engine_handle_keypress(engine, 'l');
+  }
+  CU_ASSERT_EQUAL(entity_get_position(engine_get_active_entity(engine)).x, 26);
+  CU_ASSERT_TRUE(engine_active_entity_can_see(engine, 21, 20));
+  CU_ASSERT_FALSE(engine_active_entity_can_see(engine, 27, 20));
+
+  engine_clear_active_entity(engine);
+  CU_ASSERT_FALSE(engine_active_entity_can_see(engine, 26, 20));
   engine_free(engine);
 }
 
@@ -413,6 +539,9 @@ void engine_test_suite() {
   CU_add_test(suite, "Engine entities", &engine_entities_test);
   CU_add_test(suite, "Engine keypress", &engine_keypress_test);
   CU_add_test(suite, "Engine attacks", &engine_attack_test);
+  CU_add_test(suite, "Engine chase", &engine_chase_test);
+  CU_add_test(suite, "Engine needs", &engine_needs_test);
+  CU_add_test(suite, "Engine view", &engine_view_test);
   CU_add_test(suite, "Engine serialization", &engine_serialize_test);
   CU_add_test(suite, "Engine deserialization", &engine_deserialize_test);
 }
@@ -1,4 +1,5 @@
 #include "item.h"
+#include "map.h"
 #include "perk.h"
 #include "point.h"
 #include "serde.h"
@@ -151,6 +152,7 @@ void entity_move_test(void) {
 
   CU_ASSERT_EQUAL(point_get_x(entity_get_coords(dog)), 42);
   CU_ASSERT_EQUAL(point_get_y(entity_get_coords(dog)), 12);
+  CU_ASSERT_TRUE(point_is_at(entity_get_position(dog), 42, 12));
 
   Entity *tree = entity_build(1, TREE, "Ent", 20, 1);
   CU_ASSERT_FALSE(entity_can_move(tree));
@@ -594,6 +596,115 @@ void entity_equipment_test(void) {
   entity_free(entity);
 }
 
+void entity_stats_view_test(void) {
+  Map    *map = map_new(10, 10, 2, "Stats");
+  Map    *other = map_new(10, 10, 2, "Other stats");
+  Entity *first = entity_build(10, HUMAN, "First", 0, 0);
+  Entity *second = entity_build(20, ANIMAL, "Second", 1, 0);
+  Entity *third = entity_build(30, INHUMAN, "Third", 2, 0);
+  entity_set_hunger(third, 5);
+
+  // Entities outside of maps keep their own stats
+  entity_hurt(third, 10);
+  CU_ASSERT_EQUAL(entity_get_life_points(third), 20);
+  CU_ASSERT_EQUAL(map_get_stats_view(map).size, 0);
+
+  CU_ASSERT_TRUE(map_add_entity(map, first));
+  CU_ASSERT_TRUE(map_add_entity(map, second));
+  CU_ASSERT_TRUE(map_add_entity(map, third));
+  CU_ASSERT_TRUE(map_add_entity(other, entity_build(40, HUMAN, "Fourth", 0, 0)));
+
+  EntityStatsView view = map_get_stats_view(map);
+  CU_ASSERT_EQUAL(view.size, 3);
+  CU_ASSERT_EQUAL(map_get_stats_view(other).size, 1);
+  CU_ASSERT_PTR_EQUAL(view.entities[2], third);
+  CU_ASSERT_EQUAL(view.life_points[2], 20);
+  CU_ASSERT_EQUAL(view.starting_life_points[2], 30);
+  CU_ASSERT_EQUAL(view.starting_life_points[1], 20);
+  CU_ASSERT_EQUAL(view.hunger[2], 5);
+  CU_ASSERT_EQUAL(view.types[1], ANIMAL);
+
+  // Systems write straight into the arrays
+  view.thirst[0] = 7;
+  view.life_points[0] = 0;
+  CU_ASSERT_EQUAL(entity_get_thirst(first), 7);
+  CU_ASSERT_TRUE(entity_is_dead(first));
+
+  // The last entity takes the place of the removed one, in the map as well
+  EntityHandle handle = map_get_entity_handle(map, "Third");
+  map_remove_entity(map, "First");
+  view = map_get_stats_view(map);
+  CU_ASSERT_EQUAL(view.size, 2);
+  CU_ASSERT_PTR_EQUAL(view.entities[0], third);
+  CU_ASSERT_EQUAL(map_get_index_of_handle(map, handle), 0);
+  CU_ASSERT_PTR_EQUAL(map_get_entity_span(map).begin[0], third);
+  CU_ASSERT_EQUAL(entity_get_hunger(third), 5);
+  CU_ASSERT_EQUAL(entity_get_life_points(third), 20);
+  CU_ASSERT_EQUAL(entity_get_life_points(second), 20);
+  CU_ASSERT_EQUAL(map_get_index_of_handle(map, ENTITY_HANDLE_INVALID), -1);
+
+  map_free(other);
+  map_free(map);
+}
+
+void entity_needs_test(void) {
+  uint32_t   cycle = 3;
+  NeedsRates rates[UINT8_MAX + 1] = {[HUMAN] = {.hunger = 1, .thirst = 1, .tiredness = 1}};
+  Map       *map = map_new(10, 10, 2, "Needs");
+  Entity    *entity = entity_build(10, HUMAN, "Needy", 0, 0);
+
+  // Needs only grow inside of a map with a clock
+  CU_ASSERT_TRUE(map_add_entity(map, entity));
+  cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(entity), 0);
+  map_set_needs_clock(map, (NeedsClock){.cycle = &cycle, .rates = rates});
+  CU_ASSERT_EQUAL(entity_get_hunger(entity), 0);
+
+  // Needs are computed from the cycles
+  cycle += 2;
+  CU_ASSERT_EQUAL(entity_get_hunger(entity), 2);
+  CU_ASSERT_EQUAL(entity_get_thirst(entity), 2);
+
+  entity_set_hunger(entity, 0);
+  entity_increment_thirst(entity);
+  cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(entity), 1);
+  CU_ASSERT_EQUAL(entity_get_thirst(entity), 4);
+  CU_ASSERT_EQUAL(entity_get_tiredness(entity), 3);
+
+  // Changing the rates does not change the past
+  map_settle_needs(map, HUMAN);
+  rates[HUMAN] = (NeedsRates){.hunger = 10, .thirst = 0, .tiredness = 0};
+  cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(entity), 11);
+  CU_ASSERT_EQUAL(entity_get_thirst(entity), 4);
+
+  // They stop growing while dead, and start again from the same values
+  entity_hurt(entity, 10);
+  cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(entity), 11);
+
+  Entity *inhuman = entity_build(10, INHUMAN, "Inhuman", 1, 0);
+  CU_ASSERT_TRUE(map_add_entity(map, inhuman));
+  rates[INHUMAN] = (NeedsRates){.hunger = 1, .thirst = 1, .tiredness = 1};
+  cycle++;
+  entity_hurt(inhuman, 10);
+  cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(inhuman), 1);
+  entity_resurrect(inhuman);
+  cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(inhuman), 2);
+
+  // Another clock starts from the current values
+  uint32_t other_cycle = 0;
+  map_set_needs_clock(map, (NeedsClock){.cycle = &other_cycle, .rates = rates});
+  CU_ASSERT_EQUAL(entity_get_hunger(inhuman), 2);
+  other_cycle++;
+  CU_ASSERT_EQUAL(entity_get_hunger(inhuman), 3);
+
+  map_free(map);
+}
+
 void entity_test_suite() {
   CU_pSuite suite = CU_add_suite("Entity Tests", nullptr, nullptr);
   CU_add_test(suite, "Create a basic entity", &entity_creation_test);
@@ -607,5 +718,7 @@ void entity_test_suite() {
   CU_add_test(suite, "Equipment manipulation", &entity_equipment_test);
   CU_add_test(suite, "Perks manipulation", &entity_perks_test);
   CU_add_test(suite, "Entity Builder", &entity_builder_test);
+  CU_add_test(suite, "Stats view", &entity_stats_view_test);
+  CU_add_test(suite, "Needs", &entity_needs_test);
 }
 
@@ -0,0 +1,150 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "entity.h"
+#include "flow_field.h"
+#include "map.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+void flow_field_distances_test(void) {
+  Map       *map = map_new(30, 30, 0, "Flow");
+  FlowField *field = flow_field_new(map, 10);
+
+  // Nothing to go to
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 5, 5), FLOW_FIELD_UNREACHABLE);
+
+  flow_field_add_goal(field, 5, 5);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 5, 5), 0);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 8, 7), 3);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 15, 5), 10);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 16, 5), FLOW_FIELD_UNREACHABLE);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 50, 5), FLOW_FIELD_UNREACHABLE);
+
+  // Same goals, same tiles
+  flow_field_clear_goals(field);
+  flow_field_add_goal(field, 5, 5);
+  CU_ASSERT_FALSE(flow_field_compute(field));
+
+  // The closest goal wins
+  flow_field_add_goal(field, 20, 5);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 15, 5), 5);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 11, 5), 6);
+
+  // Moving the goal forgets the old distances
+  flow_field_clear_goals(field);
+  flow_field_add_goal(field, 25, 25);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 5, 5), FLOW_FIELD_UNREACHABLE);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 20, 20), 5);
+
+  flow_field_free(field);
+  map_free(map);
+}
+
+void flow_field_window_test(void) {
+  Map       *map = map_new(1000, 1000, 0, "Big flow");
+  FlowField *field = flow_field_new(map, 10);
+
+  // Goals in opposite corners, with the tiles in between out of reach
+  flow_field_add_goal(field, 990, 995);
+  flow_field_add_goal(field, 3, 2);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 999, 999), 9);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 0, 0), 3);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 13, 2), 10);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 14, 2), FLOW_FIELD_UNREACHABLE);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 500, 500), FLOW_FIELD_UNREACHABLE);
+
+  // Tiles too far from the goals do not invalidate the field
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  flow_field_clear_goals(field);
+  flow_field_add_goal(field, 3, 2);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  map_set_tile_properties(map, 500, 500, &wall);
+  CU_ASSERT_FALSE(flow_field_compute(field));
+  map_set_tile_properties(map, 4, 2, &wall);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 4, 2), FLOW_FIELD_UNREACHABLE);
+
+  flow_field_free(field);
+  map_free(map);
+}
+
+void flow_field_walls_test(void) {
+  Map           *map = map_new(20, 20, 0, "Walls");
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  for (uint32_t y = 0; y < 19; y++) {
+    map_set_tile_properties(map, 5, y, &wall);
+  }
+
+  FlowField *field = flow_field_new(map, 100);
+  flow_field_add_goal(field, 10, 0);
+  flow_field_compute(field);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 5, 0), FLOW_FIELD_UNREACHABLE);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 0, 0), 38);
+
+  // Changing a tile invalidates the field
+  map_set_tile_properties(map, 5, 19, &wall);
+  CU_ASSERT_TRUE(flow_field_compute(field));
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, 0, 0), FLOW_FIELD_UNREACHABLE);
+
+  flow_field_free(field);
+  map_free(map);
+}
+
+void flow_field_steps_test(void) {
+  Map       *map = map_new(20, 20, 0, "Steps");
+  FlowField *field = flow_field_new(map, 20);
+  flow_field_add_goal(field, 10, 10);
+  flow_field_compute(field);
+
+  uint32_t next_x;
+  uint32_t next_y;
+  CU_ASSERT_TRUE(flow_field_next_step(field, 0, 10, &next_x, &next_y));
+  CU_ASSERT_EQUAL(next_x, 1);
+  CU_ASSERT_EQUAL(flow_field_get_distance(field, next_x, next_y), 9);
+
+  // Nowhere to go from the goal
+  CU_ASSERT_FALSE(flow_field_next_step(field, 10, 10, &next_x, &next_y));
+
+  // Occupied tiles are avoided, the goal as well
+  map_add_entity(map, entity_build(10, HUMAN, "Target", 10, 10));
+  map_add_entity(map, entity_build(10, INHUMAN, "Blocker", 8, 10));
+  CU_ASSERT_FALSE(flow_field_next_step(field, 9, 10, &next_x, &next_y));
+  CU_ASSERT_TRUE(flow_field_next_step(field, 7, 10, &next_x, &next_y));
+  CU_ASSERT_EQUAL(next_x, 8);
+  CU_ASSERT_NOT_EQUAL(next_y, 10);
+
+  flow_field_free(field);
+  map_free(map);
+}
+
+void flow_field_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("Flow Field Tests", nullptr, nullptr);
+  CU_add_test(suite, "Distances", &flow_field_distances_test);
+  CU_add_test(suite, "Window", &flow_field_window_test);
+  CU_add_test(suite, "Walls", &flow_field_walls_test);
+  CU_add_test(suite, "Steps", &flow_field_steps_test);
+}
@@ -0,0 +1,117 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "entity.h"
+#include "fov.h"
+#include "map.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+void fov_open_map_test(void) {
+  Map *map = map_new(30, 30, 0, "Open map");
+  Fov *fov = fov_new();
+
+  // All the tiles of the disk are visible
+  CU_ASSERT_TRUE(fov_compute(fov, map, 15, 15, 5, FOV_MIN_LIGHT));
+  CU_ASSERT_EQUAL(fov_count_visible(fov), 81);
+  CU_ASSERT_TRUE(fov_is_visible(fov, 15, 15));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 20, 15));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 18, 19));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 19, 19));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 21, 15));
+
+  // Borders of the map
+  CU_ASSERT_TRUE(fov_compute(fov, map, 0, 0, 3, FOV_MIN_LIGHT));
+  CU_ASSERT_EQUAL(fov_count_visible(fov), 11);
+  CU_ASSERT_FALSE(fov_is_visible(fov, 15, 15));
+
+  fov_free(fov);
+  map_free(map);
+}
+
+void fov_occlusion_test(void) {
+  Map *map = map_new(30, 30, 0, "Walls");
+  Fov *fov = fov_new();
+
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  for (uint32_t y = 10; y <= 20; y++) {
+    map_set_tile_properties(map, 17, y, &wall);
+  }
+
+  // Dark tiles are not visible but do not block the sight
+  TileProperties dark = {.kind = GRASS, .base_light = 0, .inside = false, .traversable = true};
+  map_set_tile_properties(map, 14, 15, &dark);
+
+  fov_compute(fov, map, 15, 15, 5, FOV_MIN_LIGHT);
+  CU_ASSERT_TRUE(fov_is_visible(fov, 16, 15));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 17, 15));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 18, 15));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 19, 17));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 14, 15));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 13, 15));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 10, 15));
+
+  // The origin is always visible
+  fov_compute(fov, map, 14, 15, 5, FOV_MIN_LIGHT);
+  CU_ASSERT_TRUE(fov_is_visible(fov, 14, 15));
+
+  fov_free(fov);
+  map_free(map);
+}
+
+void fov_incremental_test(void) {
+  Map *map = map_new(64, 64, 0, "Incremental");
+  Fov *fov = fov_new();
+
+  CU_ASSERT_TRUE(fov_compute(fov, map, 10, 10, 5, FOV_MIN_LIGHT));
+  CU_ASSERT_FALSE(fov_compute(fov, map, 10, 10, 5, FOV_MIN_LIGHT));
+
+  // Tiles out of range do not matter
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  map_set_tile_properties(map, 40, 40, &wall);
+  CU_ASSERT_FALSE(fov_compute(fov, map, 10, 10, 5, FOV_MIN_LIGHT));
+
+  map_set_tile_properties(map, 12, 10, &wall);
+  CU_ASSERT_TRUE(fov_compute(fov, map, 10, 10, 5, FOV_MIN_LIGHT));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 13, 10));
+
+  CU_ASSERT_TRUE(fov_compute(fov, map, 10, 11, 5, FOV_MIN_LIGHT));
+  CU_ASSERT_FALSE(fov_compute(fov, map, 10, 11, 5, FOV_MIN_LIGHT));
+
+  fov_invalidate(fov);
+  CU_ASSERT_TRUE(fov_compute(fov, map, 10, 11, 5, FOV_MIN_LIGHT));
+
+  Entity *entity = entity_build(30, HUMAN, "Watcher", 20, 20);
+  CU_ASSERT_TRUE(fov_compute_for_entity(fov, map, entity));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 20 + entity_get_seeing_distance(entity), 20));
+  CU_ASSERT_FALSE(fov_compute_for_entity(fov, map, entity));
+
+  entity_free(entity);
+  fov_free(fov);
+  map_free(map);
+}
+
+void fov_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("FOV Tests", nullptr, nullptr);
+  CU_add_test(suite, "Open map", &fov_open_map_test);
+  CU_add_test(suite, "Occlusion", &fov_occlusion_test);
+  CU_add_test(suite, "Incremental computation", &fov_incremental_test);
+}
@@ -0,0 +1,106 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "generator.h"
+#include "map.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+// Number of tiles which differ between the two maps, of the same size
+uint32_t generator_count_differences(Map const *first, Map const *second) {
+  MapBoundaries boundaries = map_get_boundaries(first);
+  uint32_t      differences = 0;
+  for (uint32_t x = 0; x < boundaries.x; x++) {
+    for (uint32_t y = 0; y < boundaries.y; y++) {
+      TileView first_tile = map_get_tile(first, x, y);
+      TileView second_tile = map_get_tile(second, x, y);
+      if (first_tile.kind != second_tile.kind || first_tile.base_light != second_tile.base_light ||
+          first_tile.traversable != second_tile.traversable) {
+        differences++;
+      }
+    }
+  }
+
+  return differences;
+}
+
+void generator_determinism_test(void) {
+  Map *single = map_new(300, 200, 0, "Single");
+  Map *multiple = map_new(300, 200, 0, "Multiple");
+  Map *other = map_new(300, 200, 0, "Other");
+
+  generator_fill_map(single, 42, 1);
+  generator_fill_map(multiple, 42, 7);
+  generator_fill_map(other, 43, 3);
+  CU_ASSERT_EQUAL(generator_count_differences(single, multiple), 0);
+  CU_ASSERT_NOT_EQUAL(generator_count_differences(single, other), 0);
+
+  // Generating again gives the same map
+  generator_fill_map(multiple, 42, 0);
+  CU_ASSERT_EQUAL(generator_count_differences(single, multiple), 0);
+
+  map_free(other);
+  map_free(multiple);
+  map_free(single);
+}
+
+void generator_terrain_test(void) {
+  Map *map = map_new(1000, 1000, 0, "Generated");
+  generator_fill_map(map, 1, 0);
+
+  uint32_t counts[UINT8_MAX + 1] = {0};
+  for (uint32_t x = 0; x < 1000; x++) {
+    for (uint32_t y = 0; y < 1000; y++) {
+      TileView tile = map_get_tile(map, x, y);
+      counts[tile.kind]++;
+      CU_ASSERT_EQUAL(tile.traversable, tile.kind != ROCK);
+    }
+  }
+
+  CU_ASSERT_NOT_EQUAL(counts[GRASS], 0);
+  CU_ASSERT_NOT_EQUAL(counts[TALL_GRASS], 0);
+  CU_ASSERT_NOT_EQUAL(counts[FOREST], 0);
+  CU_ASSERT_NOT_EQUAL(counts[GRAVIER], 0);
+  CU_ASSERT_NOT_EQUAL(counts[ROCK], 0);
+  CU_ASSERT_NOT_EQUAL(counts[ROAD], 0);
+  CU_ASSERT_EQUAL(counts[FLOOR], 0);
+
+  // Sizes which are not multiples of the chunks, only the roads depend on
+  // the size of the map
+  Map *small = map_new(GENERATOR_CHUNK_SIZE + 3, 5, 0, "Small");
+  generator_fill_map(small, 1, 2);
+  for (uint32_t x = 0; x < GENERATOR_CHUNK_SIZE + 3; x++) {
+    for (uint32_t y = 0; y < 5; y++) {
+      TileView small_tile = map_get_tile(small, x, y);
+      TileView tile = map_get_tile(map, x, y);
+      CU_ASSERT_TRUE(small_tile.kind == tile.kind || small_tile.kind == ROAD || tile.kind == ROAD);
+    }
+  }
+
+  map_free(small);
+  map_free(map);
+}
+
+void generator_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("Generator Tests", nullptr, nullptr);
+  CU_add_test(suite, "Determinism", &generator_determinism_test);
+  CU_add_test(suite, "Terrain", &generator_terrain_test);
+}
@@ -0,0 +1,179 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "hpa.h"
+#include "map.h"
+#include "path.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+static TileProperties const HPA_WALL = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+
+// Every step must be a move to one of the 8 neighbours, on a traversable tile
+bool hpa_path_is_valid(Map const *map, HpaGraph const *graph, uint32_t from_x, uint32_t from_y) {
+  for (uint32_t i = 0; i < hpa_graph_get_length(graph); i++) {
+    PathStep step = hpa_graph_get_step(graph, i);
+    if (step.x + 1 < from_x || step.x > from_x + 1 || step.y + 1 < from_y || step.y > from_y + 1 ||
+        !map_get_tile(map, step.x, step.y).traversable) {
+      return false;
+    }
+    from_x = step.x;
+    from_y = step.y;
+  }
+
+  return true;
+}
+
+void hpa_open_map_test(void) {
+  Map      *map = map_new(64, 64, 0, "Open map");
+  HpaGraph *graph = hpa_graph_new(map);
+
+  // One entrance between each pair of neighbouring clusters
+  CU_ASSERT_EQUAL(hpa_graph_count_entrances(graph), 24);
+  CU_ASSERT_EQUAL(hpa_graph_count_rebuilt(graph), 16);
+
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 0, 0, 63, 40));
+  CU_ASSERT_EQUAL(hpa_graph_count_rebuilt(graph), 0);
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 0, 0));
+  CU_ASSERT_TRUE(hpa_graph_get_length(graph) >= 63);
+  CU_ASSERT_TRUE(hpa_graph_get_length(graph) <= 63 + 2 * HPA_CLUSTER_SIZE);
+  CU_ASSERT_EQUAL(hpa_graph_get_step(graph, hpa_graph_get_length(graph) - 1).x, 63);
+  CU_ASSERT_EQUAL(hpa_graph_get_step(graph, hpa_graph_get_length(graph) - 1).y, 40);
+
+  // Inside of a single cluster
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 1, 1, 5, 5));
+  CU_ASSERT_EQUAL(hpa_graph_get_length(graph), 4);
+
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 7, 7, 7, 7));
+  CU_ASSERT_EQUAL(hpa_graph_get_length(graph), 0);
+
+  CU_ASSERT_FALSE(hpa_graph_search(graph, 0, 0, 64, 0));
+
+  hpa_graph_free(graph);
+  map_free(map);
+}
+
+void hpa_walls_test(void) {
+  Map *map = map_new(64, 64, 0, "Walls");
+  for (uint32_t y = 0; y < 63; y++) {
+    map_set_tile_properties(map, 20, y, &HPA_WALL);
+  }
+
+  HpaGraph   *graph = hpa_graph_new(map);
+  PathFinder *finder = path_finder_new(map);
+
+  // The only way is through the hole at the bottom of the wall
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 0, 0, 40, 0));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 0, 0));
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 0, 40, 0));
+  CU_ASSERT_TRUE(hpa_graph_get_length(graph) >= path_finder_get_length(finder));
+  CU_ASSERT_TRUE(hpa_graph_get_length(graph) <= path_finder_get_length(finder) + 2 * HPA_CLUSTER_SIZE);
+
+  bool through_hole = false;
+  for (uint32_t i = 0; i < hpa_graph_get_length(graph); i++) {
+    PathStep step = hpa_graph_get_step(graph, i);
+    through_hole |= step.x == 20 && step.y == 63;
+  }
+  CU_ASSERT_TRUE(through_hole);
+
+  // Only the cluster of the modified tile is updated
+  map_set_tile_properties(map, 20, 63, &HPA_WALL);
+  CU_ASSERT_FALSE(hpa_graph_search(graph, 0, 0, 40, 0));
+  CU_ASSERT_EQUAL(hpa_graph_count_rebuilt(graph), 1);
+  CU_ASSERT_FALSE(hpa_graph_search(graph, 0, 0, 20, 5));
+
+  // Both sides are still reachable from themselves
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 0, 0, 19, 63));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 0, 0));
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 63, 63, 21, 0));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 63, 63));
+
+  path_finder_free(finder);
+  hpa_graph_free(graph);
+  map_free(map);
+}
+
+void hpa_diagonal_test(void) {
+  Map *map = map_new(32, 32, 0, "Diagonal");
+
+  // Two walls on both sides of the border between the clusters, with holes
+  // only reachable from each other diagonally
+  for (uint32_t y = 0; y < 32; y++) {
+    if (y != 5) {
+      map_set_tile_properties(map, 15, y, &HPA_WALL);
+    }
+    if (y != 6) {
+      map_set_tile_properties(map, 16, y, &HPA_WALL);
+    }
+  }
+
+  HpaGraph   *graph = hpa_graph_new(map);
+  PathFinder *finder = path_finder_new(map);
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 31, 0));
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 0, 31, 0));
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 0, 0, 31, 0));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 0, 0));
+  CU_ASSERT_TRUE(hpa_graph_get_length(graph) >= path_finder_get_length(finder));
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 31, 31, 0, 31));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 31, 31));
+
+  hpa_graph_free(graph);
+  path_finder_free(finder);
+  map_free(map);
+
+  // The only way between two clusters is a diagonal step across their corner
+  map = map_new(32, 32, 0, "Corner");
+  for (uint32_t i = 0; i < 32; i++) {
+    for (uint32_t line = 15; line <= 16; line++) {
+      if (i != line) {
+        map_set_tile_properties(map, line, i, &HPA_WALL);
+        map_set_tile_properties(map, i, line, &HPA_WALL);
+      }
+    }
+  }
+  map_set_tile_properties(map, 15, 16, &HPA_WALL);
+  map_set_tile_properties(map, 16, 15, &HPA_WALL);
+
+  graph = hpa_graph_new(map);
+  finder = path_finder_new(map);
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 31, 31));
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 0, 31, 31));
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 0, 0, 31, 31));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 0, 0));
+  CU_ASSERT_TRUE(hpa_graph_search(graph, 31, 31, 2, 3));
+  CU_ASSERT_TRUE(hpa_path_is_valid(map, graph, 31, 31));
+  CU_ASSERT_FALSE(hpa_graph_search(graph, 0, 0, 31, 0));
+
+  // Blocking the corner cuts the way
+  map_set_tile_properties(map, 16, 16, &HPA_WALL);
+  CU_ASSERT_FALSE(hpa_graph_search(graph, 0, 0, 31, 31));
+
+  hpa_graph_free(graph);
+  path_finder_free(finder);
+  map_free(map);
+}
+
+void hpa_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("HPA Tests", nullptr, nullptr);
+  CU_add_test(suite, "Open map", &hpa_open_map_test);
+  CU_add_test(suite, "Walls", &hpa_walls_test);
+  CU_add_test(suite, "Diagonal entrances", &hpa_diagonal_test);
+}
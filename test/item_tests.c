@@ -94,9 +94,19 @@ void item_coordinates_test(void) {
   Point const *coords = item_get_coords(without_coords);
   CU_ASSERT_EQUAL(point_get_x(coords), 10);
   CU_ASSERT_EQUAL(point_get_y(coords), 12);
+  CU_ASSERT_TRUE(point_equals(item_get_position(without_coords), point_at(10, 12)));
+
+  // Points allocated through the compatibility layer compare like values
+  Point *same = point_new(10, 12);
+  Point *other = point_new(10, 13);
+  CU_ASSERT_TRUE(points_equal(coords, same));
+  CU_ASSERT_FALSE(points_equal(coords, other));
+  point_free(same);
+  point_free(other);
 
   item_clear_coords(without_coords);
   CU_ASSERT_FALSE(item_has_coords(without_coords));
+  CU_ASSERT_PTR_NULL(item_get_coords(without_coords));
 
   item_free(without_coords);
 }
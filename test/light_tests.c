@@ -0,0 +1,136 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "fov.h"
+#include "light.h"
+#include "map.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+Map *create_dark_map(void) {
+  Map           *map = map_new(40, 40, 0, "Dark map");
+  TileProperties dark = {.kind = GRASS, .base_light = 0, .inside = false, .traversable = true};
+  for (uint32_t x = 0; x < 40; x++) {
+    for (uint32_t y = 0; y < 40; y++) {
+      map_set_tile_properties(map, x, y, &dark);
+    }
+  }
+
+  return map;
+}
+
+void light_sources_test(void) {
+  Map      *map = create_dark_map();
+  LightMap *light_map = light_map_new(map);
+
+  CU_ASSERT_TRUE(light_map_update(light_map));
+  CU_ASSERT_FALSE(light_map_update(light_map));
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 20, 20), 0);
+
+  uint32_t torch = light_map_add_source(light_map, 20, 20, 4, 8);
+  CU_ASSERT_EQUAL(light_map_count_sources(light_map), 1);
+
+  // Nothing changes until the next update
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 20, 20), 0);
+  CU_ASSERT_TRUE(light_map_update(light_map));
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 20, 20), 8);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 24, 20), 2);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 25, 20), 0);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 23, 23), 0);
+  CU_ASSERT_EQUAL(light_map_get_levels(light_map)[20 + 20 * 40], 8);
+  CU_ASSERT_FALSE(light_map_update(light_map));
+
+  light_map_move_source(light_map, torch, 10, 10);
+  CU_ASSERT_TRUE(light_map_update(light_map));
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 20, 20), 0);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 10, 10), 8);
+
+  // Lights add up to the maximum level
+  uint32_t other = light_map_add_source(light_map, 10, 12, 4, 8);
+  light_map_update(light_map);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 10, 11), LIGHT_MAX_LEVEL);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 10, 15), 5);
+
+  light_map_remove_source(light_map, torch);
+  CU_ASSERT_EQUAL(light_map_count_sources(light_map), 1);
+  light_map_update(light_map);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 10, 7), 0);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 10, 12), 8);
+
+  // Sources on the borders of the map
+  light_map_move_source(light_map, other, 0, 39);
+  light_map_update(light_map);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 0, 39), 8);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 10, 12), 0);
+
+  light_map_free(light_map);
+  map_free(map);
+}
+
+void light_base_light_test(void) {
+  Map      *map = create_dark_map();
+  LightMap *light_map = light_map_new(map);
+  light_map_update(light_map);
+
+  TileProperties lit = {.kind = GRASS, .base_light = 5, .inside = false, .traversable = true};
+  map_set_tile_properties(map, 30, 30, &lit);
+  CU_ASSERT_TRUE(light_map_update(light_map));
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 30, 30), 5);
+  CU_ASSERT_EQUAL(light_map_get_level(light_map, 31, 30), 0);
+
+  light_map_free(light_map);
+  map_free(map);
+}
+
+void light_fov_test(void) {
+  Map      *map = create_dark_map();
+  LightMap *light_map = light_map_new(map);
+  Fov      *fov = fov_new();
+
+  // Only the origin can be seen in the dark
+  fov_compute(fov, map, 20, 20, 5, FOV_MIN_LIGHT);
+  CU_ASSERT_EQUAL(fov_count_visible(fov), 1);
+
+  fov_set_light_map(fov, light_map);
+  light_map_add_source(light_map, 20, 20, 4, 8);
+  light_map_update(light_map);
+  CU_ASSERT_TRUE(fov_compute(fov, map, 20, 20, 5, FOV_MIN_LIGHT));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 22, 20));
+  CU_ASSERT_FALSE(fov_is_visible(fov, 25, 20));
+  CU_ASSERT_FALSE(fov_compute(fov, map, 20, 20, 5, FOV_MIN_LIGHT));
+
+  // Moving the light is enough to see again
+  light_map_add_source(light_map, 25, 20, 1, 8);
+  light_map_update(light_map);
+  CU_ASSERT_TRUE(fov_compute(fov, map, 20, 20, 5, FOV_MIN_LIGHT));
+  CU_ASSERT_TRUE(fov_is_visible(fov, 25, 20));
+
+  fov_free(fov);
+  light_map_free(light_map);
+  map_free(map);
+}
+
+void light_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("Light Tests", nullptr, nullptr);
+  CU_add_test(suite, "Sources", &light_sources_test);
+  CU_add_test(suite, "Base light", &light_base_light_test);
+  CU_add_test(suite, "Field of view", &light_fov_test);
+}
@@ -1,5 +1,7 @@
+#include "chunk_store.h"
 #include "item.h"
 #include "map.h"
+#include "path.h"
 #include "point.h"
 #include "serde.h"
 #include "tile.h"
@@ -16,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -47,7 +50,9 @@ void map_entities_test(void) {
   CU_ASSERT_TRUE(strings_equal(name, "e1"));
 
   // This should fail as tile is already occupied
-  map_add_entity(map, entity_build(10, INHUMAN, "e5", 11, 11));
+  Entity *occupied = entity_build(10, INHUMAN, "e5", 11, 11);
+  CU_ASSERT_FALSE(map_add_entity(map, occupied));
+  entity_free(occupied);
 
   CU_ASSERT_EQUAL(map_count_entities(map), 4);
 
@@ -70,10 +75,11 @@ void map_entities_test(void) {
 
   CU_ASSERT_FALSE(map_is_tile_free(map, 10, 12));
 
+  // The last entity takes the place of the removed one
   map_remove_entity(map, "e2");
   CU_ASSERT_FALSE(map_contains_entity(map, "e2"));
-  CU_ASSERT_EQUAL(map_get_index_of_entity(map, "e3"), 1);
-  CU_ASSERT_EQUAL(map_get_index_of_entity(map, "e4"), 2);
+  CU_ASSERT_EQUAL(map_get_index_of_entity(map, "e3"), 2);
+  CU_ASSERT_EQUAL(map_get_index_of_entity(map, "e4"), 1);
 
   CU_ASSERT_TRUE(map_is_tile_free(map, 10, 12));
   CU_ASSERT_EQUAL(map_count_entities(map), 3);
@@ -82,6 +88,13 @@ void map_entities_test(void) {
   map_add_entity(map, entity_build(10, HUMAN, "e5", 10, 12));
   CU_ASSERT_EQUAL(map_count_entities(map), 4);
 
+  // Spans cover exactly the live entities
+  EntitySpan span = map_get_entity_span(map);
+  CU_ASSERT_EQUAL(span.end - span.begin, map_count_entities(map));
+  for (Entity **current = span.begin; current != span.end; current++) {
+    CU_ASSERT_PTR_NOT_NULL(*current);
+  }
+
   ssize_t  nb_results;
   Entity **filtered = map_filter_entities(map, &filter_zombies, &nb_results);
   CU_ASSERT_TRUE(strings_equal(entity_get_name(filtered[0]), "e1"));
@@ -90,6 +103,180 @@ void map_entities_test(void) {
 
   free(filtered);
 
+  // Names are unique inside a map
+  Entity *duplicate = entity_build(10, HUMAN, "e1", 0, 0);
+  map_add_entity(map, duplicate);
+  CU_ASSERT_EQUAL(map_count_entities(map), 4);
+  CU_ASSERT_NOT_EQUAL(map_get_entity(map, "e1"), duplicate);
+  entity_free(duplicate);
+
+  map_free(map);
+}
+
+void map_occupancy_test(void) {
+  Map    *map = map_new(10, 10, 5, "MapName");
+  Entity *zombie = entity_build(30, INHUMAN, "z1", 2, 3);
+  Entity *tree = entity_build(30, TREE, "t1", 3, 3);
+  map_add_entity(map, zombie);
+  map_add_entity(map, tree);
+
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 2, 3), zombie);
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 3, 3), tree);
+  CU_ASSERT_PTR_NULL(map_get_entity_at(map, 4, 3));
+  CU_ASSERT_PTR_NULL(map_get_entity_at(map, 40, 3));
+
+  // Out of the boundaries, this must be refused
+  Entity *outside = entity_build(30, INHUMAN, "outside", 10, 3);
+  CU_ASSERT_FALSE(map_add_entity(map, outside));
+  CU_ASSERT_FALSE(map_contains_entity(map, "outside"));
+  entity_free(outside);
+
+  // Occupied tile
+  CU_ASSERT_FALSE(map_move_entity(map, zombie, 1, 0));
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 2, 3), zombie);
+
+  // Trees cannot move
+  CU_ASSERT_FALSE(map_move_entity(map, tree, 0, 1));
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 3, 3), tree);
+
+  CU_ASSERT_TRUE(map_move_entity(map, zombie, 0, 1));
+  CU_ASSERT_TRUE(map_is_tile_free(map, 2, 3));
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 2, 4), zombie);
+  CU_ASSERT_TRUE(point_has_coords(entity_get_coords(zombie), 2, 4));
+
+  // Out of bounds
+  CU_ASSERT_FALSE(map_move_entity(map, zombie, -3, 0));
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 2, 4), zombie);
+
+  map_remove_entity(map, "z1");
+  CU_ASSERT_TRUE(map_is_tile_free(map, 2, 4));
+
+  map_free(map);
+}
+
+void map_entity_handles_test(void) {
+  Map *map = map_new(20, 20, 3, "MapName");
+  map_add_entity(map, entity_build(30, INHUMAN, "z1", 1, 1));
+  map_add_entity(map, entity_build(30, HUMAN, "h1", 2, 2));
+  map_add_entity(map, entity_build(30, ANIMAL, "a1", 3, 3));
+
+  EntityHandle zombie = map_get_entity_handle(map, "z1");
+  EntityHandle human = map_get_entity_handle(map, "h1");
+  EntityHandle animal = map_get_entity_handle(map, "a1");
+  CU_ASSERT_TRUE(map_is_entity_handle_valid(map, zombie));
+  CU_ASSERT_FALSE(map_is_entity_handle_valid(map, map_get_entity_handle(map, "missing")));
+  CU_ASSERT_FALSE(map_is_entity_handle_valid(map, ENTITY_HANDLE_INVALID));
+  CU_ASSERT_TRUE(strings_equal(entity_get_name(map_get_entity_by_handle(map, human)), "h1"));
+
+  // Handles survive the reordering of the entities
+  CU_ASSERT_TRUE(map_remove_entity_by_handle(map, zombie));
+  CU_ASSERT_FALSE(map_remove_entity_by_handle(map, zombie));
+  CU_ASSERT_PTR_NULL(map_get_entity_by_handle(map, zombie));
+  CU_ASSERT_EQUAL(map_count_entities(map), 2);
+  CU_ASSERT_TRUE(strings_equal(entity_get_name(map_get_entity_by_handle(map, animal)), "a1"));
+  CU_ASSERT_TRUE(strings_equal(entity_get_name(map_get_entity_by_handle(map, human)), "h1"));
+  CU_ASSERT_TRUE(map_is_tile_free(map, 1, 1));
+
+  // The slot is reused, but the old handle stays invalid
+  map_add_entity(map, entity_build(30, INHUMAN, "z2", 1, 1));
+  EntityHandle other_zombie = map_get_entity_handle(map, "z2");
+  CU_ASSERT_EQUAL(other_zombie.index, zombie.index);
+  CU_ASSERT_PTR_NULL(map_get_entity_by_handle(map, zombie));
+  CU_ASSERT_TRUE(strings_equal(entity_get_name(map_get_entity_by_handle(map, other_zombie)), "z2"));
+
+  map_remove_entity(map, "h1");
+  CU_ASSERT_FALSE(map_is_entity_handle_valid(map, human));
+  CU_ASSERT_TRUE(map_contains_entity(map, "a1"));
+  CU_ASSERT_TRUE(map_contains_entity(map, "z2"));
+
+  map_free(map);
+}
+
+void map_entities_growth_test(void) {
+  Map *map = map_new(100, 100, 0, "Growing map");
+  CU_ASSERT_EQUAL(map_get_entities_capacity(map), 0);
+
+  char name[16];
+  for (uint32_t i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "z%d", i);
+    CU_ASSERT_TRUE(map_add_entity(map, entity_build(10, INHUMAN, name, i % 100, i / 100)));
+  }
+
+  CU_ASSERT_EQUAL(map_count_entities(map), 1000);
+  CU_ASSERT_TRUE(map_get_entities_capacity(map) >= 1000);
+  CU_ASSERT_PTR_EQUAL(map_get_entity_at(map, 42, 7), map_get_entity(map, "z742"));
+
+  // Failures are reported, the entity still belongs to the caller
+  Entity *rejected = entity_build(10, INHUMAN, "rejected", 42, 7);
+  CU_ASSERT_FALSE(map_add_entity(map, rejected));
+  CU_ASSERT_FALSE(map_contains_entity(map, "rejected"));
+  entity_free(rejected);
+
+  // Reserving never shrinks the table
+  map_reserve_entities(map, 10);
+  CU_ASSERT_TRUE(map_get_entities_capacity(map) >= 1000);
+  map_reserve_entities(map, 5000);
+  CU_ASSERT_EQUAL(map_get_entities_capacity(map), 5000);
+  CU_ASSERT_EQUAL(map_count_entities(map), 1000);
+
+  map_free(map);
+}
+
+void map_entities_waves_test(void) {
+  char name[16];
+  Map *map = map_new(100, 100, 0, "First wave");
+  for (uint32_t i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "z%d", i);
+    map_add_entity(map, entity_build(10, INHUMAN, name, i % 100, i / 100));
+  }
+
+  Entity  *last = map_get_entity(map, "z999");
+  uint32_t capacity = entity_get_pool_capacity();
+  CU_ASSERT_TRUE(capacity >= 1000);
+  map_free(map);
+
+  // Despawned entities leave their memory to the next wave
+  CU_ASSERT_EQUAL(entity_get_pool_capacity(), capacity);
+
+  map = map_new(100, 100, 0, "Second wave");
+  for (uint32_t i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "z%d", i);
+    map_add_entity(map, entity_build(10, INHUMAN, name, i % 100, i / 100));
+  }
+
+  CU_ASSERT_EQUAL(map_count_entities(map), 1000);
+  CU_ASSERT_EQUAL(entity_get_pool_capacity(), capacity);
+  CU_ASSERT_PTR_EQUAL(map_get_entity(map, "z0"), last);
+
+  map_free(map);
+}
+
+void map_area_queries_test(void) {
+  Map     *map = map_new(100, 100, 10, "MapName");
+  Entity  *found[10];
+  Entity  *zombie = entity_build(30, INHUMAN, "z1", 50, 50);
+  Entity  *human = entity_build(30, HUMAN, "h1", 53, 54);
+  Entity  *tree = entity_build(30, TREE, "t1", 80, 50);
+  map_add_entity(map, zombie);
+  map_add_entity(map, human);
+  map_add_entity(map, tree);
+
+  CU_ASSERT_EQUAL(map_get_entities_in_radius(map, 50, 50, 5, found, 10), 2);
+  CU_ASSERT_EQUAL(map_get_entities_in_radius(map, 50, 50, 4, found, 10), 1);
+  CU_ASSERT_PTR_EQUAL(found[0], zombie);
+  CU_ASSERT_EQUAL(map_get_entities_in_rect(map, 0, 0, 99, 99, found, 10), 3);
+  CU_ASSERT_EQUAL(map_get_entities_in_rect(map, 51, 0, 99, 54, found, 10), 2);
+
+  // The index follows the entities when they move
+  CU_ASSERT_TRUE(map_move_entity(map, zombie, -1, -1));
+  CU_ASSERT_EQUAL(map_get_entities_in_radius(map, 50, 50, 1, found, 10), 0);
+  CU_ASSERT_EQUAL(map_get_entities_in_radius(map, 50, 50, 2, found, 10), 1);
+  CU_ASSERT_EQUAL(map_get_entities_in_radius(map, 53, 54, 5, found, 10), 1);
+  CU_ASSERT_PTR_EQUAL(found[0], human);
+
+  map_remove_entity(map, "t1");
+  CU_ASSERT_EQUAL(map_get_entities_in_rect(map, 0, 0, 99, 99, found, 10), 2);
+
   map_free(map);
 }
 
@@ -118,6 +305,48 @@ void map_items_test(void) {
   CU_ASSERT_PTR_NULL(map_get_item(map, "A tool"));
   CU_ASSERT_PTR_NOT_NULL(map_get_item(map, "An armor"));
 
+  // Names are unique, the caller keeps the rejected item
+  Item *duplicate = armor_new("An armor", 30, 10, 15, 4, 4);
+  CU_ASSERT_FALSE(map_add_item(map, duplicate, 5, 5));
+  CU_ASSERT_EQUAL(map_count_items(map), 2);
+  item_free(duplicate);
+
+  map_free(map);
+}
+
+void map_items_index_test(void) {
+  Map *map = map_new(100, 100, 0, "MapName");
+
+  char name[32];
+  for (uint32_t i = 0; i < 50; i++) {
+    sprintf(name, "Item %u", i);
+    CU_ASSERT_TRUE(map_add_item(map, armor_new(name, 30, 10, 15, 4, 4), i, i % 5));
+  }
+  CU_ASSERT_EQUAL(map_count_items(map), 50);
+
+  // The last item takes the place of the removed one and stays reachable
+  map_remove_item(map, "Item 3");
+  CU_ASSERT_FALSE(map_contains_item(map, "Item 3"));
+  CU_ASSERT_PTR_NOT_NULL(map_get_item(map, "Item 49"));
+  CU_ASSERT_EQUAL(point_get_x(item_get_coords(map_get_item(map, "Item 49"))), 49);
+  CU_ASSERT_EQUAL(map_count_items(map), 49);
+
+  Item *found[8];
+  CU_ASSERT_EQUAL(map_get_items_at(map, 3, 3, found, 8), 0);
+  CU_ASSERT_EQUAL(map_get_items_at(map, 12, 2, found, 8), 1);
+  CU_ASSERT_TRUE(strings_equal(item_get_name(found[0]), "Item 12"));
+
+  // Items 0, 1, 2 and 4
+  CU_ASSERT_EQUAL(map_get_items_in_radius(map, 2, 2, 3, found, 8), 4);
+
+  // Dropping an item on an occupied tile stacks it
+  CU_ASSERT_TRUE(map_add_item(map, tool_new("A tool", 30, 10, 2, 10), 12, 2));
+  CU_ASSERT_EQUAL(map_get_items_at(map, 12, 2, found, 8), 2);
+
+  map_remove_item(map, "Item 12");
+  CU_ASSERT_EQUAL(map_get_items_at(map, 12, 2, found, 8), 1);
+  CU_ASSERT_PTR_EQUAL(found[0], map_get_item(map, "A tool"));
+
   map_free(map);
 }
 
@@ -228,8 +457,9 @@ void map_serialization_test() {
   serde_map_assert(msgmap, MSGPACK_OBJECT_ARRAY, "items");
   CU_ASSERT_EQUAL(((msgpack_object_array *)serde_map_get(msgmap, MSGPACK_OBJECT_ARRAY, "items"))->size, 4);
 
-  serde_map_assert(msgmap, MSGPACK_OBJECT_ARRAY, "tiles");
-  CU_ASSERT_EQUAL(((msgpack_object_array *)serde_map_get(msgmap, MSGPACK_OBJECT_ARRAY, "tiles"))->size, 42 * 23);
+  // Only the chunks which have been modified are serialized
+  serde_map_assert(msgmap, MSGPACK_OBJECT_ARRAY, "chunks");
+  CU_ASSERT_EQUAL(((msgpack_object_array *)serde_map_get(msgmap, MSGPACK_OBJECT_ARRAY, "chunks"))->size, 1);
 
   free(buffer);
   msgpack_sbuffer_destroy(&sbuffer);
@@ -275,12 +505,15 @@ void map_deserialize_test(void) {
   CU_ASSERT_TRUE(strings_equal(map_get_name(map), map_get_name(deserialized)));
 
   // A bunch of tiles inside
-  CU_ASSERT_TRUE(tile_is_inside(map_get_tile(deserialized, 11, 2)));
-  CU_ASSERT_TRUE(tile_is_inside(map_get_tile(deserialized, 12, 4)));
-  CU_ASSERT_EQUAL(tile_get_tile_kind(map_get_tile(deserialized, 11, 3)), TALL_GRASS);
+  CU_ASSERT_TRUE(map_get_tile(deserialized, 11, 2).inside);
+  CU_ASSERT_TRUE(map_get_tile(deserialized, 12, 4).inside);
+  CU_ASSERT_EQUAL(map_get_tile(deserialized, 11, 3).kind, TALL_GRASS);
+  CU_ASSERT_EQUAL(map_get_tile(deserialized, 11, 3).base_light, 1);
 
   // All the rest of the tiles should be outside
-  CU_ASSERT_FALSE(tile_is_inside(map_get_tile(deserialized, 0, 0)));
+  CU_ASSERT_FALSE(map_get_tile(deserialized, 0, 0).inside);
+  CU_ASSERT_EQUAL(map_get_tile(deserialized, 0, 0).kind, GRASS);
+  CU_ASSERT_EQUAL(map_get_tile(deserialized, 0, 0).base_light, 10);
 
   msgpack_unpacked_destroy(&result);
   msgpack_unpacker_destroy(&unpacker);
@@ -288,11 +521,142 @@ void map_deserialize_test(void) {
   map_free(map);
 }
 
-#define MAP_ASSERT_TILE(map, x, y)                                 \
-  {                                                                \
-    Tile const *tile = map_get_tile(map, x, y);                    \
-    CU_ASSERT_PTR_NOT_NULL(tile);                                  \
-    CU_ASSERT_TRUE(point_has_coords(tile_get_coords(tile), x, y)); \
+// Maps used to be saved with all of their tiles, items lying on them included
+void map_deserialize_tiles_test(void) {
+  msgpack_sbuffer sbuffer;
+  msgpack_packer  packer;
+  msgpack_sbuffer_init(&sbuffer);
+  msgpack_packer_init(&packer, &sbuffer, &msgpack_sbuffer_write);
+
+  msgpack_pack_map(&packer, 8);
+  serde_pack_str(&packer, "x_size");
+  msgpack_pack_uint32(&packer, 2);
+  serde_pack_str(&packer, "y_size");
+  msgpack_pack_uint32(&packer, 2);
+  serde_pack_str(&packer, "name");
+  serde_pack_str(&packer, "Old map");
+  serde_pack_str(&packer, "max_entities");
+  msgpack_pack_uint32(&packer, 1);
+  serde_pack_str(&packer, "last_index");
+  msgpack_pack_uint32(&packer, 0);
+  serde_pack_str(&packer, "entities");
+  msgpack_pack_array(&packer, 0);
+  serde_pack_str(&packer, "items");
+  msgpack_pack_array(&packer, 0);
+
+  serde_pack_str(&packer, "tiles");
+  msgpack_pack_array(&packer, 4);
+  for (uint32_t x = 0; x < 2; x++) {
+    for (uint32_t y = 0; y < 2; y++) {
+      msgpack_pack_map(&packer, 7);
+      serde_pack_str(&packer, "kind");
+      msgpack_pack_uint8(&packer, ROCK);
+      serde_pack_str(&packer, "base_noise");
+      msgpack_pack_uint32(&packer, 300);
+      serde_pack_str(&packer, "base_light");
+      msgpack_pack_uint32(&packer, x == 0 ? 256 : 4);
+      serde_pack_str(&packer, "inside");
+      msgpack_pack_uint8(&packer, true);
+      serde_pack_str(&packer, "traversable");
+      msgpack_pack_uint8(&packer, y == 0);
+
+      serde_pack_str(&packer, "items");
+      msgpack_pack_array(&packer, x == 1 && y == 0 ? 2 : 0);
+      if (x == 1 && y == 0) {
+        Item *pickaxe = tool_new("Pickaxe", 10, 3, 2, 15);
+        Item *shovel = tool_new("Shovel", 10, 3, 2, 15);
+        item_serialize(pickaxe, &sbuffer);
+        item_serialize(shovel, &sbuffer);
+        item_free(pickaxe);
+        item_free(shovel);
+      }
+
+      serde_pack_str(&packer, "coords");
+      msgpack_pack_array(&packer, 2);
+      msgpack_pack_uint32(&packer, x);
+      msgpack_pack_uint32(&packer, y);
+    }
+  }
+
+  msgpack_unpacked result;
+  size_t           offset = 0;
+  msgpack_unpacked_init(&result);
+  CU_ASSERT_EQUAL(msgpack_unpack_next(&result, sbuffer.data, sbuffer.size, &offset), MSGPACK_UNPACK_SUCCESS);
+  Map *map = map_deserialize(&result.data.via.map);
+
+  TileView tile = map_get_tile(map, 1, 0);
+  CU_ASSERT_EQUAL(tile.kind, ROCK);
+  CU_ASSERT_EQUAL(tile.base_noise, UINT8_MAX);
+  CU_ASSERT_EQUAL(tile.base_light, 4);
+  CU_ASSERT_TRUE(tile.inside);
+  CU_ASSERT_TRUE(tile.traversable);
+  CU_ASSERT_FALSE(map_get_tile(map, 1, 1).traversable);
+
+  // Lights out of range are ignored like tile_set_base_light() does
+  CU_ASSERT_EQUAL(map_get_tile(map, 0, 0).base_light, 10);
+
+  // The items of the tiles now belong to the map
+  Item *found[4];
+  CU_ASSERT_EQUAL(map_count_items(map), 2);
+  CU_ASSERT_EQUAL(map_get_items_at(map, 1, 0, found, 4), 2);
+  CU_ASSERT_EQUAL(map_get_items_at(map, 0, 0, found, 4), 0);
+  CU_ASSERT_TRUE(map_contains_item(map, "Pickaxe"));
+  CU_ASSERT_TRUE(map_contains_item(map, "Shovel"));
+  CU_ASSERT_EQUAL(item_get_position(map_get_item(map, "Shovel")).x, 1);
+
+  msgpack_unpacked_destroy(&result);
+  msgpack_sbuffer_destroy(&sbuffer);
+  map_free(map);
+}
+
+void map_deserialize_planes_test(void) {
+  Map           *map = map_new(40, 40, 0, "MapName");
+  TileProperties wall = {.kind = FLOOR, .base_light = 0, .inside = true, .traversable = false};
+  map_fill_tiles(map, 20, 0, 20, 39, &wall);
+
+  msgpack_sbuffer sbuffer;
+  msgpack_sbuffer_init(&sbuffer);
+  map_serialize(map, &sbuffer);
+
+  msgpack_unpacked result;
+  size_t           offset = 0;
+  msgpack_unpacked_init(&result);
+  CU_ASSERT_EQUAL(msgpack_unpack_next(&result, sbuffer.data, sbuffer.size, &offset), MSGPACK_UNPACK_SUCCESS);
+  Map *deserialized = map_deserialize(&result.data.via.map);
+
+  // The planes follow the deserialized tiles
+  CU_ASSERT_FALSE(map_test_plane(deserialized, MAP_PLANE_TRAVERSABLE, 20, 5));
+  CU_ASSERT_TRUE(map_test_plane(deserialized, MAP_PLANE_INSIDE, 20, 5));
+  CU_ASSERT_FALSE(map_test_plane(deserialized, MAP_PLANE_LIT, 20, 5));
+  CU_ASSERT_TRUE(map_test_plane(deserialized, MAP_PLANE_TRAVERSABLE, 19, 5));
+  CU_ASSERT_FALSE(map_test_plane(deserialized, MAP_PLANE_INSIDE, 19, 5));
+  CU_ASSERT_EQUAL(map_count_in_plane(deserialized, MAP_PLANE_TRAVERSABLE, 0, 0, 39, 39), 40 * 39);
+
+  // Which means that the wall cannot be walked through
+  PathFinder *finder = path_finder_new(deserialized);
+  CU_ASSERT_FALSE(map_same_region(deserialized, 0, 5, 30, 5));
+  CU_ASSERT_FALSE(path_finder_search(finder, 0, 5, 30, 5));
+
+  TileProperties gap = {.kind = FLOOR, .base_light = 0, .inside = true, .traversable = true};
+  map_set_tile_properties(deserialized, 20, 39, &gap);
+  CU_ASSERT_TRUE(map_same_region(deserialized, 0, 5, 30, 5));
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 5, 30, 5));
+  CU_ASSERT_TRUE(path_finder_get_length(finder) > 30);
+
+  path_finder_free(finder);
+  msgpack_unpacked_destroy(&result);
+  msgpack_sbuffer_destroy(&sbuffer);
+  map_free(deserialized);
+  map_free(map);
+}
+
+#define MAP_ASSERT_TILE(map, tx, ty)          \
+  {                                           \
+    TileView tile = map_get_tile(map, tx, ty); \
+    CU_ASSERT_TRUE(tile.valid);               \
+    CU_ASSERT_EQUAL(tile.x, tx);              \
+    CU_ASSERT_EQUAL(tile.y, ty);              \
+    CU_ASSERT_EQUAL(tile.kind, GRASS);        \
   }
 
 void map_tile_test(void) {
@@ -306,10 +670,10 @@ void map_tile_test(void) {
   MAP_ASSERT_TILE(map, 6, 0);
 
   // Out of range test
-  CU_ASSERT_PTR_NULL(map_get_tile(map, 19, 16));
-  CU_ASSERT_PTR_NULL(map_get_tile(map, 0, 16));
-  CU_ASSERT_PTR_NULL(map_get_tile(map, 19, 0));
-  CU_ASSERT_PTR_NULL(map_get_tile(map, 26, 65));
+  CU_ASSERT_FALSE(map_get_tile(map, 19, 16).valid);
+  CU_ASSERT_FALSE(map_get_tile(map, 0, 16).valid);
+  CU_ASSERT_FALSE(map_get_tile(map, 19, 0).valid);
+  CU_ASSERT_FALSE(map_get_tile(map, 26, 65).valid);
 
   // Tiles modification
   TileProperties props;
@@ -319,10 +683,359 @@ void map_tile_test(void) {
   props.traversable = true;
 
   map_set_tile_properties(map, 1, 2, &props);
-  Tile const *modified = map_get_tile(map, 1, 2);
-  CU_ASSERT_EQUAL(tile_get_base_light(modified), 1);
-  CU_ASSERT_TRUE(tile_is_traversable(modified));
-  CU_ASSERT_FALSE(tile_is_inside(modified));
+  TileView modified = map_get_tile(map, 1, 2);
+  CU_ASSERT_EQUAL(modified.base_light, 1);
+  CU_ASSERT_EQUAL(modified.base_noise, 3);
+  CU_ASSERT_TRUE(modified.traversable);
+  CU_ASSERT_FALSE(modified.inside);
+
+  // Light cannot go above 10
+  props.base_light = 11;
+  props.kind = ROAD;
+  props.traversable = false;
+  map_set_tile_properties(map, 1, 2, &props);
+  modified = map_get_tile(map, 1, 2);
+  CU_ASSERT_EQUAL(modified.base_light, 1);
+  CU_ASSERT_EQUAL(modified.kind, ROAD);
+  CU_ASSERT_FALSE(modified.traversable);
+
+  // Neighbours are left untouched
+  CU_ASSERT_EQUAL(map_get_tile(map, 1, 3).kind, GRASS);
+  CU_ASSERT_TRUE(map_get_tile(map, 1, 3).traversable);
+
+  map_free(map);
+}
+
+void map_sparse_tiles_test(void) {
+  Map *map = map_new(1000, 1000, 20, "Huge map");
+
+  // Nothing has been modified yet, all the tiles are shared
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 0);
+  CU_ASSERT_EQUAL(map_get_tile(map, 999, 999).kind, GRASS);
+  CU_ASSERT_EQUAL(map_get_tile(map, 999, 999).base_light, 10);
+
+  // Writing the default values does not allocate anything
+  TileProperties props = {.kind = GRASS, .base_light = 10, .inside = false, .traversable = true};
+  map_set_tile_properties(map, 500, 500, &props);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 0);
+
+  props.kind = ROAD;
+  map_set_tile_properties(map, 500, 500, &props);
+  map_set_tile_properties(map, 501, 500, &props);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 1);
+  CU_ASSERT_EQUAL(map_get_tile(map, 501, 500).kind, ROAD);
+  CU_ASSERT_EQUAL(map_get_tile(map, 502, 500).kind, GRASS);
+
+  map_set_tile_properties(map, 0, 999, &props);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 2);
+  CU_ASSERT_EQUAL(map_get_tile(map, 0, 999).kind, ROAD);
+  CU_ASSERT_EQUAL(map_get_tile(map, 0, 998).kind, GRASS);
+
+  map_free(map);
+}
+
+void map_chunk_store_test(void) {
+  ChunkStore *store = chunk_store_new("chunk_store_test");
+  CU_ASSERT_PTR_NOT_NULL(store);
+  CU_ASSERT_EQUAL(chunk_store_count(store), 0);
+  CU_ASSERT_FALSE(chunk_store_contains(store, 42));
+
+  size_t size = 0;
+  CU_ASSERT_PTR_NULL(chunk_store_read(store, 42, &size));
+
+  CU_ASSERT_TRUE(chunk_store_write(store, 42, "some data", 9));
+  CU_ASSERT_TRUE(chunk_store_write(store, 42, "other data", 10));
+  CU_ASSERT_TRUE(chunk_store_write(store, 3, "chunk 3", 7));
+  CU_ASSERT_EQUAL(chunk_store_count(store), 2);
+  CU_ASSERT_TRUE(chunk_store_contains(store, 42));
+
+  char *data = chunk_store_read(store, 42, &size);
+  CU_ASSERT_EQUAL(size, 10);
+  CU_ASSERT_EQUAL(memcmp(data, "other data", 10), 0);
+  free(data);
+
+  chunk_store_remove(store, 42);
+  CU_ASSERT_FALSE(chunk_store_contains(store, 42));
+  CU_ASSERT_EQUAL(chunk_store_count(store), 1);
+
+  // Everything is cleaned up when the store is freed
+  chunk_store_free(store);
+  CU_ASSERT_NOT_EQUAL(access("chunk_store_test", F_OK), 0);
+}
+
+void map_chunk_store_foreign_files_test(void) {
+  // Files which were already in the directory do not belong to the store
+  mkdir("chunk_store_foreign_test", 0755);
+  FILE *foreign = fopen("chunk_store_foreign_test/chunk-7.bin", "wb");
+  fputs("not ours", foreign);
+  fclose(foreign);
+
+  ChunkStore *store = chunk_store_new("chunk_store_foreign_test");
+  CU_ASSERT_PTR_NOT_NULL(store);
+  CU_ASSERT_FALSE(chunk_store_contains(store, 7));
+  CU_ASSERT_EQUAL(chunk_store_count(store), 0);
+
+  size_t size = 0;
+  CU_ASSERT_PTR_NULL(chunk_store_read(store, 7, &size));
+  chunk_store_remove(store, 7);
+  CU_ASSERT_EQUAL(access("chunk_store_foreign_test/chunk-7.bin", F_OK), 0);
+
+  CU_ASSERT_TRUE(chunk_store_write(store, 3, "chunk 3", 7));
+  CU_ASSERT_TRUE(chunk_store_write(store, 200, "chunk 200", 9));
+  CU_ASSERT_EQUAL(chunk_store_count(store), 2);
+
+  // Only the chunks written by the store are removed with it
+  chunk_store_free(store);
+  CU_ASSERT_NOT_EQUAL(access("chunk_store_foreign_test/chunk-3.bin", F_OK), 0);
+  CU_ASSERT_NOT_EQUAL(access("chunk_store_foreign_test/chunk-200.bin", F_OK), 0);
+  CU_ASSERT_EQUAL(access("chunk_store_foreign_test/chunk-7.bin", F_OK), 0);
+
+  unlink("chunk_store_foreign_test/chunk-7.bin");
+  rmdir("chunk_store_foreign_test");
+}
+
+void map_streaming_test(void) {
+  Map           *map = map_new(256, 256, 20, "Streamed map");
+  TileProperties props = {.kind = ROAD, .base_light = 2, .inside = true, .traversable = true};
+
+  // One modified tile in 10 different chunks
+  for (uint32_t i = 0; i < 10; i++) {
+    map_set_tile_properties(map, i * 16, i * 16, &props);
+  }
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 10);
+
+  // Without any budget, everything gets evicted
+  map_set_chunk_store(map, chunk_store_new("map_streaming_test"), 0);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 0);
+
+  // Chunks are loaded back on demand
+  CU_ASSERT_EQUAL(map_get_tile(map, 32, 32).kind, ROAD);
+  CU_ASSERT_EQUAL(map_get_tile(map, 32, 32).base_light, 2);
+  CU_ASSERT_EQUAL(map_get_tile(map, 33, 32).kind, GRASS);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 1);
+
+  // Reads do not go over the budget, they evict what they do not need anymore
+  for (uint32_t i = 0; i < 10; i++) {
+    CU_ASSERT_EQUAL(map_get_tile(map, i * 16, i * 16).kind, ROAD);
+    CU_ASSERT_EQUAL(map_count_tile_chunks(map), 1);
+  }
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 255, 255));
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 1);
+
+  // Streaming only keeps what is around the given position
+  map_stream_around(map, 144, 144, 0);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 1);
+  map_stream_around(map, 144, 144, 8);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 2);
+
+  // Modified chunks are written back to the store before being evicted
+  props.kind = GRAVIER;
+  map_set_tile_properties(map, 144, 145, &props);
+  map_stream_around(map, 0, 0, 0);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 1);
+  CU_ASSERT_EQUAL(map_get_tile(map, 144, 145).kind, GRAVIER);
+  CU_ASSERT_EQUAL(map_get_tile(map, 144, 144).kind, ROAD);
+
+  // Evicted chunks are part of the serialized map as well
+  msgpack_sbuffer sbuffer;
+  msgpack_sbuffer_init(&sbuffer);
+  map_serialize(map, &sbuffer);
+
+  msgpack_unpacked result;
+  size_t           offset = 0;
+  msgpack_unpacked_init(&result);
+  CU_ASSERT_EQUAL(msgpack_unpack_next(&result, sbuffer.data, sbuffer.size, &offset), MSGPACK_UNPACK_SUCCESS);
+
+  Map *deserialized = map_deserialize(&result.data.via.map);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(deserialized), 10);
+  for (uint32_t i = 0; i < 10; i++) {
+    CU_ASSERT_EQUAL(map_get_tile(deserialized, i * 16, i * 16).kind, ROAD);
+    CU_ASSERT_TRUE(map_get_tile(deserialized, i * 16, i * 16).inside);
+  }
+  CU_ASSERT_EQUAL(map_get_tile(deserialized, 144, 145).kind, GRAVIER);
+
+  // A big enough budget keeps everything in memory
+  map_set_chunk_store(deserialized, chunk_store_new("map_streaming_test_deserialized"), 1 << 20);
+  map_stream_around(deserialized, 0, 0, 0);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(deserialized), 10);
+
+  msgpack_unpacked_destroy(&result);
+  msgpack_sbuffer_destroy(&sbuffer);
+  map_free(deserialized);
+  map_free(map);
+
+  CU_ASSERT_NOT_EQUAL(access("map_streaming_test", F_OK), 0);
+}
+
+void map_regions_test(void) {
+  Map *map = map_new(40, 40, 0, "MapName");
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 39, 39));
+  CU_ASSERT_FALSE(map_same_region(map, 0, 0, 40, 39));
+
+  // A wall splitting the map in two
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  for (uint32_t y = 0; y < 40; y++) {
+    map_set_tile_properties(map, 20, y, &wall);
+  }
+  CU_ASSERT_FALSE(map_same_region(map, 0, 0, 39, 39));
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 19, 39));
+  CU_ASSERT_FALSE(map_same_region(map, 0, 0, 20, 0));
+
+  // Diagonal holes are enough
+  TileProperties floor = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = true};
+  map_set_tile_properties(map, 20, 10, &floor);
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 39, 39));
+  CU_ASSERT_TRUE(map_same_region(map, 19, 9, 21, 11));
+
+  map_set_tile_properties(map, 20, 10, &wall);
+  CU_ASSERT_FALSE(map_same_region(map, 0, 0, 39, 39));
+
+  // Entities do not matter
+  map_add_entity(map, entity_build(10, HUMAN, "E1", 5, 5));
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 5, 5));
+
+  map_free(map);
+
+  // Regions updated tile by tile agree with the path finder
+  map = map_new(24, 24, 0, "MapName");
+  PathFinder *finder = path_finder_new(map);
+  srand(42);
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 23, 23));
+  for (uint32_t i = 0; i < 400; i++) {
+    uint32_t x = rand() % 24;
+    uint32_t y = rand() % 24;
+    map_set_tile_properties(map, x, y, map_get_tile(map, x, y).traversable ? &wall : &floor);
+
+    uint32_t from_x = rand() % 24;
+    uint32_t from_y = rand() % 24;
+    uint32_t to_x = rand() % 24;
+    uint32_t to_y = rand() % 24;
+    bool     reachable = map_get_tile(map, from_x, from_y).traversable && path_finder_search(finder, from_x, from_y, to_x, to_y);
+    CU_ASSERT_EQUAL(map_same_region(map, from_x, from_y, to_x, to_y), reachable);
+  }
+
+  path_finder_free(finder);
+  map_free(map);
+}
+
+void map_bulk_tiles_test(void) {
+  Map *map = map_new(40, 40, 0, "MapName");
+
+  TileProperties wall = {.kind = ROAD, .base_light = 4, .inside = false, .traversable = false};
+  map_fill_tiles(map, 10, 0, 12, 39, &wall);
+  CU_ASSERT_EQUAL(map_count_tile_changes(map), 1);
+  CU_ASSERT_EQUAL(map_get_tile(map, 10, 0).kind, ROAD);
+  CU_ASSERT_EQUAL(map_get_tile(map, 12, 39).base_light, 4);
+  CU_ASSERT_FALSE(map_get_tile(map, 11, 20).traversable);
+  CU_ASSERT_TRUE(map_get_tile(map, 13, 20).traversable);
+  CU_ASSERT_FALSE(map_same_region(map, 0, 0, 39, 39));
+
+  // Nothing changes, no chunk is materialized
+  uint64_t       revision = map_get_tiles_revision(map, 0, 0, 39, 39);
+  TileProperties grass = {.kind = GRASS, .base_light = 10, .inside = false, .traversable = true};
+  map_fill_tiles(map, 20, 20, 39, 39, &grass);
+  map_fill_tiles(map, 10, 0, 12, 39, &wall);
+  CU_ASSERT_EQUAL(map_get_tiles_revision(map, 0, 0, 39, 39), revision);
+  CU_ASSERT_EQUAL(map_count_tile_chunks(map), 3);
+
+  // Invalid light levels keep the current ones
+  TileProperties dark = {.kind = FLOOR, .base_light = 11, .inside = true, .traversable = true};
+  map_fill_tiles(map, 30, 30, 100, 100, &dark);
+  CU_ASSERT_EQUAL(map_get_tile(map, 39, 39).kind, FLOOR);
+  CU_ASSERT_EQUAL(map_get_tile(map, 39, 39).base_light, 10);
+  CU_ASSERT_EQUAL(map_get_tile(map, 29, 39).kind, GRASS);
+
+  // A room with a door, partially outside of the map
+  MapPrefab     *room = map_prefab_new(5, 4);
+  TileProperties floor = {.kind = FLOOR, .base_light = 2, .inside = true, .traversable = true};
+  for (uint32_t x = 0; x < 5; x++) {
+    for (uint32_t y = 0; y < 4; y++) {
+      map_prefab_set_tile(room, x, y, x == 0 || y == 0 || x == 4 || y == 3 ? &wall : &floor);
+    }
+  }
+  map_prefab_set_tile(room, 2, 3, &floor);
+
+  map_stamp_prefab(map, room, 11, 14);
+  CU_ASSERT_EQUAL(map_get_tile(map, 11, 14).kind, ROAD);
+  CU_ASSERT_EQUAL(map_get_tile(map, 12, 15).kind, FLOOR);
+  CU_ASSERT_EQUAL(map_get_tile(map, 12, 15).base_light, 2);
+  CU_ASSERT_TRUE(map_get_tile(map, 13, 17).traversable);
+  CU_ASSERT_FALSE(map_get_tile(map, 15, 17).traversable);
+  CU_ASSERT_FALSE(map_same_region(map, 0, 0, 39, 39));
+
+  // A corridor through the wall
+  MapPrefab *corridor = map_prefab_new(3, 1);
+  map_stamp_prefab(map, corridor, 10, 30);
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 39, 39));
+  CU_ASSERT_TRUE(map_same_region(map, 0, 0, 13, 16));
+  map_prefab_free(corridor);
+
+  map_stamp_prefab(map, room, 37, 38);
+  CU_ASSERT_EQUAL(map_get_tile(map, 38, 39).kind, FLOOR);
+  CU_ASSERT_EQUAL(map_get_tile(map, 39, 39).kind, FLOOR);
+  CU_ASSERT_EQUAL(map_get_tile(map, 37, 39).kind, ROAD);
+
+  map_prefab_free(room);
+  map_free(map);
+}
+
+void map_planes_test(void) {
+  Map *map = map_new(100, 10, 0, "MapName");
+  CU_ASSERT_EQUAL(map_count_plane_words(map), 2);
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_TRAVERSABLE, 0, 0, 99, 9), 1000);
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_LIT, 0, 0, 200, 200), 1000);
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_INSIDE, 0, 0, 99, 9), 0);
+  CU_ASSERT_EQUAL(map_get_plane_row(map, MAP_PLANE_TRAVERSABLE, 3)[1], (1ULL << 36) - 1);
+  CU_ASSERT_FALSE(map_test_plane(map, MAP_PLANE_TRAVERSABLE, 100, 0));
+
+  // Planes follow the tiles
+  TileProperties wall = {.kind = FLOOR, .base_light = 0, .inside = true, .traversable = false};
+  map_set_tile_properties(map, 63, 2, &wall);
+  map_fill_tiles(map, 60, 5, 70, 6, &wall);
+  CU_ASSERT_FALSE(map_test_plane(map, MAP_PLANE_TRAVERSABLE, 63, 2));
+  CU_ASSERT_TRUE(map_test_plane(map, MAP_PLANE_INSIDE, 63, 2));
+  CU_ASSERT_FALSE(map_test_plane(map, MAP_PLANE_LIT, 64, 5));
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_INSIDE, 0, 0, 99, 9), 23);
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_INSIDE, 62, 0, 64, 9), 7);
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_LIT, 0, 0, 99, 9), 977);
+
+  // And the entities
+  Entity *entity = entity_build(10, HUMAN, "E1", 64, 2);
+  map_add_entity(map, entity);
+  CU_ASSERT_TRUE(map_test_plane(map, MAP_PLANE_OCCUPIED, 64, 2));
+  map_move_entity(map, entity, 1, 0);
+  CU_ASSERT_FALSE(map_test_plane(map, MAP_PLANE_OCCUPIED, 64, 2));
+  CU_ASSERT_TRUE(map_test_plane(map, MAP_PLANE_OCCUPIED, 65, 2));
+  map_remove_entity(map, "E1");
+  CU_ASSERT_EQUAL(map_count_in_plane(map, MAP_PLANE_OCCUPIED, 0, 0, 99, 9), 0);
+
+  map_free(map);
+}
+
+void map_find_free_tile_test(void) {
+  Map     *map = map_new(100, 10, 0, "MapName");
+  uint32_t x = 0;
+  uint32_t y = 0;
+
+  CU_ASSERT_TRUE(map_find_free_tile(map, 10, 1, 20, 5, &x, &y));
+  CU_ASSERT_EQUAL(x, 10);
+  CU_ASSERT_EQUAL(y, 1);
+
+  // Everything is blocked but a single tile
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  map_fill_tiles(map, 0, 0, 99, 9, &wall);
+  CU_ASSERT_FALSE(map_find_free_tile(map, 0, 0, 99, 9, &x, &y));
+
+  TileProperties floor = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = true};
+  map_set_tile_properties(map, 70, 8, &floor);
+  CU_ASSERT_TRUE(map_find_free_tile(map, 0, 0, 1000, 1000, &x, &y));
+  CU_ASSERT_EQUAL(x, 70);
+  CU_ASSERT_EQUAL(y, 8);
+  CU_ASSERT_FALSE(map_find_free_tile(map, 71, 0, 99, 9, &x, &y));
+  CU_ASSERT_FALSE(map_find_free_tile(map, 0, 0, 69, 9, &x, &y));
+
+  map_add_entity(map, entity_build(10, HUMAN, "E1", 70, 8));
+  CU_ASSERT_FALSE(map_find_free_tile(map, 0, 0, 99, 9, &x, &y));
 
   map_free(map);
 }
@@ -331,9 +1044,25 @@ void map_test_suite() {
   CU_pSuite suite = CU_add_suite("Map Tests", nullptr, nullptr);
   CU_add_test(suite, "Creation", &map_creation_test);
   CU_add_test(suite, "Handle Entities", &map_entities_test);
+  CU_add_test(suite, "Occupancy", &map_occupancy_test);
+  CU_add_test(suite, "Area queries", &map_area_queries_test);
+  CU_add_test(suite, "Entity handles", &map_entity_handles_test);
+  CU_add_test(suite, "Entities growth", &map_entities_growth_test);
+  CU_add_test(suite, "Entities waves", &map_entities_waves_test);
   CU_add_test(suite, "Handle Items", &map_items_test);
+  CU_add_test(suite, "Items index", &map_items_index_test);
+  CU_add_test(suite, "Regions", &map_regions_test);
   CU_add_test(suite, "Serialization", &map_serialization_test);
   CU_add_test(suite, "Deserialization", &map_deserialize_test);
+  CU_add_test(suite, "Deserialization of the planes", &map_deserialize_planes_test);
+  CU_add_test(suite, "Deserialization of the tiles", &map_deserialize_tiles_test);
   CU_add_test(suite, "Tiles", &map_tile_test);
+  CU_add_test(suite, "Sparse tiles", &map_sparse_tiles_test);
+  CU_add_test(suite, "Bulk tiles", &map_bulk_tiles_test);
+  CU_add_test(suite, "Planes", &map_planes_test);
+  CU_add_test(suite, "Find free tile", &map_find_free_tile_test);
+  CU_add_test(suite, "Chunk store", &map_chunk_store_test);
+  CU_add_test(suite, "Chunk store: Foreign files", &map_chunk_store_foreign_files_test);
+  CU_add_test(suite, "Streaming", &map_streaming_test);
 }
 
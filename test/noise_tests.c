@@ -0,0 +1,146 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "entity.h"
+#include "map.h"
+#include "noise.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+void noise_propagation_test(void) {
+  Map        *map = map_new(30, 30, 0, "Noisy map");
+  NoiseField *field = noise_field_new(map);
+
+  noise_field_emit(field, 10, 10, 5);
+  CU_ASSERT_EQUAL(noise_field_count_pending(field), 1);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 10, 10), 0);
+
+  noise_field_propagate(field);
+  CU_ASSERT_EQUAL(noise_field_count_pending(field), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 10, 10), 5);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 11, 11), 4);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 14, 10), 1);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 15, 10), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 100, 10), 0);
+
+  // All the noises of a cycle are propagated together, the loudest wins
+  noise_field_emit(field, 10, 10, 5);
+  noise_field_emit(field, 13, 10, 3);
+  noise_field_propagate(field);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 12, 10), 3);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 14, 10), 2);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 15, 10), 1);
+
+  // Nothing happened during the last cycle
+  noise_field_propagate(field);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 10, 10), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 12, 10), 0);
+
+  // Movements depend on the tile
+  noise_field_emit_movement(field, 5, 5);
+  noise_field_propagate(field);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 5, 5), 3 * NOISE_MOVEMENT_FACTOR);
+
+  noise_field_free(field);
+  map_free(map);
+}
+
+void noise_blocks_test(void) {
+  Map        *map = map_new(1000, 1000, 0, "Big noisy map");
+  NoiseField *field = noise_field_new(map);
+
+  // Noises going across blocks, up to the partial ones on the edges
+  noise_field_emit(field, 15, 15, 3);
+  noise_field_emit(field, 998, 999, 4);
+  noise_field_propagate(field);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 15, 15), 3);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 16, 16), 2);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 14, 17), 1);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 999, 999), 3);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 995, 997), 1);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 500, 500), 0);
+
+  // Blocks are reused somewhere else without keeping the old levels
+  noise_field_emit(field, 500, 500, 2);
+  noise_field_propagate(field);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 15, 15), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 999, 999), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 500, 500), 2);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 501, 499), 1);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 502, 500), 0);
+
+  noise_field_free(field);
+  map_free(map);
+}
+
+void noise_walls_test(void) {
+  Map *map = map_new(30, 30, 0, "Walls");
+
+  TileProperties wall = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+  for (uint32_t y = 0; y < 30; y++) {
+    map_set_tile_properties(map, 12, y, &wall);
+  }
+
+  NoiseField *field = noise_field_new(map);
+  noise_field_emit(field, 10, 10, 8);
+  noise_field_propagate(field);
+
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 11, 10), 7);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 12, 10), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 13, 10), 0);
+  CU_ASSERT_EQUAL(noise_field_get_level(field, 10, 3), 1);
+
+  noise_field_free(field);
+  map_free(map);
+}
+
+void noise_hearing_test(void) {
+  Map        *map = map_new(30, 30, 0, "Hearing");
+  NoiseField *field = noise_field_new(map);
+
+  EntityBuilder *builder = entity_builder_new();
+  Entity        *deaf = builder->with_name(builder, "Deaf")->with_hearing_distance(builder, 5)->with_coords(builder, 13, 10)->build(builder, false);
+  Entity        *normal = builder->with_name(builder, "Normal")->with_hearing_distance(builder, 10)->build(builder, true);
+
+  CU_ASSERT_FALSE(noise_field_can_hear(field, normal));
+
+  noise_field_emit(field, 10, 10, 5);
+  noise_field_propagate(field);
+  CU_ASSERT_TRUE(noise_field_can_hear(field, normal));
+  CU_ASSERT_FALSE(noise_field_can_hear(field, deaf));
+
+  noise_field_emit(field, 10, 10, 10);
+  noise_field_propagate(field);
+  CU_ASSERT_TRUE(noise_field_can_hear(field, deaf));
+
+  entity_free(deaf);
+  entity_free(normal);
+  noise_field_free(field);
+  map_free(map);
+}
+
+void noise_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("Noise Tests", nullptr, nullptr);
+  CU_add_test(suite, "Propagation", &noise_propagation_test);
+  CU_add_test(suite, "Blocks", &noise_blocks_test);
+  CU_add_test(suite, "Walls", &noise_walls_test);
+  CU_add_test(suite, "Hearing", &noise_hearing_test);
+}
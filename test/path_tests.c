@@ -0,0 +1,129 @@
+// AndiRPG - Name not final
+// Copyright © 2024 Massimo Gengarelli
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "entity.h"
+#include "map.h"
+#include "path.h"
+#include "utils.h"
+#include <CUnit/CUnit.h>
+#include <CUnit/TestDB.h>
+
+static TileProperties const WALL = {.kind = FLOOR, .base_light = 10, .inside = true, .traversable = false};
+
+// Every step must be a move to one of the 8 neighbours
+bool path_is_contiguous(PathFinder const *finder, uint32_t from_x, uint32_t from_y) {
+  for (uint32_t i = 0; i < path_finder_get_length(finder); i++) {
+    PathStep step = path_finder_get_step(finder, i);
+    if (step.x + 1 < from_x || step.x > from_x + 1 || step.y + 1 < from_y || step.y > from_y + 1) {
+      return false;
+    }
+    from_x = step.x;
+    from_y = step.y;
+  }
+
+  return true;
+}
+
+void path_open_map_test(void) {
+  Map        *map = map_new(20, 20, 0, "Open map");
+  PathFinder *finder = path_finder_new(map);
+
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 0, 5, 3));
+  CU_ASSERT_EQUAL(path_finder_get_length(finder), 5);
+  CU_ASSERT_TRUE(path_is_contiguous(finder, 0, 0));
+  CU_ASSERT_EQUAL(path_finder_get_step(finder, 4).x, 5);
+  CU_ASSERT_EQUAL(path_finder_get_step(finder, 4).y, 3);
+
+  // Nothing to explore around a straight path
+  CU_ASSERT_TRUE(path_finder_search(finder, 19, 19, 0, 19));
+  CU_ASSERT_EQUAL(path_finder_get_length(finder), 19);
+  CU_ASSERT_EQUAL(path_finder_count_expanded(finder), 19);
+
+  CU_ASSERT_TRUE(path_finder_search(finder, 4, 4, 4, 4));
+  CU_ASSERT_EQUAL(path_finder_get_length(finder), 0);
+
+  CU_ASSERT_FALSE(path_finder_search(finder, 4, 4, 20, 4));
+
+  path_finder_free(finder);
+  map_free(map);
+}
+
+void path_walls_test(void) {
+  Map *map = map_new(20, 20, 0, "Walls");
+  for (uint32_t y = 0; y < 19; y++) {
+    map_set_tile_properties(map, 5, y, &WALL);
+  }
+
+  PathFinder *finder = path_finder_new(map);
+
+  // The only way is through the hole at the bottom of the wall
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 0, 10, 0));
+  CU_ASSERT_EQUAL(path_finder_get_length(finder), 38);
+  CU_ASSERT_TRUE(path_is_contiguous(finder, 0, 0));
+  CU_ASSERT_EQUAL(path_finder_get_step(finder, 18).x, 5);
+  CU_ASSERT_EQUAL(path_finder_get_step(finder, 18).y, 19);
+
+  map_set_tile_properties(map, 5, 19, &WALL);
+  CU_ASSERT_FALSE(path_finder_search(finder, 0, 0, 10, 0));
+  CU_ASSERT_FALSE(path_finder_search(finder, 0, 0, 5, 5));
+
+  // Searches do not depend on the previous ones
+  for (uint32_t i = 0; i < 100; i++) {
+    uint32_t from_y = i % 20;
+    uint32_t to_y = 19 - from_y;
+    CU_ASSERT_TRUE(path_finder_search(finder, 0, from_y, 4, to_y));
+    CU_ASSERT_EQUAL(path_finder_get_length(finder), max(4, from_y > to_y ? from_y - to_y : to_y - from_y));
+  }
+
+  path_finder_free(finder);
+  map_free(map);
+}
+
+void path_occupancy_test(void) {
+  // A corridor along y = 1
+  Map *map = map_new(10, 3, 0, "Corridor");
+  for (uint32_t x = 0; x < 10; x++) {
+    map_set_tile_properties(map, x, 0, &WALL);
+    map_set_tile_properties(map, x, 2, &WALL);
+  }
+  map_add_entity(map, entity_build(10, HUMAN, "Blocker", 5, 1));
+
+  PathFinder *finder = path_finder_new(map);
+  CU_ASSERT_FALSE(path_finder_search(finder, 0, 1, 9, 1));
+
+  // Entities can be reached
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 1, 5, 1));
+  CU_ASSERT_EQUAL(path_finder_get_length(finder), 5);
+
+  map_remove_entity(map, "Blocker");
+  CU_ASSERT_TRUE(path_finder_search(finder, 0, 1, 9, 1));
+  CU_ASSERT_EQUAL(path_finder_get_length(finder), 9);
+
+  path_finder_free(finder);
+  map_free(map);
+}
+
+void path_test_suite(void) {
+  CU_pSuite suite = CU_add_suite("Path Tests", nullptr, nullptr);
+  CU_add_test(suite, "Open map", &path_open_map_test);
+  CU_add_test(suite, "Walls", &path_walls_test);
+  CU_add_test(suite, "Occupancy", &path_occupancy_test);
+}
@@ -1,4 +1,6 @@
+#include "entity.h"
 #include "logger.h"
+#include "point.h"
 #include <CUnit/Basic.h>
 #include <CUnit/CUError.h>
 #include <CUnit/CUnit.h>
@@ -17,6 +19,13 @@ void logger_test_suite();
 void tile_test_suite();
 void perk_test_suite();
 void collection_test_suite();
+void fov_test_suite();
+void noise_test_suite();
+void path_test_suite();
+void flow_field_test_suite();
+void hpa_test_suite();
+void light_test_suite();
+void generator_test_suite();
 
 int main(int argc, char *argv[]) {
   logger_new("./tests.log", DEBUG);
@@ -35,6 +44,13 @@ int main(int argc, char *argv[]) {
   tile_test_suite();
   perk_test_suite();
   collection_test_suite();
+  fov_test_suite();
+  noise_test_suite();
+  path_test_suite();
+  flow_field_test_suite();
+  hpa_test_suite();
+  light_test_suite();
+  generator_test_suite();
 
   CU_basic_set_mode(CU_BRM_VERBOSE);
   CU_ErrorCode code = CU_basic_run_tests();
@@ -47,6 +63,9 @@ int main(int argc, char *argv[]) {
 
   CU_cleanup_registry();
 
+  entity_shutdown();
+  point_shutdown();
+
   logger_free(logger_instance());
 
   return number_of_failures;
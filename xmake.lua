@@ -30,6 +30,7 @@ set_kind("shared", { soname = true })
 add_files("src/*.c")
 add_files("src/collections/*.c")
 add_includedirs("src")
+add_syslinks("pthread")
 target_end()
 
 target("rpg")